@@ -0,0 +1,395 @@
+#ifndef _MDR_ARITHMETIC_BP_ENCODER_HPP
+#define _MDR_ARITHMETIC_BP_ENCODER_HPP
+
+#include "BitplaneEncoderInterface.hpp"
+#include "ErrorCollector/BitplaneErrorAccumulator.hpp"
+#include "Interleaver/LevelReader.hpp"
+#include "Interleaver/LevelWriter.hpp"
+#include "BitplaneSource.hpp"
+
+namespace MDR {
+    // adaptive binary range coder (LZMA style): 11-bit probabilities of 0, adapted with a shift of 5
+    const uint32_t RC_PROB_BITS = 11;
+    const uint16_t RC_PROB_INIT = 1 << (RC_PROB_BITS - 1);
+    const uint32_t RC_ADAPT_SHIFT = 5;
+    const uint32_t RC_TOP = 1u << 24;
+
+    class BinaryRangeEncoder {
+    public:
+        BinaryRangeEncoder(std::vector<uint8_t>& output) : output(output) {}
+        inline void encode(uint16_t& prob, uint32_t bit){
+            const uint32_t bound = (range >> RC_PROB_BITS) * prob;
+            if(bit){
+                low += bound;
+                range -= bound;
+                prob -= prob >> RC_ADAPT_SHIFT;
+            }
+            else{
+                range = bound;
+                prob += ((1u << RC_PROB_BITS) - prob) >> RC_ADAPT_SHIFT;
+            }
+            while(range < RC_TOP){
+                range <<= 8;
+                shift_low();
+            }
+        }
+        void flush(){
+            for(int i=0; i<5; i++) shift_low();
+        }
+    private:
+        // carry propagation through the pending 0xff bytes
+        inline void shift_low(){
+            if(((uint32_t) low < 0xff000000u) || (low >> 32)){
+                uint8_t carry = low >> 32;
+                uint8_t byte = cache;
+                do{
+                    output.push_back(byte + carry);
+                    byte = 0xff;
+                }while(-- cache_size);
+                cache = (low >> 24) & 0xff;
+            }
+            cache_size ++;
+            low = (low & 0x00ffffffu) << 8;
+        }
+        std::vector<uint8_t>& output;
+        uint64_t low = 0;
+        uint32_t range = 0xffffffffu;
+        uint8_t cache = 0;
+        uint64_t cache_size = 1;
+    };
+
+    class BinaryRangeDecoder {
+    public:
+        BinaryRangeDecoder(uint8_t const * input) : pos(input) {
+            for(int i=0; i<5; i++) code = (code << 8) | *(pos ++);
+        }
+        inline uint32_t decode(uint16_t& prob){
+            const uint32_t bound = (range >> RC_PROB_BITS) * prob;
+            uint32_t bit = 0;
+            if(code < bound){
+                range = bound;
+                prob += ((1u << RC_PROB_BITS) - prob) >> RC_ADAPT_SHIFT;
+            }
+            else{
+                code -= bound;
+                range -= bound;
+                prob -= prob >> RC_ADAPT_SHIFT;
+                bit = 1;
+            }
+            while(range < RC_TOP){
+                range <<= 8;
+                code = (code << 8) | *(pos ++);
+            }
+            return bit;
+        }
+        // next byte to be read, which can be moved along with the stream (see BitplaneSource.hpp)
+        uint8_t const * next_byte() const {
+            return pos;
+        }
+        void move_next_byte(uint8_t const * next){
+            pos = next;
+        }
+    private:
+        uint8_t const * pos = NULL;
+        uint32_t code = 0;
+        uint32_t range = 0xffffffffu;
+    };
+
+    // context-modeling bitplane encoder (EBCOT/CABAC-like) on sign-magnitude fixed points
+    // every bitplane is an independent range-coded stream, so retrieval stays progressive per bitplane
+    // within a bitplane, coefficients are coded in the interleaved order with three kinds of bits:
+    //   significance (first 1 bit), in a context of the significance of the neighbors i-2..i+2,
+    //   sign (right after significance), in a context of the sign of the previous coefficient,
+    //   refinement (later bits), in a context of the first refinement and the previous coefficient
+    // groups of GROUP_SIZE coefficients that are all insignificant are coded with one bit first (run mode)
+    // the decoder keeps the significance and signs of every level between progressive calls
+    template<class T_data>
+    class ArithmeticBPEncoder : public concepts::BitplaneEncoderInterface<T_data> {
+    public:
+        ArithmeticBPEncoder(){
+            static_assert(std::is_floating_point<T_data>::value, "ArithmeticBPEncoder: input data must be floating points.");
+            static_assert(!std::is_same<T_data, long double>::value, "ArithmeticBPEncoder: long double is not supported.");
+        }
+
+        std::vector<uint8_t *> encode(T_data const * data, int32_t n, int32_t exp, uint8_t num_bitplanes, std::vector<uint32_t>& stream_sizes) const {
+            ContiguousReader<T_data> reader(data);
+            return stream_encode(reader, n, exp, num_bitplanes, stream_sizes);
+        }
+
+        // encode data provided by a level reader
+        template<class Reader>
+        std::vector<uint8_t *> stream_encode(Reader& reader, int32_t n, int32_t exp, uint8_t num_bitplanes, std::vector<uint32_t>& stream_sizes) const {
+            std::vector<double> level_errors;
+            return stream_encode(reader, n, exp, num_bitplanes, stream_sizes, level_errors, false);
+        }
+
+        // only differs in error collection
+        std::vector<uint8_t *> encode(T_data const * data, int32_t n, int32_t exp, uint8_t num_bitplanes, std::vector<uint32_t>& stream_sizes, std::vector<double>& level_errors) const {
+            ContiguousReader<T_data> reader(data);
+            return stream_encode(reader, n, exp, num_bitplanes, stream_sizes, level_errors);
+        }
+
+        // encode data provided by a level reader, with error collection
+        template<class Reader>
+        std::vector<uint8_t *> stream_encode(Reader& reader, int32_t n, int32_t exp, uint8_t num_bitplanes, std::vector<uint32_t>& stream_sizes, std::vector<double>& level_errors, bool collect_errors=true) const {
+            assert(num_bitplanes > 0);
+            // the whole level is converted first, as bitplanes are coded one after another
+            std::vector<T_fp> magnitudes(n);
+            std::vector<uint8_t> signs(n);
+            BitplaneErrorAccumulator<T_fp> error_accumulator(num_bitplanes);
+            std::vector<T_data> data_buffer(ERROR_BLOCK_SIZE);
+            std::vector<double> fraction_buffer(ERROR_BLOCK_SIZE);
+            for(int i=0; i<n; i+=ERROR_BLOCK_SIZE){
+                int size = std::min((int32_t) ERROR_BLOCK_SIZE, n - i);
+                reader.read(data_buffer.data(), size);
+                for(int j=0; j<size; j++){
+                    T_data cur_data = data_buffer[j];
+                    T_data shifted_data = ldexp(fabs(cur_data), num_bitplanes - exp);
+                    T_fp fix_point = (T_fp) shifted_data;
+                    magnitudes[i + j] = fix_point;
+                    signs[i + j] = cur_data < 0;
+                    fraction_buffer[j] = shifted_data - fix_point;
+                }
+                if(collect_errors) error_accumulator.accumulate(magnitudes.data() + i, fraction_buffer.data(), size);
+            }
+            // bitplanes only depend on the magnitudes, so they are coded in parallel
+            std::vector<std::vector<uint8_t>> outputs(num_bitplanes);
+            #pragma omp parallel for schedule(dynamic)
+            for(int b=0; b<num_bitplanes; b++){
+                encode_bitplane(magnitudes.data(), signs.data(), n, num_bitplanes - 1 - b, outputs[b]);
+            }
+            std::vector<uint8_t *> streams(num_bitplanes);
+            stream_sizes = std::vector<uint32_t>(num_bitplanes, 0);
+            for(int b=0; b<num_bitplanes; b++){
+                stream_sizes[b] = outputs[b].size();
+                streams[b] = (uint8_t *) malloc(stream_sizes[b]);
+                memcpy(streams[b], outputs[b].data(), stream_sizes[b]);
+            }
+            if(collect_errors) level_errors = error_accumulator.get_level_errors(exp);
+            return streams;
+        }
+
+        // encode data provided by a level reader into a level sink, with error collection
+        // each bitplane is range coded as a whole, so the bitplanes are written to the sink once the level is encoded
+        template<class Reader, class Sink>
+        void stream_encode_to_sink(Reader& reader, int32_t n, int32_t exp, uint8_t num_bitplanes, Sink& sink, std::vector<double>& level_errors) const {
+            std::vector<uint32_t> stream_sizes;
+            auto streams = stream_encode(reader, n, exp, num_bitplanes, stream_sizes, level_errors);
+            for(int i=0; i<streams.size(); i++){
+                sink.write(i, streams[i], stream_sizes[i]);
+                free(streams[i]);
+            }
+        }
+
+        T_data * decode(const std::vector<uint8_t const *>& streams, int32_t n, int exp, uint8_t num_bitplanes) {
+            T_data * data = (T_data *) malloc(n * sizeof(T_data));
+            ContiguousWriter<T_data> writer(data);
+            LevelState state(n);
+            std::vector<RawBitplaneSource> sources(streams.begin(), streams.end());
+            decode_bitplanes(sources, n, exp, 0, num_bitplanes, state, writer);
+            return data;
+        }
+
+        // decode the data and record necessary information for progressiveness
+        T_data * progressive_decode(const std::vector<uint8_t const *>& streams, int32_t n, int exp, uint8_t starting_bitplane, uint8_t num_bitplanes, int level) {
+            T_data * data = (T_data *) malloc(n * sizeof(T_data));
+            ContiguousWriter<T_data> writer(data);
+            stream_progressive_decode(streams, n, exp, starting_bitplane, num_bitplanes, level, writer);
+            return data;
+        }
+
+        // decode the data and pass the decoded values to a level writer in the interleaved order
+        // values are the contribution of bitplanes [starting_bitplane, starting_bitplane + num_bitplanes)
+        template<class Writer>
+        void stream_progressive_decode(const std::vector<uint8_t const *>& streams, int32_t n, int exp, uint8_t starting_bitplane, uint8_t num_bitplanes, int level, Writer& writer) {
+            std::vector<RawBitplaneSource> sources(streams.begin(), streams.end());
+            stream_progressive_decode_from_sources(sources, n, exp, starting_bitplane, num_bitplanes, level, writer);
+        }
+
+        // same as above, with the bitplanes read from sources (see BitplaneSource.hpp) every SOURCE_CHUNK_BLOCKS groups
+        template<class Sources, class Writer>
+        void stream_progressive_decode_from_sources(Sources& sources, int32_t n, int exp, uint8_t starting_bitplane, uint8_t num_bitplanes, int level, Writer& writer) {
+            if(level_states.size() <= level){
+                level_states.resize(level + 1);
+            }
+            if(starting_bitplane == 0){
+                level_states[level] = LevelState(n);
+            }
+            decode_bitplanes(sources, n, exp, starting_bitplane, num_bitplanes, level_states[level], writer);
+        }
+
+        // allocate the progressive decoding states of num_levels levels up front
+        void init_levels(int num_levels){
+            if(level_states.size() < num_levels){
+                level_states.resize(num_levels);
+            }
+        }
+
+        // release the progressive decoding state of a level, e.g. once all its bitplanes are decoded
+        void release_level(int level){
+            if(level < level_states.size()){
+                level_states[level] = LevelState();
+            }
+        }
+
+        void print() const {
+            std::cout << "Arithmetic bitplane encoder" << std::endl;
+        }
+    private:
+        using T_fp = typename std::conditional<std::is_same<T_data, double>::value, uint64_t, uint32_t>::type;
+        static const int GROUP_SIZE = 16;
+        static const int ERROR_BLOCK_SIZE = 256;
+        static const uint8_t INSIGNIFICANT = 0xff;
+        // number of contexts of each kind
+        static const int NUM_GROUP_CONTEXTS = 2;
+        static const int NUM_SIGNIFICANCE_CONTEXTS = 8;
+        static const int NUM_SIGN_CONTEXTS = 3;
+        static const int NUM_REFINEMENT_CONTEXTS = 4;
+
+        // decoder state of a level: the bitplane where each coefficient became significant, and its sign
+        struct LevelState {
+            LevelState(){}
+            LevelState(int32_t n) : significant_bitplanes(n, INSIGNIFICANT), signs(n, 0) {}
+            std::vector<uint8_t> significant_bitplanes;
+            std::vector<uint8_t> signs;
+        };
+        // adaptive probabilities of one bitplane
+        struct Contexts {
+            Contexts(){
+                for(auto& p:group) p = RC_PROB_INIT;
+                for(auto& p:significance) p = RC_PROB_INIT;
+                for(auto& p:sign) p = RC_PROB_INIT;
+                for(auto& p:refinement) p = RC_PROB_INIT;
+            }
+            uint16_t group[NUM_GROUP_CONTEXTS];
+            uint16_t significance[NUM_SIGNIFICANCE_CONTEXTS];
+            uint16_t sign[NUM_SIGN_CONTEXTS];
+            uint16_t refinement[NUM_REFINEMENT_CONTEXTS];
+        };
+
+        // contexts from the neighbors: significant(j) is the significance known to the decoder at coefficient i,
+        // i.e. including the current bitplane for j < i and excluding it for j > i
+        template<class Significant>
+        static inline int significance_context(int32_t i, int32_t n, Significant significant){
+            int left = (i > 0) && significant(i - 1);
+            int right = (i + 1 < n) && significant(i + 1);
+            int far = ((i > 1) && significant(i - 2)) || ((i + 2 < n) && significant(i + 2));
+            return left + 2 * right + 4 * far;
+        }
+
+        // encode bitplane k (bit weight 2^k) of all coefficients
+        void encode_bitplane(T_fp const * magnitudes, uint8_t const * signs, int32_t n, int k, std::vector<uint8_t>& output) const {
+            output.reserve(n / 16 + 16);
+            BinaryRangeEncoder encoder(output);
+            Contexts contexts;
+            // significance for the decoder at coefficient i: bitplanes above k for j > i, down to k for j < i
+            int32_t i = 0;
+            auto significant_before = [magnitudes, k](int32_t j){ return (magnitudes[j] >> k >> 1) != 0; };
+            auto significant_known = [&i, magnitudes, k](int32_t j){ return (j < i) ? ((magnitudes[j] >> k) != 0) : ((magnitudes[j] >> k >> 1) != 0); };
+            for(int32_t group=0; group<n; group+=GROUP_SIZE){
+                const int32_t group_end = std::min(n, group + GROUP_SIZE);
+                bool all_insignificant = true;
+                bool any_new = false;
+                for(int32_t j=group; j<group_end; j++){
+                    all_insignificant = all_insignificant && !significant_before(j);
+                    any_new = any_new || ((magnitudes[j] >> k) & 1);
+                }
+                if(all_insignificant){
+                    i = group;
+                    int ctx = (group > 0) && significant_known(group - 1);
+                    encoder.encode(contexts.group[ctx], any_new);
+                    if(!any_new) continue;
+                }
+                for(i=group; i<group_end; i++){
+                    const uint32_t bit = (magnitudes[i] >> k) & 1;
+                    if(!significant_before(i)){
+                        encoder.encode(contexts.significance[significance_context(i, n, significant_known)], bit);
+                        if(bit){
+                            int ctx = 0;
+                            if((i > 0) && significant_known(i - 1)) ctx = 1 + signs[i - 1];
+                            encoder.encode(contexts.sign[ctx], signs[i]);
+                        }
+                    }
+                    else{
+                        // first refinement if the coefficient became significant in the previous bitplane
+                        int first = (magnitudes[i] >> k >> 2) == 0;
+                        int left = (i > 0) && significant_known(i - 1);
+                        encoder.encode(contexts.refinement[first + 2 * left], bit);
+                    }
+                }
+            }
+            encoder.flush();
+        }
+
+        // decode bitplanes [starting_bitplane, ending_bitplane) and write their contribution
+        template<class Sources, class Writer>
+        void decode_bitplanes(Sources& sources, int32_t n, int exp, uint8_t starting_bitplane, uint8_t num_bitplanes, LevelState& state, Writer& writer) const {
+            const uint8_t ending_bitplane = starting_bitplane + num_bitplanes;
+            std::vector<T_fp> increments(n, 0);
+            uint8_t * significant_bitplanes = state.significant_bitplanes.data();
+            uint8_t * signs = state.signs.data();
+            for(int b=starting_bitplane; b<ending_bitplane; b++){
+                auto& source = sources[b - starting_bitplane];
+                // the decoder starts with 5 bytes, and then reads at most a byte per decoded bit
+                BinaryRangeDecoder decoder(source.ensure(source.begin(), 5));
+                Contexts contexts;
+                const T_fp bit_value = ((T_fp) 1) << (ending_bitplane - 1 - b);
+                int32_t i = 0;
+                auto significant_before = [significant_bitplanes, b](int32_t j){ return significant_bitplanes[j] < b; };
+                auto significant_known = [&i, significant_bitplanes, b](int32_t j){ return (j < i) ? (significant_bitplanes[j] <= b) : (significant_bitplanes[j] < b); };
+                for(int32_t group=0; group<n; group+=GROUP_SIZE){
+                    if((group / GROUP_SIZE) % SOURCE_CHUNK_BLOCKS == 0){
+                        decoder.move_next_byte(source.ensure(decoder.next_byte(), SOURCE_CHUNK_BLOCKS * (2 * GROUP_SIZE + 1)));
+                    }
+                    const int32_t group_end = std::min(n, group + GROUP_SIZE);
+                    bool all_insignificant = true;
+                    for(int32_t j=group; j<group_end; j++){
+                        all_insignificant = all_insignificant && !significant_before(j);
+                    }
+                    if(all_insignificant){
+                        i = group;
+                        int ctx = (group > 0) && significant_known(group - 1);
+                        if(!decoder.decode(contexts.group[ctx])) continue;
+                    }
+                    for(i=group; i<group_end; i++){
+                        if(!significant_before(i)){
+                            if(decoder.decode(contexts.significance[significance_context(i, n, significant_known)])){
+                                int ctx = 0;
+                                if((i > 0) && significant_known(i - 1)) ctx = 1 + signs[i - 1];
+                                signs[i] = decoder.decode(contexts.sign[ctx]);
+                                significant_bitplanes[i] = b;
+                                increments[i] |= bit_value;
+                            }
+                        }
+                        else{
+                            int first = (significant_bitplanes[i] + 1 == b);
+                            int left = (i > 0) && significant_known(i - 1);
+                            if(decoder.decode(contexts.refinement[first + 2 * left])) increments[i] |= bit_value;
+                        }
+                    }
+                }
+            }
+            // translate the increments and pass them to the writer
+            std::vector<T_data> data_buffer(ERROR_BLOCK_SIZE);
+            for(int i=0; i<n; i+=ERROR_BLOCK_SIZE){
+                int size = std::min((int32_t) ERROR_BLOCK_SIZE, n - i);
+                for(int j=0; j<size; j++){
+                    T_data cur_data = ldexp((T_data) increments[i + j], - ending_bitplane + exp);
+                    data_buffer[j] = signs[i + j] ? -cur_data : cur_data;
+                }
+                writer.write(data_buffer.data(), size);
+            }
+        }
+
+        std::vector<LevelState> level_states;
+    };
+    // definitions of the constants, which are odr-used e.g. by std::vector(n, INSIGNIFICANT)
+    template<class T_data> const int ArithmeticBPEncoder<T_data>::GROUP_SIZE;
+    template<class T_data> const int ArithmeticBPEncoder<T_data>::ERROR_BLOCK_SIZE;
+    template<class T_data> const uint8_t ArithmeticBPEncoder<T_data>::INSIGNIFICANT;
+    template<class T_data> const int ArithmeticBPEncoder<T_data>::NUM_GROUP_CONTEXTS;
+    template<class T_data> const int ArithmeticBPEncoder<T_data>::NUM_SIGNIFICANCE_CONTEXTS;
+    template<class T_data> const int ArithmeticBPEncoder<T_data>::NUM_SIGN_CONTEXTS;
+    template<class T_data> const int ArithmeticBPEncoder<T_data>::NUM_REFINEMENT_CONTEXTS;
+}
+#endif
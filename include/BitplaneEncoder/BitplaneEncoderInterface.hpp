@@ -19,6 +19,13 @@ namespace MDR {
 
             virtual T_data * progressive_decode(const std::vector<uint8_t const *>& streams, int32_t n, int exp, uint8_t starting_bitplane, uint8_t num_bitplanes, int level) = 0;
 
+            // allocate the progressive decoding states of num_levels levels, after which
+            // progressive decoding of different levels is thread-safe
+            virtual void init_levels(int num_levels) = 0;
+
+            // release the progressive decoding state kept for a level
+            virtual void release_level(int level) = 0;
+
             virtual void print() const = 0;
 
         };
@@ -0,0 +1,43 @@
+#ifndef _MDR_BITPLANE_SINK_HPP
+#define _MDR_BITPLANE_SINK_HPP
+
+namespace MDR {
+    // bitplanes written by an encoder chunk by chunk, as to the level sinks (see LosslessCompressor/LevelSink.hpp),
+    // and kept in memory for stream_encode
+    class BufferBitplaneSink {
+    public:
+        // capacity: initial size of the buffer of each bitplane
+        BufferBitplaneSink(uint8_t num_bitplanes, uint32_t capacity) : streams(num_bitplanes, NULL), stream_sizes(num_bitplanes, 0), capacities(num_bitplanes, capacity) {
+            for(int i=0; i<num_bitplanes; i++){
+                streams[i] = (uint8_t *) malloc(capacity);
+            }
+        }
+        BufferBitplaneSink(const BufferBitplaneSink&) = delete;
+        BufferBitplaneSink& operator=(const BufferBitplaneSink&) = delete;
+        void write(uint8_t bitplane, uint8_t const * data, uint32_t size){
+            if(stream_sizes[bitplane] + size > capacities[bitplane]){
+                capacities[bitplane] = std::max(stream_sizes[bitplane] + size, 2 * capacities[bitplane]);
+                streams[bitplane] = (uint8_t *) realloc(streams[bitplane], capacities[bitplane]);
+            }
+            memcpy(streams[bitplane] + stream_sizes[bitplane], data, size);
+            stream_sizes[bitplane] += size;
+        }
+        // hand over the bitplanes and their sizes
+        std::vector<uint8_t *> finish(std::vector<uint32_t>& sizes){
+            std::vector<uint8_t *> result;
+            result.swap(streams);
+            sizes = stream_sizes;
+            return result;
+        }
+        ~BufferBitplaneSink(){
+            for(int i=0; i<streams.size(); i++){
+                free(streams[i]);
+            }
+        }
+    private:
+        std::vector<uint8_t *> streams;
+        std::vector<uint32_t> stream_sizes;
+        std::vector<uint32_t> capacities;
+    };
+}
+#endif
@@ -0,0 +1,34 @@
+#ifndef _MDR_BITPLANE_SOURCE_HPP
+#define _MDR_BITPLANE_SOURCE_HPP
+
+namespace MDR {
+    // bitplane sources give the decoders a bitplane chunk by chunk (see LosslessCompressor/LevelSource.hpp)
+    // begin() returns the start of the bitplane, and ensure(pos, size) makes the size bytes from pos readable
+    // (up to the end of the bitplane) and returns their new location; the pointers obtained before are invalidated
+
+    #define SOURCE_CHUNK_BLOCKS 1024 // blocks decoded between two calls to ensure
+
+    // bitplane already in memory
+    class RawBitplaneSource {
+    public:
+        RawBitplaneSource(uint8_t const * stream) : stream(stream) {}
+        uint8_t const * begin() const {
+            return stream;
+        }
+        inline uint8_t const * ensure(uint8_t const * pos, uint32_t size) const {
+            return pos;
+        }
+    private:
+        uint8_t const * stream = NULL;
+    };
+
+    // make size bytes readable from the position in each source, and move the positions accordingly
+    // the sources of a level are indexed by bitplane, as in a vector of RawBitplaneSource
+    template<class Sources, class T>
+    inline void ensure_sources(Sources& sources, std::vector<T const *>& positions, uint32_t size){
+        for(int i=0; i<positions.size(); i++){
+            positions[i] = reinterpret_cast<T const *>(sources[i].ensure(reinterpret_cast<uint8_t const *>(positions[i]), size));
+        }
+    }
+}
+#endif
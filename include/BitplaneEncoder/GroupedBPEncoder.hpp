@@ -2,6 +2,11 @@
 #define _MDR_GROUPED_BP_ENCODER_HPP
 
 #include "BitplaneEncoderInterface.hpp"
+#include "ErrorCollector/BitplaneErrorAccumulator.hpp"
+#include "Interleaver/LevelReader.hpp"
+#include "Interleaver/LevelWriter.hpp"
+#include "BitplaneSource.hpp"
+#include "BitplaneSink.hpp"
 
 namespace MDR {
     // general bitplane encoder that encodes data by block using T_stream type buffer
@@ -16,132 +21,42 @@ namespace MDR {
         }
 
         std::vector<uint8_t *> encode(T_data const * data, int32_t n, int32_t exp, uint8_t num_bitplanes, std::vector<uint32_t>& stream_sizes) const {
-            assert(num_bitplanes > 0);
-            // determine block size based on bitplane integer type
-            uint32_t block_size = block_size_based_on_bitplane_int_type<T_stream>();
-            std::vector<uint8_t> starting_bitplanes = std::vector<uint8_t>((n - 1)/block_size + 1, 0);
-            stream_sizes = std::vector<uint32_t>(num_bitplanes, 0);
-            // define fixed point type
-            using T_fp = typename std::conditional<std::is_same<T_data, double>::value, uint64_t, uint32_t>::type;
-            std::vector<uint8_t *> streams;
-            for(int i=0; i<num_bitplanes; i++){
-                streams.push_back((uint8_t *) malloc(2 * n / UINT8_BITS + sizeof(T_stream)));
-            }
-            std::vector<T_fp> int_data_buffer(block_size, 0);
-            std::vector<T_stream *> streams_pos(streams.size());
-            for(int i=0; i<streams.size(); i++){
-                streams_pos[i] = reinterpret_cast<T_stream*>(streams[i]);
-            }
-            T_data const * data_pos = data;
-            int block_id=0;
-            for(int i=0; i<n - block_size; i+=block_size){
-                T_stream sign_bitplane = 0;
-                for(int j=0; j<block_size; j++){
-                    T_data cur_data = *(data_pos++);
-                    T_data shifted_data = ldexp(cur_data, num_bitplanes - exp);
-                    int64_t fix_point = (int64_t) shifted_data;
-                    T_stream sign = cur_data < 0;
-                    int_data_buffer[j] = sign ? -fix_point : +fix_point;
-                    sign_bitplane += sign << j;
-                }
-                starting_bitplanes[block_id ++] = encode_block(int_data_buffer.data(), block_size, num_bitplanes, sign_bitplane, streams_pos);
-            }
-            // leftover
-            {
-                int rest_size = n - block_size * block_id;
-                T_stream sign_bitplane = 0;
-                for(int j=0; j<rest_size; j++){
-                    T_data cur_data = *(data_pos++);
-                    T_data shifted_data = ldexp(cur_data, num_bitplanes - exp);
-                    int64_t fix_point = (int64_t) shifted_data;
-                    T_stream sign = cur_data < 0;
-                    int_data_buffer[j] = sign ? -fix_point : +fix_point;
-                    sign_bitplane += sign << j;
-                }
-                starting_bitplanes[block_id ++] = encode_block(int_data_buffer.data(), rest_size, num_bitplanes, sign_bitplane, streams_pos);
-            }
-            for(int i=0; i<num_bitplanes; i++){
-                stream_sizes[i] = reinterpret_cast<uint8_t*>(streams_pos[i]) - streams[i];
-            }
-            // merge starting_bitplane with the first bitplane
-            uint32_t merged_size = 0;
-            uint8_t * merged = merge_arrays(reinterpret_cast<uint8_t const*>(starting_bitplanes.data()), starting_bitplanes.size() * sizeof(uint8_t), reinterpret_cast<uint8_t*>(streams[0]), stream_sizes[0], merged_size);
-            free(streams[0]);
-            streams[0] = merged;
-            stream_sizes[0] = merged_size;
-            return streams;
+            ContiguousReader<T_data> reader(data);
+            return stream_encode(reader, n, exp, num_bitplanes, stream_sizes);
+        }
+
+        // encode data provided by a level reader
+        template<class Reader>
+        std::vector<uint8_t *> stream_encode(Reader& reader, int32_t n, int32_t exp, uint8_t num_bitplanes, std::vector<uint32_t>& stream_sizes) const {
+            BufferBitplaneSink sink(num_bitplanes, 2 * n / UINT8_BITS + sizeof(T_stream));
+            encode_blocks(reader, n, exp, num_bitplanes, sink, NULL);
+            return sink.finish(stream_sizes);
         }
 
         // only differs in error collection
         std::vector<uint8_t *> encode(T_data const * data, int32_t n, int32_t exp, uint8_t num_bitplanes, std::vector<uint32_t>& stream_sizes, std::vector<double>& level_errors) const {
-            assert(num_bitplanes > 0);
-            // determine block size based on bitplane integer type
-            uint32_t block_size = block_size_based_on_bitplane_int_type<T_stream>();
-            std::vector<uint8_t> starting_bitplanes = std::vector<uint8_t>((n - 1)/block_size + 1, 0);
-            stream_sizes = std::vector<uint32_t>(num_bitplanes, 0);
-            // define fixed point type
-            using T_fp = typename std::conditional<std::is_same<T_data, double>::value, uint64_t, uint32_t>::type;
-            std::vector<uint8_t *> streams;
-            for(int i=0; i<num_bitplanes; i++){
-                streams.push_back((uint8_t *) malloc(2 * n / UINT8_BITS + sizeof(T_stream)));
-            }
-            std::vector<T_fp> int_data_buffer(block_size, 0);
-            std::vector<T_stream *> streams_pos(streams.size());
-            for(int i=0; i<streams.size(); i++){
-                streams_pos[i] = reinterpret_cast<T_stream*>(streams[i]);
-            }
-            // init level errors
-            level_errors.clear();
-            level_errors.resize(num_bitplanes + 1);
-            for(int i=0; i<level_errors.size(); i++){
-                level_errors[i] = 0;
-            }
-            T_data const * data_pos = data;
-            int block_id=0;
-            for(int i=0; i<n - block_size; i+=block_size){
-                T_stream sign_bitplane = 0;
-                for(int j=0; j<block_size; j++){
-                    T_data cur_data = *(data_pos++);
-                    T_data shifted_data = ldexp(cur_data, num_bitplanes - exp);
-                    // compute level errors
-                    collect_level_errors(level_errors, fabs(shifted_data), num_bitplanes);
-                    int64_t fix_point = (int64_t) shifted_data;
-                    T_stream sign = cur_data < 0;
-                    int_data_buffer[j] = sign ? -fix_point : +fix_point;
-                    sign_bitplane += sign << j;
-                }
-                starting_bitplanes[block_id ++] = encode_block(int_data_buffer.data(), block_size, num_bitplanes, sign_bitplane, streams_pos);
-            }
-            // leftover
-            {
-                int rest_size = n - block_size * block_id;
-                T_stream sign_bitplane = 0;
-                for(int j=0; j<rest_size; j++){
-                    T_data cur_data = *(data_pos++);
-                    T_data shifted_data = ldexp(cur_data, num_bitplanes - exp);
-                    // compute level errors
-                    collect_level_errors(level_errors, fabs(shifted_data), num_bitplanes);
-                    int64_t fix_point = (int64_t) shifted_data;
-                    T_stream sign = cur_data < 0;
-                    int_data_buffer[j] = sign ? -fix_point : +fix_point;
-                    sign_bitplane += sign << j;
-                }
-                starting_bitplanes[block_id ++] = encode_block(int_data_buffer.data(), rest_size, num_bitplanes, sign_bitplane, streams_pos);
-            }
-            for(int i=0; i<num_bitplanes; i++){
-                stream_sizes[i] = reinterpret_cast<uint8_t*>(streams_pos[i]) - streams[i];
-            }
-            // merge starting_bitplane with the first bitplane
-            uint32_t merged_size = 0;
-            uint8_t * merged = merge_arrays(reinterpret_cast<uint8_t const*>(starting_bitplanes.data()), starting_bitplanes.size() * sizeof(uint8_t), reinterpret_cast<uint8_t*>(streams[0]), stream_sizes[0], merged_size);
-            free(streams[0]);
-            streams[0] = merged;
-            stream_sizes[0] = merged_size;
+            ContiguousReader<T_data> reader(data);
+            return stream_encode(reader, n, exp, num_bitplanes, stream_sizes, level_errors);
+        }
+
+        // encode data provided by a level reader, with error collection
+        template<class Reader>
+        std::vector<uint8_t *> stream_encode(Reader& reader, int32_t n, int32_t exp, uint8_t num_bitplanes, std::vector<uint32_t>& stream_sizes, std::vector<double>& level_errors) const {
+            BufferBitplaneSink sink(num_bitplanes, 2 * n / UINT8_BITS + sizeof(T_stream));
+            // level errors are accumulated block by block
+            BitplaneErrorAccumulator<T_fp> error_accumulator(num_bitplanes);
+            encode_blocks(reader, n, exp, num_bitplanes, sink, &error_accumulator);
             // translate level errors
-            for(int i=0; i<level_errors.size(); i++){
-                level_errors[i] = ldexp(level_errors[i], 2*(- num_bitplanes + exp));
-            }
-            return streams;
+            level_errors = error_accumulator.get_level_errors(exp);
+            return sink.finish(stream_sizes);
+        }
+
+        // encode data provided by a level reader into a level sink, with error collection
+        template<class Reader, class Sink>
+        void stream_encode_to_sink(Reader& reader, int32_t n, int32_t exp, uint8_t num_bitplanes, Sink& sink, std::vector<double>& level_errors) const {
+            BitplaneErrorAccumulator<T_fp> error_accumulator(num_bitplanes);
+            encode_blocks(reader, n, exp, num_bitplanes, sink, &error_accumulator);
+            level_errors = error_accumulator.get_level_errors(exp);
         }
 
         T_data * decode(const std::vector<uint8_t const *>& streams, int32_t n, int exp, uint8_t num_bitplanes) {
@@ -164,43 +79,18 @@ namespace MDR {
 
             std::vector<T_fp> int_data_buffer(block_size, 0);
             // decode
-            T_data * data_pos = data;
             int block_id = 0;
-            for(int i=0; i<n - block_size; i+=block_size){
-                uint8_t recording_bitplane = recording_bitplanes[block_id ++];
+            for(int i=0; i<n; i+=block_size, block_id++){
+                int cur_size = std::min((int) block_size, n - i);
+                uint8_t recording_bitplane = recording_bitplanes[block_id];
                 if(recording_bitplane < num_bitplanes){
                     memset(int_data_buffer.data(), 0, block_size * sizeof(T_fp));
                     T_stream sign_bitplane = *(streams_pos[recording_bitplane] ++);
-                    decode_block(streams_pos, block_size, recording_bitplane, num_bitplanes - recording_bitplane, int_data_buffer.data());
-                    for(int j=0; j<block_size; j++, sign_bitplane >>= 1){
-                        T_data cur_data = ldexp((T_data)int_data_buffer[j], - num_bitplanes + exp);
-                        *(data_pos++) = (sign_bitplane & 1u) ? -cur_data : cur_data;
-                    }
+                    decode_block(streams_pos, cur_size, recording_bitplane, num_bitplanes - recording_bitplane, int_data_buffer.data());
+                    restore_block(int_data_buffer.data(), sign_bitplane, cur_size, exp - num_bitplanes, data + i);
                 }
                 else{
-                    for(int j=0; j<block_size; j++){
-                        *(data_pos ++) = 0;
-                    }
-                }
-            }
-            // leftover
-            {
-                int rest_size = n - block_size * block_id;
-                int recording_bitplane = recording_bitplanes[block_id];
-                T_stream sign_bitplane = 0;
-                if(recording_bitplane < num_bitplanes){
-                    memset(int_data_buffer.data(), 0, block_size * sizeof(T_fp));
-                    sign_bitplane = *(streams_pos[recording_bitplane] ++);
-                    decode_block(streams_pos, block_size, recording_bitplane, num_bitplanes - recording_bitplane, int_data_buffer.data());
-                    for(int j=0; j<rest_size; j++, sign_bitplane >>= 1){
-                        T_data cur_data = ldexp((T_data)int_data_buffer[j], - num_bitplanes + exp);
-                        *(data_pos++) = (sign_bitplane & 1u) ? -cur_data : cur_data;
-                    }
-                }
-                else{
-                    for(int j=0; j<block_size; j++){
-                        *(data_pos ++) = 0;
-                    }
+                    memset(data + i, 0, cur_size * sizeof(T_data));
                 }
             }
             return data;
@@ -208,98 +98,162 @@ namespace MDR {
 
         // decode the data and record necessary information for progressiveness
         T_data * progressive_decode(const std::vector<uint8_t const *>& streams, int32_t n, int exp, uint8_t starting_bitplane, uint8_t num_bitplanes, int level) {
+            T_data * data = (T_data *) malloc(n * sizeof(T_data));
+            ContiguousWriter<T_data> writer(data);
+            stream_progressive_decode(streams, n, exp, starting_bitplane, num_bitplanes, level, writer);
+            return data;
+        }
+
+        // decode the data and pass the decoded values to a level writer in the interleaved order
+        template<class Writer>
+        void stream_progressive_decode(const std::vector<uint8_t const *>& streams, int32_t n, int exp, uint8_t starting_bitplane, uint8_t num_bitplanes, int level, Writer& writer) {
+            std::vector<RawBitplaneSource> sources(streams.begin(), streams.end());
+            stream_progressive_decode_from_sources(sources, n, exp, starting_bitplane, num_bitplanes, level, writer);
+        }
+
+        // same as above, with the bitplanes read from sources (see BitplaneSource.hpp) every SOURCE_CHUNK_BLOCKS blocks
+        template<class Sources, class Writer>
+        void stream_progressive_decode_from_sources(Sources& sources, int32_t n, int exp, uint8_t starting_bitplane, uint8_t num_bitplanes, int level, Writer& writer) {
             uint32_t block_size = block_size_based_on_bitplane_int_type<T_stream>();
             // define fixed point type
             using T_fp = typename std::conditional<std::is_same<T_data, double>::value, uint64_t, uint32_t>::type;
-            T_data * data = (T_data *) malloc(n * sizeof(T_data));
+            // values are decoded block by block and passed to the writer
+            std::vector<T_data> data_buffer(block_size, 0);
             if(num_bitplanes == 0){
-                memset(data, 0, n * sizeof(T_data));
-                return data;
+                for(int i=0; i<n; i+=block_size){
+                    writer.write(data_buffer.data(), std::min((int32_t) block_size, n - i));
+                }
+                return;
             }
-            std::vector<T_stream const *> streams_pos(streams.size());
-            for(int i=0; i<streams.size(); i++){
-                streams_pos[i] = reinterpret_cast<T_stream const *>(streams[i]);
+            std::vector<T_stream const *> streams_pos(sources.size());
+            for(int i=0; i<sources.size(); i++){
+                streams_pos[i] = reinterpret_cast<T_stream const *>(sources[i].begin());
+            }
+            if(level_states.size() <= level){
+                level_states.resize(level + 1);
             }
-            if(level_recording_bitplanes.size() == level){
+            LevelState& state = level_states[level];
+            if(starting_bitplane == 0){
                 // deinterleave the first bitplane
-                uint32_t recording_bitplane_size = *reinterpret_cast<int32_t const*>(streams_pos[0]);
-                uint8_t const * recording_bitplanes_pos = reinterpret_cast<uint8_t const*>(streams_pos[0]) + sizeof(uint32_t);
-                auto recording_bitplanes = std::vector<uint8_t>(recording_bitplanes_pos, recording_bitplanes_pos + recording_bitplane_size);
-                level_recording_bitplanes.push_back(recording_bitplanes);
+                uint8_t const * first_pos = sources[0].ensure(reinterpret_cast<uint8_t const*>(streams_pos[0]), sizeof(uint32_t));
+                uint32_t recording_bitplane_size = *reinterpret_cast<int32_t const*>(first_pos);
+                first_pos = sources[0].ensure(first_pos, sizeof(uint32_t) + recording_bitplane_size);
+                uint8_t const * recording_bitplanes_pos = first_pos + sizeof(uint32_t);
+                state.recording_bitplanes = std::vector<uint8_t>(recording_bitplanes_pos, recording_bitplanes_pos + recording_bitplane_size);
+                state.signs = std::vector<T_stream>(recording_bitplane_size, 0);
                 streams_pos[0] = reinterpret_cast<T_stream const *>(recording_bitplanes_pos + recording_bitplane_size);
             }
-
             std::vector<T_fp> int_data_buffer(block_size, 0);
-            if(level_signs.size() == level){
-                level_signs.push_back(std::vector<bool>(n, false));
-            }
-            const std::vector<uint8_t>& recording_bitplanes = level_recording_bitplanes[level];
-            std::vector<bool>& signs = level_signs[level];
             const uint8_t ending_bitplane = starting_bitplane + num_bitplanes;
             // decode
-            T_data * data_pos = data;
             int block_id = 0;
-            for(int i=0; i<n - block_size; i+=block_size){
-                uint8_t recording_bitplane = recording_bitplanes[block_id ++];
+            for(int i=0; i<n; i+=block_size, block_id++){
+                // a block reads at most a sign and a value from each bitplane
+                if(block_id % SOURCE_CHUNK_BLOCKS == 0) ensure_sources(sources, streams_pos, 2 * SOURCE_CHUNK_BLOCKS * sizeof(T_stream));
+                int cur_size = std::min((int) block_size, n - i);
+                uint8_t recording_bitplane = state.recording_bitplanes[block_id];
                 if(recording_bitplane < ending_bitplane){
                     memset(int_data_buffer.data(), 0, block_size * sizeof(T_fp));
                     if(recording_bitplane >= starting_bitplane){
                         // have not recorded signs for this block
-                        T_stream sign_bitplane = *(streams_pos[recording_bitplane - starting_bitplane] ++);
-                        for(int j=0; j<block_size; j++, sign_bitplane >>= 1){
-                            signs[i + j] = sign_bitplane & 1u;
-                        }
-                        decode_block(streams_pos, block_size, recording_bitplane - starting_bitplane, ending_bitplane - recording_bitplane, int_data_buffer.data());
-                    }                    
-                    else{
-                        decode_block(streams_pos, block_size, 0, num_bitplanes, int_data_buffer.data());                    
-                    }
-                    for(int j=0; j<block_size; j++){
-                        T_data cur_data = ldexp((T_data)int_data_buffer[j], - ending_bitplane + exp);
-                        *(data_pos++) = signs[i + j] ? -cur_data : cur_data;
-                    }
-                }
-                else{
-                    for(int j=0; j<block_size; j++){
-                        *(data_pos ++) = 0;
-                    }
-                }
-            }
-            // leftover
-            {
-                int rest_size = n - block_size * block_id;
-                uint8_t recording_bitplane = recording_bitplanes[block_id];
-                if(recording_bitplane < ending_bitplane){
-                    memset(int_data_buffer.data(), 0, block_size * sizeof(T_fp));
-                    if(recording_bitplane >= starting_bitplane){
-                        // have not recorded signs for this block
-                        T_stream sign_bitplane = *(streams_pos[recording_bitplane - starting_bitplane] ++);
-                        for(int j=0; j<rest_size; j++, sign_bitplane >>= 1){
-                            signs[block_size * block_id + j] = sign_bitplane & 1u;
-                        }
-                        decode_block(streams_pos, rest_size, recording_bitplane - starting_bitplane, ending_bitplane - recording_bitplane, int_data_buffer.data());
+                        state.signs[block_id] = *(streams_pos[recording_bitplane - starting_bitplane] ++);
+                        decode_block(streams_pos, cur_size, recording_bitplane - starting_bitplane, ending_bitplane - recording_bitplane, int_data_buffer.data());
                     }
                     else{
-                        decode_block(streams_pos, rest_size, 0, num_bitplanes, int_data_buffer.data());                    
-                    }
-                    for(int j=0; j<rest_size; j++){
-                        T_data cur_data = ldexp((T_data)int_data_buffer[j], - ending_bitplane + exp);
-                        *(data_pos++) = signs[block_size * block_id + j] ? -cur_data : cur_data;
+                        decode_block(streams_pos, cur_size, 0, num_bitplanes, int_data_buffer.data());
                     }
+                    restore_block(int_data_buffer.data(), state.signs[block_id], cur_size, exp - ending_bitplane, data_buffer.data());
                 }
                 else{
-                    for(int j=0; j<rest_size; j++){
-                        *(data_pos ++) = 0;
-                    }
+                    memset(data_buffer.data(), 0, cur_size * sizeof(T_data));
                 }
+                writer.write(data_buffer.data(), cur_size);
+            }
+        }
+
+        // allocate the progressive decoding states of num_levels levels up front
+        void init_levels(int num_levels){
+            if(level_states.size() < num_levels){
+                level_states.resize(num_levels);
+            }
+        }
+
+        // release the progressive decoding state of a level, e.g. once all its bitplanes are decoded
+        void release_level(int level){
+            if(level < level_states.size()){
+                level_states[level] = LevelState();
             }
-            return data;
         }
 
         void print() const {
             std::cout << "Grouped bitplane encoder" << std::endl;
         }
     private:
+        // define fixed point type
+        using T_fp = typename std::conditional<std::is_same<T_data, double>::value, uint64_t, uint32_t>::type;
+
+        // encode the blocks of data provided by a level reader into a sink, and accumulate the level errors unless error_accumulator is NULL
+        // bitplanes other than the first are flushed to the sink every SINK_CHUNK_BLOCKS blocks,
+        // the first is kept as the starting bitplanes are merged in front of it
+        template<class Reader, class Sink>
+        void encode_blocks(Reader& reader, int32_t n, int32_t exp, uint8_t num_bitplanes, Sink& sink, BitplaneErrorAccumulator<T_fp> * error_accumulator) const {
+            assert(num_bitplanes > 0);
+            const int SINK_CHUNK_BLOCKS = 4096;
+            // determine block size based on bitplane integer type
+            uint32_t block_size = block_size_based_on_bitplane_int_type<T_stream>();
+            const int num_blocks = (n - 1)/block_size + 1;
+            std::vector<uint8_t> starting_bitplanes = std::vector<uint8_t>(num_blocks, 0);
+            // a block writes at most two words (sign and value) to a bitplane
+            std::vector<uint8_t *> streams;
+            streams.push_back((uint8_t *) malloc(2 * num_blocks * sizeof(T_stream)));
+            for(int i=1; i<num_bitplanes; i++){
+                streams.push_back((uint8_t *) malloc(2 * SINK_CHUNK_BLOCKS * sizeof(T_stream)));
+            }
+            std::vector<T_fp> int_data_buffer(block_size, 0);
+            std::vector<T_stream *> streams_pos(streams.size());
+            for(int i=0; i<streams.size(); i++){
+                streams_pos[i] = reinterpret_cast<T_stream*>(streams[i]);
+            }
+            auto flush = [&](){
+                for(int i=1; i<num_bitplanes; i++){
+                    sink.write(i, streams[i], reinterpret_cast<uint8_t*>(streams_pos[i]) - streams[i]);
+                    streams_pos[i] = reinterpret_cast<T_stream*>(streams[i]);
+                }
+            };
+            std::vector<double> fraction_buffer(block_size, 0);
+            // data are read from the reader block by block
+            std::vector<T_data> data_buffer(block_size);
+            int block_id=0;
+            for(int i=0; i<n; i+=block_size){
+                int cur_size = std::min((int) block_size, n - i);
+                reader.read(data_buffer.data(), cur_size);
+                T_data const * data_pos = data_buffer.data();
+                T_stream sign_bitplane = 0;
+                for(int j=0; j<cur_size; j++){
+                    T_data cur_data = *(data_pos++);
+                    T_data shifted_data = ldexp(cur_data, num_bitplanes - exp);
+                    int64_t fix_point = (int64_t) shifted_data;
+                    T_stream sign = cur_data < 0;
+                    int_data_buffer[j] = sign ? -fix_point : +fix_point;
+                    fraction_buffer[j] = fabs(shifted_data - fix_point);
+                    sign_bitplane += sign << j;
+                }
+                // compute level errors
+                if(error_accumulator) error_accumulator->accumulate(int_data_buffer.data(), fraction_buffer.data(), cur_size);
+                starting_bitplanes[block_id ++] = encode_block(int_data_buffer.data(), cur_size, num_bitplanes, sign_bitplane, streams_pos);
+                if(block_id % SINK_CHUNK_BLOCKS == 0) flush();
+            }
+            flush();
+            // merge starting_bitplane with the first bitplane
+            uint32_t merged_size = 0;
+            uint8_t * merged = merge_arrays(reinterpret_cast<uint8_t const*>(starting_bitplanes.data()), starting_bitplanes.size() * sizeof(uint8_t), streams[0], reinterpret_cast<uint8_t*>(streams_pos[0]) - streams[0], merged_size);
+            sink.write(0, merged, merged_size);
+            free(merged);
+            for(int i=0; i<streams.size(); i++){
+                free(streams[i]);
+            }
+        }
+
         template<class T>
         uint32_t block_size_based_on_bitplane_int_type() const {
             uint32_t block_size = 0;
@@ -321,19 +275,6 @@ namespace MDR {
             }
             return block_size;
         }
-        inline void collect_level_errors(std::vector<double>& level_errors, float data, int num_bitplanes) const {
-            uint32_t fp_data = (uint32_t) data;
-            double mantissa = data - (uint32_t) data;
-            level_errors[num_bitplanes] += mantissa * mantissa;
-            for(int k=1; k<num_bitplanes; k++){
-                uint32_t mask = (1 << k) - 1;
-                double diff = (double) (fp_data & mask) + mantissa;
-                level_errors[num_bitplanes - k] += diff * diff;
-            }
-            double diff = fp_data + mantissa;
-            level_errors[0] += data * data;
-        }
-
         template <class T_int>
         inline uint8_t encode_block(T_int const * data, size_t n, uint8_t num_bitplanes, T_stream sign, std::vector<T_stream *>& streams_pos) const {
             bool recorded = false;
@@ -367,6 +308,25 @@ namespace MDR {
             }
         }
 
+        // scale the decoded integers of a block by 2^exp and apply the packed signs
+        template <class T_int>
+        inline void restore_block(T_int const * data, T_stream sign, size_t n, int exp, T_data * output) const {
+            const T_data scale = ldexp((T_data) 1, exp);
+            if(std::isnormal(scale)){
+                // scaling by a normal power of two is exact, so it matches ldexp
+                for(int i=0; i<n; i++){
+                    T_data cur_data = (T_data) data[i] * scale;
+                    output[i] = ((sign >> i) & 1u) ? -cur_data : cur_data;
+                }
+            }
+            else{
+                for(int i=0; i<n; i++){
+                    T_data cur_data = ldexp((T_data) data[i], exp);
+                    output[i] = ((sign >> i) & 1u) ? -cur_data : cur_data;
+                }
+            }
+        }
+
         uint8_t * merge_arrays(uint8_t const * array1, uint32_t size1, uint8_t const * array2, uint32_t size2, uint32_t& merged_size) const {
             merged_size = sizeof(uint32_t) + size1 + size2;
             uint8_t * merged_array = (uint8_t *) malloc(merged_size);
@@ -376,8 +336,12 @@ namespace MDR {
             return merged_array;
         }
 
-        std::vector<std::vector<bool>> level_signs;
-        std::vector<std::vector<uint8_t>> level_recording_bitplanes;
+        // progressive decoding state of a level
+        struct LevelState {
+            std::vector<uint8_t> recording_bitplanes;   // first recorded bitplane of each block
+            std::vector<T_stream> signs;                // signs of each block, packed as encoded
+        };
+        std::vector<LevelState> level_states;
     };
 }
 #endif
@@ -2,9 +2,16 @@
 #define _MDR_NEGABINARY_BP_ENCODER_HPP
 
 #include "BitplaneEncoderInterface.hpp"
+#include "ErrorCollector/BitplaneErrorAccumulator.hpp"
+#include "Interleaver/LevelReader.hpp"
+#include "Interleaver/LevelWriter.hpp"
+#include "BitplaneSource.hpp"
+#include "BitplaneSink.hpp"
 
 namespace MDR {
     // general bitplane encoder that encodes data by block using T_stream type buffer
+    // blocks skip their leading all-zero bitplanes: the first significant bitplane of each block
+    // (one byte per block) is stored in front of the first bitplane, and the decoder keeps it per level
     template<class T_data, class T_stream>
     class NegaBinaryBPEncoder : public concepts::BitplaneEncoderInterface<T_data> {
     public:
@@ -16,185 +23,179 @@ namespace MDR {
         }
 
         std::vector<uint8_t *> encode(T_data const * data, int32_t n, int32_t exp, uint8_t num_bitplanes, std::vector<uint32_t>& stream_sizes) const {
-            assert(num_bitplanes > 0);
-            // leave room for negabinary format
-            exp += 2;
-            // determine block size based on bitplane integer type
-            uint32_t block_size = block_size_based_on_bitplane_int_type<T_stream>();
-            std::vector<uint8_t> starting_bitplanes = std::vector<uint8_t>((n - 1)/block_size + 1, 0);
-            stream_sizes = std::vector<uint32_t>(num_bitplanes, 0);
-            // define fixed point type
-            using T_fps = typename std::conditional<std::is_same<T_data, double>::value, int64_t, int32_t>::type;
-            using T_fp = typename std::conditional<std::is_same<T_data, double>::value, uint64_t, uint32_t>::type;
-            std::vector<uint8_t *> streams;
-            for(int i=0; i<num_bitplanes; i++){
-                streams.push_back((uint8_t *) malloc(n / UINT8_BITS + sizeof(T_stream)));
-            }
-            std::vector<T_fp> int_data_buffer(block_size, 0);
-            std::vector<T_stream *> streams_pos(streams.size());
+            ContiguousReader<T_data> reader(data);
+            return stream_encode(reader, n, exp, num_bitplanes, stream_sizes);
+        }
+
+        // encode data provided by a level reader
+        template<class Reader>
+        std::vector<uint8_t *> stream_encode(Reader& reader, int32_t n, int32_t exp, uint8_t num_bitplanes, std::vector<uint32_t>& stream_sizes) const {
+            BufferBitplaneSink sink(num_bitplanes, n / UINT8_BITS + sizeof(T_stream));
+            encode_blocks(reader, n, exp, num_bitplanes, sink, NULL);
+            return sink.finish(stream_sizes);
+        }
+
+        // only differs in error collection
+        std::vector<uint8_t *> encode(T_data const * data, int32_t n, int32_t exp, uint8_t num_bitplanes, std::vector<uint32_t>& stream_sizes, std::vector<double>& level_errors) const {
+            ContiguousReader<T_data> reader(data);
+            return stream_encode(reader, n, exp, num_bitplanes, stream_sizes, level_errors);
+        }
+
+        // encode data provided by a level reader, with error collection
+        template<class Reader>
+        std::vector<uint8_t *> stream_encode(Reader& reader, int32_t n, int32_t exp, uint8_t num_bitplanes, std::vector<uint32_t>& stream_sizes, std::vector<double>& level_errors) const {
+            BufferBitplaneSink sink(num_bitplanes, n / UINT8_BITS + sizeof(T_stream));
+            // level errors are accumulated block by block
+            BitplaneErrorAccumulator<T_fp> error_accumulator(num_bitplanes);
+            encode_blocks(reader, n, exp, num_bitplanes, sink, &error_accumulator);
+            // translate level errors, with the room left for negabinary format
+            level_errors = error_accumulator.get_level_errors(exp + 2);
+            return sink.finish(stream_sizes);
+        }
+
+        // encode data provided by a level reader into a level sink, with error collection
+        template<class Reader, class Sink>
+        void stream_encode_to_sink(Reader& reader, int32_t n, int32_t exp, uint8_t num_bitplanes, Sink& sink, std::vector<double>& level_errors) const {
+            BitplaneErrorAccumulator<T_fp> error_accumulator(num_bitplanes);
+            encode_blocks(reader, n, exp, num_bitplanes, sink, &error_accumulator);
+            level_errors = error_accumulator.get_level_errors(exp + 2);
+        }
+
+        T_data * decode(const std::vector<uint8_t const *>& streams, int32_t n, int exp, uint8_t num_bitplanes) {
+            T_data * data = (T_data *) malloc(n * sizeof(T_data));
+            ContiguousWriter<T_data> writer(data);
+            std::vector<RawBitplaneSource> sources(streams.begin(), streams.end());
+            std::vector<T_stream const *> streams_pos(streams.size());
             for(int i=0; i<streams.size(); i++){
-                streams_pos[i] = reinterpret_cast<T_stream*>(streams[i]);
+                streams_pos[i] = reinterpret_cast<T_stream const *>(streams[i]);
             }
-            T_data const * data_pos = data;
-            for(int i=0; i<n - block_size; i+=block_size){
-                for(int j=0; j<block_size; j++){
-                    T_data cur_data = *(data_pos++);
-                    T_data shifted_data = ldexp(cur_data, num_bitplanes - exp);
-                    int_data_buffer[j] = binary2negabinary((T_fps) shifted_data);
+            auto significant_bitplanes = extract_significant_bitplanes(sources, streams_pos);
+            decode_blocks(sources, streams_pos, n, exp, 0, num_bitplanes, significant_bitplanes.data(), writer);
+            return data;
+        }
+
+        // decode the data and record necessary information for progressiveness
+        T_data * progressive_decode(const std::vector<uint8_t const *>& streams, int32_t n, int exp, uint8_t starting_bitplane, uint8_t num_bitplanes, int level) {
+            T_data * data = (T_data *) malloc(n * sizeof(T_data));
+            ContiguousWriter<T_data> writer(data);
+            stream_progressive_decode(streams, n, exp, starting_bitplane, num_bitplanes, level, writer);
+            return data;
+        }
+
+        // decode the data and pass the decoded values to a level writer in the interleaved order
+        template<class Writer>
+        void stream_progressive_decode(const std::vector<uint8_t const *>& streams, int32_t n, int exp, uint8_t starting_bitplane, uint8_t num_bitplanes, int level, Writer& writer) {
+            std::vector<RawBitplaneSource> sources(streams.begin(), streams.end());
+            stream_progressive_decode_from_sources(sources, n, exp, starting_bitplane, num_bitplanes, level, writer);
+        }
+
+        // same as above, with the bitplanes read from sources (see BitplaneSource.hpp) every SOURCE_CHUNK_BLOCKS blocks
+        template<class Sources, class Writer>
+        void stream_progressive_decode_from_sources(Sources& sources, int32_t n, int exp, uint8_t starting_bitplane, uint8_t num_bitplanes, int level, Writer& writer) {
+            uint32_t block_size = block_size_based_on_bitplane_int_type<T_stream>();
+            if(num_bitplanes == 0){
+                std::vector<T_data> data_buffer(block_size, 0);
+                for(int i=0; i<n; i+=block_size){
+                    writer.write(data_buffer.data(), std::min((int32_t) block_size, n - i));
                 }
-                encode_block(int_data_buffer.data(), block_size, num_bitplanes, streams_pos);
+                return;
             }
-            // leftover
-            {
-                int rest_size = n % block_size;
-                if(rest_size == 0) rest_size = block_size;
-                for(int j=0; j<rest_size; j++){
-                    T_data cur_data = *(data_pos++);
-                    T_data shifted_data = ldexp(cur_data, num_bitplanes - exp);
-                    int_data_buffer[j] = binary2negabinary((T_fps) shifted_data);
-                }
-                encode_block(int_data_buffer.data(), rest_size, num_bitplanes, streams_pos);
+            std::vector<T_stream const *> streams_pos(sources.size());
+            for(int i=0; i<sources.size(); i++){
+                streams_pos[i] = reinterpret_cast<T_stream const *>(sources[i].begin());
             }
-            for(int i=0; i<num_bitplanes; i++){
-                stream_sizes[i] = reinterpret_cast<uint8_t*>(streams_pos[i]) - streams[i];
+            if(level_significant_bitplanes.size() <= level){
+                level_significant_bitplanes.resize(level + 1);
             }
-            return streams;
+            if(starting_bitplane == 0){
+                // the significance map comes with the first bitplane
+                level_significant_bitplanes[level] = extract_significant_bitplanes(sources, streams_pos);
+            }
+            decode_blocks(sources, streams_pos, n, exp, starting_bitplane, num_bitplanes, level_significant_bitplanes[level].data(), writer);
         }
 
-        // only differs in error collection
-        std::vector<uint8_t *> encode(T_data const * data, int32_t n, int32_t exp, uint8_t num_bitplanes, std::vector<uint32_t>& stream_sizes, std::vector<double>& level_errors) const {
+        // allocate the progressive decoding states of num_levels levels up front
+        void init_levels(int num_levels){
+            if(level_significant_bitplanes.size() < num_levels){
+                level_significant_bitplanes.resize(num_levels);
+            }
+        }
+
+        // release the progressive decoding state of a level, e.g. once all its bitplanes are decoded
+        void release_level(int level){
+            if(level < level_significant_bitplanes.size()){
+                level_significant_bitplanes[level] = std::vector<uint8_t>();
+            }
+        }
+
+        void print() const {
+            std::cout << "NegaBinary bitplane encoder" << std::endl;
+        }
+    private:
+        // define fixed point type
+        using T_fps = typename std::conditional<std::is_same<T_data, double>::value, int64_t, int32_t>::type;
+        using T_fp = typename std::conditional<std::is_same<T_data, double>::value, uint64_t, uint32_t>::type;
+
+        // encode the blocks of data provided by a level reader into a sink, and accumulate the level errors unless error_accumulator is NULL
+        // bitplanes other than the first are flushed to the sink every SINK_CHUNK_BLOCKS blocks,
+        // the first is kept as the significance map is merged in front of it
+        template<class Reader, class Sink>
+        void encode_blocks(Reader& reader, int32_t n, int32_t exp, uint8_t num_bitplanes, Sink& sink, BitplaneErrorAccumulator<T_fp> * error_accumulator) const {
             assert(num_bitplanes > 0);
+            const int SINK_CHUNK_BLOCKS = 4096;
             // leave room for negabinary format
             exp += 2;
             // determine block size based on bitplane integer type
             uint32_t block_size = block_size_based_on_bitplane_int_type<T_stream>();
-            std::vector<uint8_t> starting_bitplanes = std::vector<uint8_t>((n - 1)/block_size + 1, 0);
-            stream_sizes = std::vector<uint32_t>(num_bitplanes, 0);
-            // define fixed point type
-            using T_fps = typename std::conditional<std::is_same<T_data, double>::value, int64_t, int32_t>::type;
-            using T_fp = typename std::conditional<std::is_same<T_data, double>::value, uint64_t, uint32_t>::type;
+            // first significant bitplane of each block; the words of the leading all-zero bitplanes are not stored
+            std::vector<uint8_t> significant_bitplanes = std::vector<uint8_t>((n - 1)/block_size + 1, 0);
             std::vector<uint8_t *> streams;
-            for(int i=0; i<num_bitplanes; i++){
-                streams.push_back((uint8_t *) malloc(n / UINT8_BITS + sizeof(T_stream)));
+            streams.push_back((uint8_t *) malloc(n / UINT8_BITS + sizeof(T_stream)));
+            for(int i=1; i<num_bitplanes; i++){
+                streams.push_back((uint8_t *) malloc(SINK_CHUNK_BLOCKS * sizeof(T_stream)));
             }
             std::vector<T_fp> int_data_buffer(block_size, 0);
             std::vector<T_stream *> streams_pos(streams.size());
             for(int i=0; i<streams.size(); i++){
                 streams_pos[i] = reinterpret_cast<T_stream*>(streams[i]);
             }
-            // init level errors
-            level_errors.clear();
-            level_errors.resize(num_bitplanes + 1);
-            for(int i=0; i<level_errors.size(); i++){
-                level_errors[i] = 0;
-            }
-            T_data const * data_pos = data;
-            for(int i=0; i<n - block_size; i+=block_size){
-                for(int j=0; j<block_size; j++){
-                    T_data cur_data = *(data_pos++);
-                    T_data shifted_data = ldexp(cur_data, num_bitplanes - exp);
-                    T_fps signed_int_data = (T_fps) shifted_data;
-                    int_data_buffer[j] = binary2negabinary(signed_int_data);
-                    // compute level errors
-                    collect_level_errors(level_errors, int_data_buffer[j], shifted_data, shifted_data - signed_int_data, num_bitplanes);
+            auto flush = [&](){
+                for(int i=1; i<num_bitplanes; i++){
+                    sink.write(i, streams[i], reinterpret_cast<uint8_t*>(streams_pos[i]) - streams[i]);
+                    streams_pos[i] = reinterpret_cast<T_stream*>(streams[i]);
                 }
-                encode_block(int_data_buffer.data(), block_size, num_bitplanes, streams_pos);
-            }
-            // leftover
-            {
-                int rest_size = n % block_size;
-                if(rest_size == 0) rest_size = block_size;
-                for(int j=0; j<rest_size; j++){
+            };
+            std::vector<double> fraction_buffer(block_size, 0);
+            // data are read from the reader block by block
+            std::vector<T_data> data_buffer(block_size);
+            int block_id = 0;
+            for(int i=0; i<n; i+=block_size){
+                int cur_size = std::min((int) block_size, n - i);
+                reader.read(data_buffer.data(), cur_size);
+                T_data const * data_pos = data_buffer.data();
+                for(int j=0; j<cur_size; j++){
                     T_data cur_data = *(data_pos++);
                     T_data shifted_data = ldexp(cur_data, num_bitplanes - exp);
                     T_fps signed_int_data = (T_fps) shifted_data;
                     int_data_buffer[j] = binary2negabinary(signed_int_data);
-                    // compute level errors
-                    collect_level_errors(level_errors, int_data_buffer[j], shifted_data, shifted_data - signed_int_data, num_bitplanes);
+                    fraction_buffer[j] = shifted_data - signed_int_data;
                 }
-                encode_block(int_data_buffer.data(), rest_size, num_bitplanes, streams_pos);
-            }
-            for(int i=0; i<num_bitplanes; i++){
-                stream_sizes[i] = reinterpret_cast<uint8_t*>(streams_pos[i]) - streams[i];
+                // compute level errors
+                if(error_accumulator) error_accumulator->accumulate_negabinary(int_data_buffer.data(), fraction_buffer.data(), cur_size);
+                significant_bitplanes[block_id ++] = encode_block(int_data_buffer.data(), cur_size, num_bitplanes, streams_pos);
+                if(block_id % SINK_CHUNK_BLOCKS == 0) flush();
             }
-            // translate level errors
-            for(int i=0; i<level_errors.size(); i++){
-                level_errors[i] = ldexp(level_errors[i], 2*(- num_bitplanes + exp));
-            }
-            return streams;
-        }
-
-        T_data * decode(const std::vector<uint8_t const *>& streams, int32_t n, int exp, uint8_t num_bitplanes) {
-            return progressive_decode(streams, n, exp, 0, num_bitplanes, streams.size());
-        }
-
-        // decode the data and record necessary information for progressiveness
-        T_data * progressive_decode(const std::vector<uint8_t const *>& streams, int32_t n, int exp, uint8_t starting_bitplane, uint8_t num_bitplanes, int level) {
-            uint32_t block_size = block_size_based_on_bitplane_int_type<T_stream>();
-            T_data * data = (T_data *) malloc(n * sizeof(T_data));
-            if(num_bitplanes == 0){
-                memset(data, 0, n * sizeof(T_data));
-                return data;
-            }
-            // leave room for negabinary format
-            exp += 2;
-            // define fixed point type
-            using T_fps = typename std::conditional<std::is_same<T_data, double>::value, int64_t, int32_t>::type;
-            using T_fp = typename std::conditional<std::is_same<T_data, double>::value, uint64_t, uint32_t>::type;
-            std::vector<T_stream const *> streams_pos(streams.size());
+            flush();
+            // merge the significance map with the first bitplane
+            uint32_t merged_size = 0;
+            uint8_t * merged = merge_arrays(significant_bitplanes.data(), significant_bitplanes.size() * sizeof(uint8_t), streams[0], reinterpret_cast<uint8_t*>(streams_pos[0]) - streams[0], merged_size);
+            sink.write(0, merged, merged_size);
+            free(merged);
             for(int i=0; i<streams.size(); i++){
-                streams_pos[i] = reinterpret_cast<T_stream const *>(streams[i]);
-            }
-            std::vector<T_fp> int_data_buffer(block_size, 0);
-            // decode
-            const uint8_t ending_bitplane = starting_bitplane + num_bitplanes;
-            T_data * data_pos = data;
-            // std::cout << "ending_bitplane = " << +ending_bitplane << std::endl;
-            if(ending_bitplane % 2 == 0){
-                for(int i=0; i<n - block_size; i+=block_size){
-                    memset(int_data_buffer.data(), 0, block_size * sizeof(T_fp));
-                    decode_block(streams_pos, block_size, num_bitplanes, int_data_buffer.data());
-                    for(int j=0; j<block_size; j++){
-                        *(data_pos++) = ldexp((T_data) negabinary2binary(int_data_buffer[j]), - ending_bitplane + exp);
-                    }
-                }
-                // leftover
-                {
-                    int rest_size = n % block_size;
-                    if(rest_size == 0) rest_size = block_size;
-                    memset(int_data_buffer.data(), 0, rest_size * sizeof(T_fp));
-                    decode_block(streams_pos, rest_size, num_bitplanes, int_data_buffer.data());
-                    for(int j=0; j<rest_size; j++){
-                        *(data_pos++) = ldexp((T_data) negabinary2binary(int_data_buffer[j]), - ending_bitplane + exp);
-                    }
-                }                
+                free(streams[i]);
             }
-            else{
-                for(int i=0; i<n - block_size; i+=block_size){
-                    memset(int_data_buffer.data(), 0, block_size * sizeof(T_fp));
-                    decode_block(streams_pos, block_size, num_bitplanes, int_data_buffer.data());
-                    for(int j=0; j<block_size; j++){
-                        *(data_pos++) = - ldexp((T_data) negabinary2binary(int_data_buffer[j]), - ending_bitplane + exp);
-                    }
-                }
-                // leftover
-                {
-                    int rest_size = n % block_size;
-                    if(rest_size == 0) rest_size = block_size;
-                    memset(int_data_buffer.data(), 0, rest_size * sizeof(T_fp));
-                    decode_block(streams_pos, rest_size, num_bitplanes, int_data_buffer.data());
-                    for(int j=0; j<rest_size; j++){
-                        *(data_pos++) = - ldexp((T_data) negabinary2binary(int_data_buffer[j]), - ending_bitplane + exp);
-                    }
-                }                
-            }
-            return data;
         }
 
-        void print() const {
-            std::cout << "NegaBinary bitplane encoder" << std::endl;
-        }
-    private:
         template<class T>
         uint32_t block_size_based_on_bitplane_int_type() const {
             uint32_t block_size = 0;
@@ -228,36 +229,86 @@ namespace MDR {
         inline int32_t negabinary2binary(const uint32_t x) const {
             return (x ^0xaaaaaaaau) - 0xaaaaaaaau;
         }
-        inline void collect_level_errors(std::vector<double>& level_errors, uint32_t negabinary_data, float data, float mantissa, int num_bitplanes) const {
-            level_errors[num_bitplanes] += mantissa * mantissa;
-            for(int k=1; k<num_bitplanes; k++){
-                uint32_t mask = (1 << k) - 1;
-                double diff = (double) negabinary2binary(negabinary_data & mask) + mantissa;
-                level_errors[num_bitplanes - k] += diff * diff;
+        // decode bitplanes [starting_bitplane, starting_bitplane + num_bitplanes) block by block
+        // blocks whose first significant bitplane is not reached yet are 0 and read no words
+        template<class Sources, class Writer>
+        void decode_blocks(Sources& sources, std::vector<T_stream const *>& streams_pos, int32_t n, int exp, uint8_t starting_bitplane, uint8_t num_bitplanes, uint8_t const * significant_bitplanes, Writer& writer) const {
+            uint32_t block_size = block_size_based_on_bitplane_int_type<T_stream>();
+            // leave room for negabinary format
+            exp += 2;
+            using T_fp = typename std::conditional<std::is_same<T_data, double>::value, uint64_t, uint32_t>::type;
+            std::vector<T_fp> int_data_buffer(block_size, 0);
+            std::vector<T_data> data_buffer(block_size, 0);
+            const uint8_t ending_bitplane = starting_bitplane + num_bitplanes;
+            // the sign of negabinary values alternates with the parity of the last bitplane
+            const T_data sign = (ending_bitplane % 2 == 0) ? 1 : -1;
+            int block_id = 0;
+            for(int i=0; i<n; i+=block_size){
+                // a block reads at most a value from each bitplane
+                if(block_id % SOURCE_CHUNK_BLOCKS == 0) ensure_sources(sources, streams_pos, SOURCE_CHUNK_BLOCKS * sizeof(T_stream));
+                int size = std::min((int32_t) block_size, n - i);
+                uint8_t significant_bitplane = std::max(significant_bitplanes[block_id ++], starting_bitplane);
+                if(significant_bitplane < ending_bitplane){
+                    memset(int_data_buffer.data(), 0, block_size * sizeof(T_fp));
+                    decode_block(streams_pos, size, significant_bitplane - starting_bitplane, ending_bitplane - significant_bitplane, int_data_buffer.data());
+                    for(int j=0; j<size; j++){
+                        data_buffer[j] = sign * ldexp((T_data) negabinary2binary(int_data_buffer[j]), - ending_bitplane + exp);
+                    }
+                }
+                else{
+                    memset(data_buffer.data(), 0, size * sizeof(T_data));
+                }
+                writer.write(data_buffer.data(), size);
             }
-            level_errors[0] += data * data;
         }
+        // encode the bitplanes from the first significant one, which is returned (num_bitplanes if all are 0)
         template <class T_int>
-        inline void encode_block(T_int const * data, size_t n, uint8_t num_bitplanes, std::vector<T_stream *>& streams_pos) const {
+        inline uint8_t encode_block(T_int const * data, size_t n, uint8_t num_bitplanes, std::vector<T_stream *>& streams_pos) const {
+            uint8_t significant_bitplane = num_bitplanes;
             for(int k=num_bitplanes - 1; k>=0; k--){
                 T_stream bitplane_value = 0;
                 T_stream bitplane_index = num_bitplanes - 1 - k;
                 for (int i=0; i<n; i++){
                     bitplane_value += (T_stream)((data[i] >> k) & 1u) << i;
                 }
-                *(streams_pos[bitplane_index] ++) = bitplane_value;
+                if(bitplane_value || (significant_bitplane < num_bitplanes)){
+                    if(significant_bitplane == num_bitplanes) significant_bitplane = bitplane_index;
+                    *(streams_pos[bitplane_index] ++) = bitplane_value;
+                }
             }
+            return significant_bitplane;
         }
+        // decode num_bitplanes bitplanes from the stream of index first_bitplane
         template <class T_int>
-        inline void decode_block(std::vector<T_stream const *>& streams_pos, size_t n, uint8_t num_bitplanes, T_int * data) const {
+        inline void decode_block(std::vector<T_stream const *>& streams_pos, size_t n, uint8_t first_bitplane, uint8_t num_bitplanes, T_int * data) const {
             for(int k=num_bitplanes - 1; k>=0; k--){
-                T_stream bitplane_index = num_bitplanes - 1 - k;
+                T_stream bitplane_index = first_bitplane + num_bitplanes - 1 - k;
                 T_stream bitplane_value = *(streams_pos[bitplane_index] ++);
                 for (int i=0; i<n; i++){
                     data[i] += ((bitplane_value >> i) & 1u) << k;
                 }
             }
         }
+        // read the significance map in front of the first bitplane and move the first stream past it
+        template<class Sources>
+        std::vector<uint8_t> extract_significant_bitplanes(Sources& sources, std::vector<T_stream const *>& streams_pos) const {
+            uint8_t const * first_pos = sources[0].ensure(reinterpret_cast<uint8_t const*>(streams_pos[0]), sizeof(uint32_t));
+            uint32_t map_size = *reinterpret_cast<uint32_t const*>(first_pos);
+            first_pos = sources[0].ensure(first_pos, sizeof(uint32_t) + map_size);
+            uint8_t const * map_pos = first_pos + sizeof(uint32_t);
+            streams_pos[0] = reinterpret_cast<T_stream const *>(map_pos + map_size);
+            return std::vector<uint8_t>(map_pos, map_pos + map_size);
+        }
+        uint8_t * merge_arrays(uint8_t const * array1, uint32_t size1, uint8_t const * array2, uint32_t size2, uint32_t& merged_size) const {
+            merged_size = sizeof(uint32_t) + size1 + size2;
+            uint8_t * merged_array = (uint8_t *) malloc(merged_size);
+            *reinterpret_cast<uint32_t*>(merged_array) = size1;
+            memcpy(merged_array + sizeof(uint32_t), array1, size1);
+            memcpy(merged_array + sizeof(uint32_t) + size1, array2, size2);
+            return merged_array;
+        }
+
+        std::vector<std::vector<uint8_t>> level_significant_bitplanes;
     };
 }
 #endif
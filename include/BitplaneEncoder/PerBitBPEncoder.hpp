@@ -2,8 +2,34 @@
 #define _MDR_PERBIT_BP_ENCODER_HPP
 
 #include "BitplaneEncoderInterface.hpp"
-#include <bitset>
+#include "ErrorCollector/BitplaneErrorAccumulator.hpp"
+#include "Interleaver/LevelReader.hpp"
+#include "Interleaver/LevelWriter.hpp"
+#include "BitplaneSource.hpp"
+#ifdef __BMI2__
+#include <immintrin.h>
+#endif
 namespace MDR {
+#ifdef __BMI2__
+    // spread the 32 bits of x to the even bits of the result
+    inline uint64_t spread_bits(uint32_t x){
+        return _pdep_u64(x, 0x5555555555555555ULL);
+    }
+#endif
+
+    // transpose a 32x32 bit matrix in place: bit k of word j becomes bit j of word k
+    inline void transpose_bits(uint32_t * words){
+        uint32_t mask = 0x0000FFFFu;
+        for(int width=16; width; width >>= 1, mask ^= mask << width){
+            for(int j=0; j<32; j=(j + width + 1) & ~width){
+                uint32_t t = ((words[j] >> width) ^ words[j + width]) & mask;
+                words[j] ^= t << width;
+                words[j + width] ^= t;
+            }
+        }
+    }
+
+    // bit writer filling a stream of 64-bit words from the lowest bit
     class BitEncoder{
     public:
         BitEncoder(uint64_t * stream_begin_pos){
@@ -12,15 +38,19 @@ namespace MDR {
             buffer = 0;
             position = 0;
         }
-        void encode(uint64_t b){
-            buffer += b << position;
-            position ++;
-            if(position == 64){
+        // append the len (1 to 64) lowest bits of b, whose higher bits are 0
+        inline void encode(uint64_t b, int len){
+            buffer |= b << position;
+            position += len;
+            if(position >= 64){
                 *(stream_pos ++) = buffer;
-                buffer = 0;
-                position = 0;
+                position -= 64;
+                buffer = position ? b >> (len - position) : 0;
             }
         }
+        inline void encode(uint64_t b){
+            encode(b, 1);
+        }
         void flush(){
             if(position){
                 *(stream_pos ++) = buffer;
@@ -33,11 +63,12 @@ namespace MDR {
         }
     private:
         uint64_t buffer = 0;
-        uint8_t position = 0;
+        int position = 0;
         uint64_t * stream_pos = NULL;
         uint64_t * stream_begin = NULL;
     };
 
+    // bit reader of the streams written by BitEncoder; words are only loaded when their bits are read
     class BitDecoder{
     public:
         BitDecoder(uint64_t const * stream_begin_pos){
@@ -46,28 +77,51 @@ namespace MDR {
             buffer = 0;
             position = 0;
         }
-        uint8_t decode(){
-            if(position == 0){
-                buffer = *(stream_pos ++);
-                position = 64;
+        // read len (1 to 64) bits
+        inline uint64_t decode(int len){
+            uint64_t b = buffer;
+            if(len <= position){
+                buffer = (len < 64) ? buffer >> len : 0;
+                position -= len;
             }
-            uint8_t b = buffer & 1u;
-            buffer >>= 1;
-            position --;
-            return b;
+            else{
+                uint64_t next = *(stream_pos ++);
+                b |= next << position;
+                int used = len - position;
+                buffer = (used < 64) ? next >> used : 0;
+                position = 64 - used;
+            }
+            return (len < 64) ? b & ((1ULL << len) - 1) : b;
+        }
+        inline uint8_t decode(){
+            return decode(1);
+        }
+        // the next 64 bits without reading them, which requires at least 64 bits left in the stream
+        inline uint64_t peek() const {
+            return (position < 64) ? buffer | (*stream_pos << position) : buffer;
         }
         uint32_t size(){
             return (stream_pos - stream_begin);
         }
+        // next word to be read, which can be moved along with the stream (see BitplaneSource.hpp)
+        uint64_t const * next_word() const {
+            return stream_pos;
+        }
+        void move_next_word(uint64_t const * pos){
+            stream_begin += pos - stream_pos;
+            stream_pos = pos;
+        }
     private:
         uint64_t buffer = 0;
-        uint8_t position = 0;
+        int position = 0;
         uint64_t const * stream_pos = NULL;
         uint64_t const * stream_begin = NULL;
     };
 
-    #define PER_BIT_BLOCK_SIZE 1
-    // per bit bitplane encoder that encodes data by bit using T_stream type buffer
+    #define PER_BIT_BLOCK_SIZE 32
+    // per bit bitplane encoder: a bitplane has a bit for every value, followed by the sign of the value if the bit
+    // is its first nonzero one; blocks of PER_BIT_BLOCK_SIZE values are transposed to one word per bitplane,
+    // and the bits and signs of a block in a bitplane are written or read with a few word operations
     template<class T_data, class T_stream>
     class PerBitBPEncoder : public concepts::BitplaneEncoderInterface<T_data> {
     public:
@@ -79,80 +133,159 @@ namespace MDR {
         }
 
         std::vector<uint8_t *> encode(T_data const * data, int32_t n, int32_t exp, uint8_t num_bitplanes, std::vector<uint32_t>& stream_sizes) const {
-            assert(num_bitplanes > 0);
-            // determine block size based on bitplane integer type
-            const int32_t block_size = PER_BIT_BLOCK_SIZE;
-            stream_sizes = std::vector<uint32_t>(num_bitplanes, 0);
-            // define fixed point type
-            using T_fp = typename std::conditional<std::is_same<T_data, double>::value, uint64_t, uint32_t>::type;
-            std::vector<uint8_t *> streams;
-            for(int i=0; i<num_bitplanes; i++){
-                streams.push_back((uint8_t *) malloc(2 * n / UINT8_BITS + sizeof(uint64_t)));
-            }
-            std::vector<BitEncoder> encoders;
+            ContiguousReader<T_data> reader(data);
+            return stream_encode(reader, n, exp, num_bitplanes, stream_sizes);
+        }
+
+        // encode data provided by a level reader
+        template<class Reader>
+        std::vector<uint8_t *> stream_encode(Reader& reader, int32_t n, int32_t exp, uint8_t num_bitplanes, std::vector<uint32_t>& stream_sizes) const {
+            return encode_blocks(reader, n, exp, num_bitplanes, stream_sizes, NULL);
+        }
+
+        // only differs in error collection
+        std::vector<uint8_t *> encode(T_data const * data, int32_t n, int32_t exp, uint8_t num_bitplanes, std::vector<uint32_t>& stream_sizes, std::vector<double>& level_errors) const {
+            ContiguousReader<T_data> reader(data);
+            return stream_encode(reader, n, exp, num_bitplanes, stream_sizes, level_errors);
+        }
+
+        // encode data provided by a level reader, with error collection
+        template<class Reader>
+        std::vector<uint8_t *> stream_encode(Reader& reader, int32_t n, int32_t exp, uint8_t num_bitplanes, std::vector<uint32_t>& stream_sizes, std::vector<double>& level_errors) const {
+            // level errors are accumulated block by block
+            BitplaneErrorAccumulator<T_fp> error_accumulator(num_bitplanes);
+            auto streams = encode_blocks(reader, n, exp, num_bitplanes, stream_sizes, &error_accumulator);
+            // translate level errors
+            level_errors = error_accumulator.get_level_errors(exp);
+            return streams;
+        }
+
+        // encode data provided by a level reader into a level sink, with error collection
+        // the bitplanes are written to the sink once the level is encoded
+        template<class Reader, class Sink>
+        void stream_encode_to_sink(Reader& reader, int32_t n, int32_t exp, uint8_t num_bitplanes, Sink& sink, std::vector<double>& level_errors) const {
+            std::vector<uint32_t> stream_sizes;
+            auto streams = stream_encode(reader, n, exp, num_bitplanes, stream_sizes, level_errors);
             for(int i=0; i<streams.size(); i++){
-                encoders.push_back(BitEncoder(reinterpret_cast<uint64_t*>(streams[i])));
+                sink.write(i, streams[i], stream_sizes[i]);
+                free(streams[i]);
             }
-            T_data const * data_pos = data;
-            for(int i=0; i<n - block_size; i+=block_size){
-                T_stream sign_bitplane = 0;
-                for(int j=0; j<block_size; j++){
-                    T_data cur_data = *(data_pos++);
-                    T_data shifted_data = ldexp(cur_data, num_bitplanes - exp);
-                    bool sign = cur_data < 0;
-                    int64_t fix_point = (int64_t) shifted_data;
-                    T_fp fp_data = sign ? -fix_point : +fix_point;
-                    // compute level errors
-                    bool first_bit = true;
-                    for(int k=num_bitplanes - 1; k>=0; k--){
-                        uint8_t index = num_bitplanes - 1 - k;
-                        uint8_t bit = (fp_data >> k) & 1u;
-                        encoders[index].encode(bit);
-                        if(bit && first_bit){
-                            encoders[index].encode(sign);
-                            first_bit = false;
-                        }
-                    }                    
-                }
+        }
+
+        T_data * decode(const std::vector<uint8_t const *>& streams, int32_t n, int exp, uint8_t num_bitplanes) {
+            T_data * data = (T_data *) malloc(n * sizeof(T_data));
+            if(num_bitplanes == 0){
+                memset(data, 0, n * sizeof(T_data));
+                return data;
             }
-            // leftover
-            {
-                int rest_size = n % block_size;
-                if(rest_size == 0) rest_size = block_size;
-                for(int j=0; j<rest_size; j++){
-                    T_data cur_data = *(data_pos++);
-                    T_data shifted_data = ldexp(cur_data, num_bitplanes - exp);
-                    bool sign = cur_data < 0;
-                    int64_t fix_point = (int64_t) shifted_data;
-                    T_fp fp_data = sign ? -fix_point : +fix_point;
-                    // compute level errors
-                    bool first_bit = true;
-                    for(int k=num_bitplanes - 1; k>=0; k--){
-                        uint8_t index = num_bitplanes - 1 - k;
-                        uint8_t bit = (fp_data >> k) & 1u;
-                        encoders[index].encode(bit);
-                        if(bit && first_bit){
-                            encoders[index].encode(sign);
-                            first_bit = false;
-                        }
-                    }                    
+            LevelState state(n);
+            ContiguousWriter<T_data> writer(data);
+            std::vector<RawBitplaneSource> sources(streams.begin(), streams.end());
+            decode_blocks(sources, n, exp, 0, num_bitplanes, state, writer);
+            return data;
+        }
+
+        T_data * progressive_decode(const std::vector<uint8_t const *>& streams, int32_t n, int exp, uint8_t starting_bitplane, uint8_t num_bitplanes, int level) {
+            T_data * data = (T_data *) malloc(n * sizeof(T_data));
+            ContiguousWriter<T_data> writer(data);
+            stream_progressive_decode(streams, n, exp, starting_bitplane, num_bitplanes, level, writer);
+            return data;
+        }
+
+        // decode the data and pass the decoded values to a level writer in the interleaved order
+        template<class Writer>
+        void stream_progressive_decode(const std::vector<uint8_t const *>& streams, int32_t n, int exp, uint8_t starting_bitplane, uint8_t num_bitplanes, int level, Writer& writer) {
+            std::vector<RawBitplaneSource> sources(streams.begin(), streams.end());
+            stream_progressive_decode_from_sources(sources, n, exp, starting_bitplane, num_bitplanes, level, writer);
+        }
+
+        // same as above, with the bitplanes read from sources (see BitplaneSource.hpp) every SOURCE_CHUNK_BLOCKS blocks
+        template<class Sources, class Writer>
+        void stream_progressive_decode_from_sources(Sources& sources, int32_t n, int exp, uint8_t starting_bitplane, uint8_t num_bitplanes, int level, Writer& writer) {
+            const int32_t block_size = PER_BIT_BLOCK_SIZE;
+            if(num_bitplanes == 0){
+                std::vector<T_data> data_buffer(block_size, 0);
+                for(int i=0; i<n; i+=block_size){
+                    writer.write(data_buffer.data(), std::min(block_size, n - i));
                 }
+                return;
             }
-            for(int i=0; i<num_bitplanes; i++){
-                encoders[i].flush();
-                stream_sizes[i] = encoders[i].size() * sizeof(uint64_t);
+            if(level_states.size() <= level){
+                level_states.resize(level + 1);
             }
-            return streams;
+            if(starting_bitplane == 0){
+                level_states[level] = LevelState(n);
+            }
+            decode_blocks(sources, n, exp, starting_bitplane, num_bitplanes, level_states[level], writer);
         }
 
-        // only differs in error collection
-        std::vector<uint8_t *> encode(T_data const * data, int32_t n, int32_t exp, uint8_t num_bitplanes, std::vector<uint32_t>& stream_sizes, std::vector<double>& level_errors) const {
+        // allocate the progressive decoding states of num_levels levels up front
+        void init_levels(int num_levels){
+            if(level_states.size() < num_levels){
+                level_states.resize(num_levels);
+            }
+        }
+
+        // release the progressive decoding state of a level, e.g. once all its bitplanes are decoded
+        void release_level(int level){
+            if(level < level_states.size()){
+                level_states[level] = LevelState();
+            }
+        }
+
+        void print() const {
+            std::cout << "Per-bit bitplane encoder" << std::endl;
+        }
+    private:
+        // define fixed point type
+        using T_fp = typename std::conditional<std::is_same<T_data, double>::value, uint64_t, uint32_t>::type;
+
+        // progressive decoding state of a level: whether the sign of each value is decoded, and the sign,
+        // packed in one word per block
+        struct LevelState {
+            LevelState(){}
+            LevelState(int32_t n) : significance((n - 1) / PER_BIT_BLOCK_SIZE + 1, 0), signs((n - 1) / PER_BIT_BLOCK_SIZE + 1, 0) {}
+            std::vector<uint32_t> significance;
+            std::vector<uint32_t> signs;
+        };
+
+        // transpose a block of fixed points to one word per bitplane, bitplane k being bitplanes[k]
+        inline void to_bitplanes(uint32_t const * data, uint32_t * bitplanes) const {
+            memcpy(bitplanes, data, PER_BIT_BLOCK_SIZE * sizeof(uint32_t));
+            transpose_bits(bitplanes);
+        }
+        inline void to_bitplanes(uint64_t const * data, uint32_t * bitplanes) const {
+            for(int j=0; j<PER_BIT_BLOCK_SIZE; j++){
+                bitplanes[j] = (uint32_t) data[j];
+                bitplanes[PER_BIT_BLOCK_SIZE + j] = (uint32_t) (data[j] >> 32);
+            }
+            transpose_bits(bitplanes);
+            transpose_bits(bitplanes + PER_BIT_BLOCK_SIZE);
+        }
+        // the inverse of to_bitplanes
+        inline void from_bitplanes(uint32_t const * bitplanes, uint32_t * data) const {
+            memcpy(data, bitplanes, PER_BIT_BLOCK_SIZE * sizeof(uint32_t));
+            transpose_bits(data);
+        }
+        inline void from_bitplanes(uint32_t const * bitplanes, uint64_t * data) const {
+            uint32_t words[2 * PER_BIT_BLOCK_SIZE];
+            memcpy(words, bitplanes, 2 * PER_BIT_BLOCK_SIZE * sizeof(uint32_t));
+            transpose_bits(words);
+            transpose_bits(words + PER_BIT_BLOCK_SIZE);
+            for(int j=0; j<PER_BIT_BLOCK_SIZE; j++){
+                data[j] = words[j] | ((uint64_t) words[PER_BIT_BLOCK_SIZE + j] << 32);
+            }
+        }
+
+        inline uint32_t block_mask(int n) const {
+            return (n < 32) ? (1u << n) - 1 : ~0u;
+        }
+
+        template<class Reader>
+        std::vector<uint8_t *> encode_blocks(Reader& reader, int32_t n, int32_t exp, uint8_t num_bitplanes, std::vector<uint32_t>& stream_sizes, BitplaneErrorAccumulator<T_fp> * error_accumulator) const {
             assert(num_bitplanes > 0);
-            // determine block size based on bitplane integer type
             const int32_t block_size = PER_BIT_BLOCK_SIZE;
             stream_sizes = std::vector<uint32_t>(num_bitplanes, 0);
-            // define fixed point type
-            using T_fp = typename std::conditional<std::is_same<T_data, double>::value, uint64_t, uint32_t>::type;
             std::vector<uint8_t *> streams;
             for(int i=0; i<num_bitplanes; i++){
                 streams.push_back((uint8_t *) malloc(2 * n / UINT8_BITS + sizeof(uint64_t)));
@@ -161,243 +294,167 @@ namespace MDR {
             for(int i=0; i<streams.size(); i++){
                 encoders.push_back(BitEncoder(reinterpret_cast<uint64_t*>(streams[i])));
             }
-            // init level errors
-            level_errors.clear();
-            level_errors.resize(num_bitplanes + 1);
-            for(int i=0; i<level_errors.size(); i++){
-                level_errors[i] = 0;
-            }
-            T_data const * data_pos = data;
-            for(int i=0; i<n - block_size; i+=block_size){
-                T_stream sign_bitplane = 0;
-                for(int j=0; j<block_size; j++){
-                    T_data cur_data = *(data_pos++);
+            // values past the end of the last block are 0
+            std::vector<T_fp> int_data_buffer(block_size, 0);
+            std::vector<double> fraction_buffer(block_size, 0);
+            // data are read from the reader block by block
+            std::vector<T_data> data_buffer(block_size);
+            for(int i=0; i<n; i+=block_size){
+                int cur_size = std::min(block_size, n - i);
+                reader.read(data_buffer.data(), cur_size);
+                uint32_t signs = 0;
+                for(int j=0; j<cur_size; j++){
+                    T_data cur_data = data_buffer[j];
                     T_data shifted_data = ldexp(cur_data, num_bitplanes - exp);
                     bool sign = cur_data < 0;
                     int64_t fix_point = (int64_t) shifted_data;
-                    T_fp fp_data = sign ? -fix_point : +fix_point;
-                    // compute level errors
-                    collect_level_errors(level_errors, fabs(shifted_data), num_bitplanes);
-                    bool first_bit = true;
-                    for(int k=num_bitplanes - 1; k>=0; k--){
-                        uint8_t index = num_bitplanes - 1 - k;
-                        uint8_t bit = (fp_data >> k) & 1u;
-                        encoders[index].encode(bit);
-                        if(bit && first_bit){
-                            encoders[index].encode(sign);
-                            first_bit = false;
-                        }
-                    }                    
+                    int_data_buffer[j] = sign ? -fix_point : +fix_point;
+                    fraction_buffer[j] = fabs(shifted_data - fix_point);
+                    signs |= (uint32_t) sign << j;
                 }
-            }
-            // leftover
-            {
-                int rest_size = n % block_size;
-                if(rest_size == 0) rest_size = block_size;
-                for(int j=0; j<rest_size; j++){
-                    T_data cur_data = *(data_pos++);
-                    T_data shifted_data = ldexp(cur_data, num_bitplanes - exp);
-                    bool sign = cur_data < 0;
-                    int64_t fix_point = (int64_t) shifted_data;
-                    T_fp fp_data = sign ? -fix_point : +fix_point;
-                    // compute level errors
-                    collect_level_errors(level_errors, fabs(shifted_data), num_bitplanes);
-                    bool first_bit = true;
-                    for(int k=num_bitplanes - 1; k>=0; k--){
-                        uint8_t index = num_bitplanes - 1 - k;
-                        uint8_t bit = (fp_data >> k) & 1u;
-                        encoders[index].encode(bit);
-                        if(bit && first_bit){
-                            encoders[index].encode(sign);
-                            first_bit = false;
-                        }
-                    }                    
+                for(int j=cur_size; j<block_size; j++){
+                    int_data_buffer[j] = 0;
                 }
+                // compute level errors
+                if(error_accumulator) error_accumulator->accumulate(int_data_buffer.data(), fraction_buffer.data(), cur_size);
+                encode_block(int_data_buffer.data(), cur_size, num_bitplanes, signs, encoders);
             }
             for(int i=0; i<num_bitplanes; i++){
                 encoders[i].flush();
                 stream_sizes[i] = encoders[i].size() * sizeof(uint64_t);
             }
-            // translate level errors
-            for(int i=0; i<level_errors.size(); i++){
-                level_errors[i] = ldexp(level_errors[i], 2*(- num_bitplanes + exp));
-            }
             return streams;
         }
 
-        T_data * decode(const std::vector<uint8_t const *>& streams, int32_t n, int exp, uint8_t num_bitplanes) {
-            const int32_t block_size = PER_BIT_BLOCK_SIZE;
-            // define fixed point type
-            using T_fp = typename std::conditional<std::is_same<T_data, double>::value, uint64_t, uint32_t>::type;
-            T_data * data = (T_data *) malloc(n * sizeof(T_data));
-            if(num_bitplanes == 0){
-                memset(data, 0, n * sizeof(T_data));
-                return data;
+        // write the bits of a block to every bitplane
+        inline void encode_block(T_fp const * data, int n, uint8_t num_bitplanes, uint32_t signs, std::vector<BitEncoder>& encoders) const {
+            uint32_t bitplanes[sizeof(T_fp) * UINT8_BITS];
+            to_bitplanes(data, bitplanes);
+            uint32_t significance = 0;
+            for(int k=num_bitplanes - 1; k>=0; k--){
+                uint32_t bitplane = bitplanes[k];
+                uint32_t new_significance = bitplane & ~significance;
+                significance |= bitplane;
+                BitEncoder& encoder = encoders[num_bitplanes - 1 - k];
+                if(new_significance == 0){
+                    encoder.encode(bitplane, n);
+                }
+                else{
+                #ifdef __BMI2__
+                    // pair every bit with a sign slot, and keep the slots of the values becoming significant
+                    uint64_t interleaved = spread_bits(bitplane) | (spread_bits(signs & new_significance) << 1);
+                    uint64_t mask = 0x5555555555555555ULL | (spread_bits(new_significance) << 1);
+                    encoder.encode(_pext_u64(interleaved, mask), n + __builtin_popcount(new_significance));
+                #else
+                    // write the bits in runs ending with a value becoming significant, followed by its sign
+                    int j = 0;
+                    while(new_significance){
+                        int length = __builtin_ctz(new_significance) + 1 - j;
+                        encoder.encode((bitplane >> j) & ((1ULL << length) - 1), length);
+                        encoder.encode((signs >> (j + length - 1)) & 1u, 1);
+                        j += length;
+                        new_significance &= new_significance - 1;
+                    }
+                    if(j < n) encoder.encode(bitplane >> j, n - j);
+                #endif
+                }
             }
-            std::vector<BitDecoder> decoders;
-            for(int i=0; i<streams.size(); i++){
-                decoders.push_back(BitDecoder(reinterpret_cast<uint64_t const*>(streams[i])));
-                decoders[i].size();
+        }
+
+        // read the bits of a block in a bitplane, and the signs of the values becoming significant
+        // peeking is allowed when at least 64 values are left, as every value has a bit in each bitplane
+        inline uint32_t decode_bitplane(BitDecoder& decoder, int n, uint32_t insignificant, uint32_t& signs, bool can_peek) const {
+            if(insignificant == 0){
+                return decoder.decode(n);
             }
-            // decode
-            T_data * data_pos = data;
-            for(int i=0; i<n - block_size; i+=block_size){
-                for(int j=0; j<block_size; j++){
-                    T_fp fp_data = 0;
-                    // decode each bit of the data for each level component
-                    bool first_bit = true;
-                    bool sign = false;
-                    for(int k=num_bitplanes - 1; k>=0; k--){
-                        uint8_t index = num_bitplanes - 1 - k;
-                        uint8_t bit = decoders[index].decode();
-                        fp_data += bit << k;
-                        if(bit && first_bit){
-                            // decode sign
-                            sign = decoders[index].decode();
-                            first_bit = false;
-                        }
+            uint32_t bitplane = 0;
+            if(can_peek){
+                // bits of consecutive values are contiguous up to the next value becoming significant,
+                // so the window is copied in runs ending with a sign
+                uint64_t bits = decoder.peek();
+                int position = 0;
+                int j = 0;
+                while(j < n){
+                    uint64_t run = bits >> position;
+                    uint64_t new_significance = run & (insignificant >> j) & ((1ULL << (n - j)) - 1);
+                    if(new_significance == 0){
+                        bitplane |= (uint32_t) (run & ((1ULL << (n - j)) - 1)) << j;
+                        position += n - j;
+                        break;
                     }
-                    T_data cur_data = ldexp((T_data)fp_data, - num_bitplanes + exp);
-                    *(data_pos++) = sign ? -cur_data : cur_data;
+                    int length = __builtin_ctzll(new_significance) + 1;
+                    bitplane |= (uint32_t) (run & ((1ULL << length) - 1)) << j;
+                    signs |= (uint32_t) ((run >> length) & 1u) << (j + length - 1);
+                    position += length + 1;
+                    j += length;
                 }
+                decoder.decode(position);
+                return bitplane;
             }
-            // leftover
-            {
-                int rest_size = n % block_size;
-                if(rest_size == 0) rest_size = block_size;
-                for(int j=0; j<rest_size; j++){
-                    T_fp fp_data = 0;
-                    // decode each bit of the data for each level component
-                    bool first_bit = true;
-                    bool sign = false;
-                    for(int k=num_bitplanes - 1; k>=0; k--){
-                        uint8_t index = num_bitplanes - 1 - k;
-                        uint8_t bit = decoders[index].decode();
-                        fp_data += bit << k;
-                        if(bit && first_bit){
-                            // decode sign
-                            sign = decoders[index].decode();
-                            first_bit = false;
-                        }
-                    }
-                    T_data cur_data = ldexp((T_data)fp_data, - num_bitplanes + exp);
-                    *(data_pos++) = sign ? -cur_data : cur_data;
+            for(int j=0; j<n; j++){
+                uint32_t bit = decoder.decode(1);
+                bitplane |= bit << j;
+                if(bit & (insignificant >> j)){
+                    signs |= (uint32_t) decoder.decode(1) << j;
                 }
             }
-            return data;
+            return bitplane;
         }
 
-        T_data * progressive_decode(const std::vector<uint8_t const *>& streams, int32_t n, int exp, uint8_t starting_bitplane, uint8_t num_bitplanes, int level) {
+        // decode bitplanes [starting_bitplane, starting_bitplane + num_bitplanes) and pass the values to the writer
+        template<class Sources, class Writer>
+        void decode_blocks(Sources& sources, int32_t n, int exp, uint8_t starting_bitplane, uint8_t num_bitplanes, LevelState& state, Writer& writer) const {
             const int32_t block_size = PER_BIT_BLOCK_SIZE;
-            // define fixed point type
-            using T_fp = typename std::conditional<std::is_same<T_data, double>::value, uint64_t, uint32_t>::type;
-            T_data * data = (T_data *) malloc(n * sizeof(T_data));
-            if(num_bitplanes == 0){
-                memset(data, 0, n * sizeof(T_data));
-                return data;
-            }
             std::vector<BitDecoder> decoders;
-            for(int i=0; i<streams.size(); i++){
-                decoders.push_back(BitDecoder(reinterpret_cast<uint64_t const*>(streams[i])));
-                decoders[i].size();
-            }
-            if(level_signs.size() == level){
-                level_signs.push_back(std::vector<bool>(n, false));
-                sign_flags.push_back(std::vector<bool>(n, false));
+            for(int i=0; i<num_bitplanes; i++){
+                decoders.push_back(BitDecoder(reinterpret_cast<uint64_t const*>(sources[i].begin())));
             }
-            std::vector<bool>& signs = level_signs[level];
-            std::vector<bool>& flags = sign_flags[level];
             const uint8_t ending_bitplane = starting_bitplane + num_bitplanes;
-            // decode
-            T_data * data_pos = data;
-            for(int i=0; i<n - block_size; i+=block_size){
-                for(int j=0; j<block_size; j++){
-                    T_fp fp_data = 0;
-                    // decode each bit of the data for each level component
-                    bool sign = false;
-                    if(flags[i + j]){
-                        // sign recorded
-                        sign = signs[i + j];
-                        for(int k=num_bitplanes - 1; k>=0; k--){
-                            uint8_t index = num_bitplanes - 1 - k;
-                            uint8_t bit = decoders[index].decode();
-                            fp_data += bit << k;
-                        }
+            const T_data scale = ldexp((T_data) 1, exp - ending_bitplane);
+            std::vector<T_fp> int_data_buffer(block_size, 0);
+            std::vector<T_data> data_buffer(block_size, 0);
+            // bitplanes above the decoded ones stay 0
+            uint32_t bitplanes[sizeof(T_fp) * UINT8_BITS] = {0};
+            int block_id = 0;
+            for(int i=0; i<n; i+=block_size, block_id++){
+                if(block_id % SOURCE_CHUNK_BLOCKS == 0){
+                    // a block reads at most a bit and a sign per value from each bitplane, and peeks one more word
+                    for(int k=0; k<num_bitplanes; k++){
+                        uint8_t const * pos = reinterpret_cast<uint8_t const *>(decoders[k].next_word());
+                        pos = sources[k].ensure(pos, (SOURCE_CHUNK_BLOCKS * 2 * block_size / UINT8_BITS) + sizeof(uint64_t));
+                        decoders[k].move_next_word(reinterpret_cast<uint64_t const *>(pos));
                     }
-                    else{
-                        // decode sign if possible
-                        bool first_bit = true;
-                        for(int k=num_bitplanes - 1; k>=0; k--){
-                            uint8_t index = num_bitplanes - 1 - k;
-                            uint8_t bit = decoders[index].decode();
-                            fp_data += bit << k;
-                            if(bit && first_bit){
-                                // decode sign
-                                sign = decoders[index].decode();
-                                first_bit = false;
-                                flags[i + j] = true;
-                            }
-                        }
-                        signs[i + j] = sign;
-                    }
-                    T_data cur_data = ldexp((T_data)fp_data, - ending_bitplane + exp);
-                    *(data_pos++) = sign ? -cur_data : cur_data;
                 }
-            }
-            // leftover
-            {
-                int rest_size = n % block_size;
-                if(rest_size == 0) rest_size = block_size;
-                for(int j=0; j<rest_size; j++){
-                    T_fp fp_data = 0;
-                    // decode each bit of the data for each level component
-                    bool sign = false;
-                    if(flags[n - rest_size + j]){
-                        sign = signs[n - rest_size + j];
-                        for(int k=num_bitplanes - 1; k>=0; k--){
-                            uint8_t index = num_bitplanes - 1 - k;
-                            uint8_t bit = decoders[index].decode();
-                            fp_data += bit << k;
-                        }
+                int cur_size = std::min(block_size, n - i);
+                const bool can_peek = (n - i >= 64);
+                uint32_t significance = state.significance[block_id];
+                uint32_t signs = state.signs[block_id];
+                for(int k=num_bitplanes - 1; k>=0; k--){
+                    uint32_t insignificant = ~significance & block_mask(cur_size);
+                    bitplanes[k] = decode_bitplane(decoders[num_bitplanes - 1 - k], cur_size, insignificant, signs, can_peek);
+                    significance |= bitplanes[k];
+                }
+                from_bitplanes(bitplanes, int_data_buffer.data());
+                state.significance[block_id] = significance;
+                state.signs[block_id] = signs;
+                if(std::isnormal(scale)){
+                    // scaling by a normal power of two is exact, so it matches ldexp
+                    for(int j=0; j<cur_size; j++){
+                        T_data cur_data = (T_data) int_data_buffer[j] * scale;
+                        data_buffer[j] = ((signs >> j) & 1u) ? -cur_data : cur_data;
                     }
-                    else{
-                        bool first_bit = true;
-                        for(int k=num_bitplanes - 1; k>=0; k--){
-                            uint8_t index = num_bitplanes - 1 - k;
-                            uint8_t bit = decoders[index].decode();
-                            fp_data += bit << k;
-                            if(bit && first_bit){
-                                // decode sign
-                                sign = decoders[index].decode();
-                                first_bit = false;
-                                flags[n - rest_size + j] = true;
-                            }
-                        }
-                        signs[n - rest_size + j] = sign;
+                }
+                else{
+                    for(int j=0; j<cur_size; j++){
+                        T_data cur_data = ldexp((T_data) int_data_buffer[j], exp - ending_bitplane);
+                        data_buffer[j] = ((signs >> j) & 1u) ? -cur_data : cur_data;
                     }
-                    T_data cur_data = ldexp((T_data)fp_data, - ending_bitplane + exp);
-                    *(data_pos++) = sign ? -cur_data : cur_data;
                 }
+                writer.write(data_buffer.data(), cur_size);
             }
-            return data;
-        }
-        void print() const {
-            std::cout << "Per-bit bitplane encoder" << std::endl;
         }
-    private:
-        inline void collect_level_errors(std::vector<double>& level_errors, float data, int num_bitplanes) const {
-            uint32_t fp_data = (uint32_t) data;
-            double mantissa = data - (uint32_t) data;
-            level_errors[num_bitplanes] += mantissa * mantissa;
-            for(int k=1; k<num_bitplanes; k++){
-                uint32_t mask = (1 << k) - 1;
-                double diff = (double) (fp_data & mask) + mantissa;
-                level_errors[num_bitplanes - k] += diff * diff;
-            }
-            level_errors[0] += data * data;
-        }
-        std::vector<std::vector<bool>> level_signs;
-        std::vector<std::vector<bool>> sign_flags;
+
+        std::vector<LevelState> level_states;
     };
 }
 #endif
@@ -0,0 +1,456 @@
+#ifndef _MDR_SPECK_ENCODER_HPP
+#define _MDR_SPECK_ENCODER_HPP
+
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+#include <iostream>
+#include <cstdlib>
+#include <type_traits>
+
+namespace MDR {
+    // squared error after decoding the first num_bytes bytes of an embedded stream
+    struct EmbeddedCheckpoint {
+        uint64_t num_bytes;
+        double squared_error;
+        EmbeddedCheckpoint(uint64_t b, double e) : num_bytes(b), squared_error(e) {}
+    };
+
+    // embedded set-partitioning encoder (SPECK) over the whole decomposed hierarchy
+    // unlike the level encoders, coefficient sets span levels: the coarsest level box starts in the list of
+    // insignificant sets, and the rest of the hierarchy is a single set I that is split into the subbands
+    // of the next level once significant (octave-band partitioning), so insignificant fine levels cost one bit
+    // per bitplane; significant boxes are halved along every dimension until single coefficients
+    // every bit is one decision, so the stream can be truncated at any bit and decoded with the
+    // coefficients reconstructed at the middle of their remaining uncertainty interval
+    // coefficients of level l are multiplied by level_scales[l] before coding, so the squared error of
+    // the scaled coefficients follows the error estimator and bitplanes are ordered by error reduction
+    template<class T_data>
+    class SPECKEncoder {
+    public:
+        static const int MAX_DIMS = 4;
+        SPECKEncoder(){
+            static_assert(std::is_floating_point<T_data>::value, "SPECKEncoder: input data must be floating points.");
+            static_assert(!std::is_same<T_data, long double>::value, "SPECKEncoder: long double is not supported.");
+        }
+
+        /*
+            @params data: decomposed data, where level l is the box level_dims[l] at the origin
+            @params dims: dimensions of data
+            @params level_dims: dimensions of the levels, from compute_level_dims
+            @params level_scales: coefficients of level l are coded as data * level_scales[l]
+            @params num_bitplanes: number of bitplanes to encode
+            @params exp: [out] exponent of the max scaled coefficient
+            @params num_bits: [out] number of bits in the stream
+            @params checkpoints: [out] squared errors of the scaled coefficients at byte boundaries,
+                every checkpoint_interval bytes, after each bitplane, and at the end of the stream
+        */
+        std::vector<uint8_t> encode(T_data const * data, const std::vector<uint32_t>& dims, const std::vector<std::vector<uint32_t>>& level_dims, const std::vector<T_data>& level_scales, uint8_t num_bitplanes, int& exp, uint64_t& num_bits, std::vector<EmbeddedCheckpoint>& checkpoints, uint64_t checkpoint_interval=256) const {
+            Coder<true> coder(dims, level_dims, num_bitplanes);
+            size_t n = 1;
+            for(const auto& d:dims) n *= d;
+            // scale coefficients level by level
+            std::vector<T_data> scaled(n, 0);
+            T_data max_val = 0;
+            for(int l=0; l<level_dims.size(); l++){
+                for(const auto& box:coder.level_boxes(l)){
+                    coder.for_each_in_box(box, [&](size_t i){
+                        scaled[i] = fabs(data[i] * level_scales[l]);
+                        max_val = std::max(max_val, scaled[i]);
+                    });
+                }
+            }
+            frexp(max_val, &exp);
+            std::vector<T_fp> magnitudes(n);
+            std::vector<float> fractions(n);
+            std::vector<uint8_t> signs(n);
+            for(size_t i=0; i<n; i++){
+                T_data shifted = ldexp(scaled[i], num_bitplanes - exp);
+                magnitudes[i] = (T_fp) shifted;
+                fractions[i] = shifted - magnitudes[i];
+                signs[i] = data[i] < 0;
+            }
+            std::vector<uint8_t> stream;
+            coder.set_encoding(magnitudes.data(), fractions.data(), signs.data(), stream, checkpoints, checkpoint_interval);
+            coder.code();
+            num_bits = coder.get_num_bits();
+            // checkpoint errors in the scaled data domain
+            const double unit = ldexp(1.0, 2 * (exp - num_bitplanes));
+            for(auto& c:checkpoints){
+                c.squared_error *= unit;
+            }
+            return stream;
+        }
+
+        /*
+            @params stream: embedded stream (or its first bytes)
+            @params num_bits: number of bits to decode, at most the number of bits of the full stream
+            @params data: [out] decoded coefficients at their locations in the hierarchy
+            other parameters are the ones used for encoding
+        */
+        void decode(uint8_t const * stream, uint64_t num_bits, T_data * data, const std::vector<uint32_t>& dims, const std::vector<std::vector<uint32_t>>& level_dims, const std::vector<T_data>& level_scales, uint8_t num_bitplanes, int exp) const {
+            Coder<false> coder(dims, level_dims, num_bitplanes);
+            coder.set_decoding(stream, num_bits);
+            coder.code();
+            size_t n = 1;
+            for(const auto& d:dims) n *= d;
+            memset(data, 0, n * sizeof(T_data));
+            for(const auto& c:coder.get_significant_coefficients()){
+                T_data value = ldexp((T_data) c.magnitude + ldexp((T_data) 0.5, c.plane), exp - num_bitplanes) / level_scales[c.level];
+                data[c.index] = c.sign ? -value : value;
+            }
+        }
+
+        void print() const {
+            std::cout << "SPECK encoder" << std::endl;
+        }
+    private:
+        using T_fp = typename std::conditional<std::is_same<T_data, double>::value, uint64_t, uint32_t>::type;
+
+        // a box of coefficients within one level
+        struct Box {
+            uint32_t start[MAX_DIMS];
+            uint32_t size[MAX_DIMS];
+            uint8_t level;
+            T_fp max_magnitude;
+        };
+        // coefficient found significant, with the bits decoded so far (down to plane)
+        struct SignificantCoefficient {
+            size_t index;
+            T_fp magnitude;
+            uint8_t plane;
+            uint8_t sign;
+            uint8_t level;
+        };
+
+        // the SPECK passes shared by the encoder (ENCODE = true) and the decoder
+        // code functions return false once the decoder runs out of bits
+        template<bool ENCODE>
+        class Coder {
+        public:
+            Coder(const std::vector<uint32_t>& dims, const std::vector<std::vector<uint32_t>>& level_dims, uint8_t num_bitplanes)
+                : num_dims(dims.size()), level_dims(level_dims), target_level(level_dims.size() - 1), num_bitplanes(num_bitplanes) {
+                if((num_dims < 1) || (num_dims > MAX_DIMS)){
+                    std::cerr << "SPECKEncoder: " << num_dims << " dimensions are not supported." << std::endl;
+                    exit(-1);
+                }
+                size_t stride = 1;
+                for(int i=num_dims-1; i>=0; i--){
+                    strides[i] = stride;
+                    stride *= dims[i];
+                }
+                num_elements = stride;
+                lis = std::vector<std::vector<Box>>(MAX_DIMS * 32 + 1);
+            }
+            void set_encoding(T_fp const * magnitudes_, float const * fractions_, uint8_t const * signs_, std::vector<uint8_t>& output_, std::vector<EmbeddedCheckpoint>& checkpoints_, uint64_t checkpoint_interval_){
+                magnitudes = magnitudes_;
+                fractions = fractions_;
+                signs = signs_;
+                output = &output_;
+                checkpoints = &checkpoints_;
+                checkpoint_interval = std::max((uint64_t) 1, checkpoint_interval_);
+                significant = std::vector<uint8_t>(num_elements, 0);
+                // max magnitude of the levels finer than l, for the significance of I
+                finer_max = std::vector<T_fp>(target_level + 2, 0);
+                for(int l=target_level; l>=1; l--){
+                    T_fp level_max = 0;
+                    for(const auto& box:level_boxes(l)){
+                        for_each_in_box(box, [&](size_t i){ level_max = std::max(level_max, magnitudes[i]); });
+                    }
+                    finer_max[l] = std::max(finer_max[l + 1], level_max);
+                }
+                squared_error = 0;
+                for(size_t i=0; i<num_elements; i++){
+                    double x = magnitudes[i] + (double) fractions[i];
+                    squared_error += x * x;
+                }
+                checkpoints->clear();
+                checkpoints->push_back(EmbeddedCheckpoint(0, squared_error));
+            }
+            void set_decoding(uint8_t const * input_, uint64_t num_bits_){
+                input = input_;
+                total_bits = num_bits_;
+            }
+            void code(){
+                Box root = level_boxes(0)[0];
+                if(ENCODE){
+                    for_each_in_box(root, [&](size_t i){ root.max_magnitude = std::max(root.max_magnitude, magnitudes[i]); });
+                }
+                lis[bucket(root)].push_back(root);
+                i_level = 0;
+                for(int b=0; b<num_bitplanes; b++){
+                    const int k = num_bitplanes - 1 - b;
+                    const size_t num_refined = lsp.size();
+                    if(!sorting_pass(k)) return;
+                    if(!refinement_pass(k, num_refined)) return;
+                    if(ENCODE) end_bitplane(k);
+                }
+                if(ENCODE){
+                    uint64_t num_bytes = (num_bits + 7) >> 3;
+                    if(checkpoints->back().num_bytes != num_bytes) checkpoints->push_back(EmbeddedCheckpoint(num_bytes, squared_error));
+                }
+            }
+            uint64_t get_num_bits() const {
+                return num_bits;
+            }
+            const std::vector<SignificantCoefficient>& get_significant_coefficients() const {
+                return lsp;
+            }
+            // level 0 is the coarsest box; level l > 0 is split into the 2^d - 1 non-empty subbands
+            // that are the coefficient range in at least one dimension
+            std::vector<Box> level_boxes(int l) const {
+                std::vector<Box> boxes;
+                if(l == 0){
+                    Box box = unit_box(0);
+                    for(int d=0; d<num_dims; d++){
+                        box.start[d] = 0;
+                        box.size[d] = level_dims[0][d];
+                    }
+                    boxes.push_back(box);
+                    return boxes;
+                }
+                const auto& coarse = level_dims[l - 1];
+                const auto& fine = level_dims[l];
+                for(int mask=1; mask<(1 << num_dims); mask++){
+                    Box box = unit_box(l);
+                    bool empty = false;
+                    for(int d=0; d<num_dims; d++){
+                        box.start[d] = (mask & (1 << d)) ? coarse[d] : 0;
+                        box.size[d] = (mask & (1 << d)) ? fine[d] - coarse[d] : coarse[d];
+                        empty = empty || (box.size[d] == 0);
+                    }
+                    if(!empty) boxes.push_back(box);
+                }
+                return boxes;
+            }
+            template<class F>
+            void for_each_in_box(const Box& box, F f) const {
+                const int last = num_dims - 1;
+                uint32_t counter[MAX_DIMS] = {0};
+                while(true){
+                    size_t offset = box.start[last];
+                    for(int d=0; d<last; d++){
+                        offset += (box.start[d] + counter[d]) * strides[d];
+                    }
+                    for(uint32_t j=0; j<box.size[last]; j++){
+                        f(offset + j);
+                    }
+                    int d = last - 1;
+                    while(d >= 0){
+                        if(++ counter[d] < box.size[d]) break;
+                        counter[d] = 0;
+                        d --;
+                    }
+                    if(d < 0) break;
+                }
+            }
+        private:
+            // dimensions beyond num_dims have size 1
+            static inline Box unit_box(int level){
+                Box box;
+                for(int d=0; d<MAX_DIMS; d++){
+                    box.start[d] = 0;
+                    box.size[d] = 1;
+                }
+                box.level = level;
+                box.max_magnitude = 0;
+                return box;
+            }
+            // LIS buckets: sum of ceil(log2(size)) over dimensions, so that small sets are tested first
+            static inline int bucket(const Box& box){
+                int b = 0;
+                for(int d=0; d<MAX_DIMS; d++){
+                    uint32_t s = box.size[d];
+                    while(s > 1){
+                        s = (s + 1) >> 1;
+                        b ++;
+                    }
+                }
+                return b;
+            }
+            inline bool is_coefficient(const Box& box) const {
+                for(int d=0; d<num_dims; d++){
+                    if(box.size[d] != 1) return false;
+                }
+                return true;
+            }
+            inline size_t offset_of(const Box& box) const {
+                size_t offset = 0;
+                for(int d=0; d<num_dims; d++){
+                    offset += box.start[d] * strides[d];
+                }
+                return offset;
+            }
+            inline bool code_bit(uint32_t& bit){
+                if(ENCODE){
+                    if((num_bits & 7) == 0) output->push_back(0);
+                    output->back() |= bit << (num_bits & 7);
+                    num_bits ++;
+                    if((num_bits & 7) == 0){
+                        uint64_t num_bytes = num_bits >> 3;
+                        if(pending_checkpoint || (num_bytes % checkpoint_interval == 0)){
+                            checkpoints->push_back(EmbeddedCheckpoint(num_bytes, squared_error));
+                            pending_checkpoint = false;
+                        }
+                    }
+                    return true;
+                }
+                if(num_bits == total_bits) return false;
+                bit = (input[num_bits >> 3] >> (num_bits & 7)) & 1;
+                num_bits ++;
+                return true;
+            }
+            // reconstruction of a magnitude known down to plane k
+            static inline double reconstruct(T_fp magnitude, int k){
+                return (double) (magnitude >> k << k) + ldexp(0.5, k);
+            }
+            inline double squared(double x){
+                return x * x;
+            }
+            // a coefficient became significant at plane k: code its sign
+            bool code_new_coefficient(const Box& box, int k){
+                SignificantCoefficient c;
+                c.index = offset_of(box);
+                c.level = box.level;
+                c.plane = k;
+                uint32_t sign = 0;
+                if(ENCODE){
+                    const double x = magnitudes[c.index] + (double) fractions[c.index];
+                    squared_error += squared(x - reconstruct(magnitudes[c.index], k)) - squared(x);
+                    significant[c.index] = 1;
+                    sign = signs[c.index];
+                }
+                if(!code_bit(sign)) return false;
+                c.sign = sign;
+                c.magnitude = ((T_fp) 1) << k;
+                lsp.push_back(c);
+                return true;
+            }
+            // code a set known to be significant at plane k
+            bool code_set(const Box& box, int k){
+                if(is_coefficient(box)) return code_new_coefficient(box, k);
+                for(int mask=0; mask<(1 << num_dims); mask++){
+                    Box child = unit_box(box.level);
+                    bool valid = true;
+                    for(int d=0; d<num_dims; d++){
+                        const uint32_t half = (box.size[d] + 1) >> 1;
+                        if(mask & (1 << d)){
+                            child.start[d] = box.start[d] + half;
+                            child.size[d] = box.size[d] - half;
+                            valid = valid && (child.size[d] > 0);
+                        }
+                        else{
+                            child.start[d] = box.start[d];
+                            child.size[d] = half;
+                        }
+                    }
+                    if(!valid) continue;
+                    if(!code_new_set(child, k)) return false;
+                }
+                return true;
+            }
+            // test a new set at plane k, and keep it in LIS if insignificant
+            bool code_new_set(Box& box, int k){
+                if(ENCODE){
+                    box.max_magnitude = 0;
+                    for_each_in_box(box, [&](size_t i){ box.max_magnitude = std::max(box.max_magnitude, magnitudes[i]); });
+                }
+                uint32_t sig = 0;
+                if(ENCODE) sig = (box.max_magnitude >> k) != 0;
+                if(!code_bit(sig)) return false;
+                if(sig) return code_set(box, k);
+                lis[bucket(box)].push_back(box);
+                return true;
+            }
+            bool sorting_pass(int k){
+                for(int b=0; b<lis.size(); b++){
+                    // sets split in this pass go to smaller buckets, so the list does not grow here
+                    std::vector<Box>& list = lis[b];
+                    size_t num_kept = 0;
+                    for(size_t i=0; i<list.size(); i++){
+                        const Box box = list[i];
+                        uint32_t sig = 0;
+                        if(ENCODE) sig = (box.max_magnitude >> k) != 0;
+                        if(!code_bit(sig)) return false;
+                        if(sig){
+                            if(!code_set(box, k)) return false;
+                        }
+                        else list[num_kept ++] = box;
+                    }
+                    list.resize(num_kept);
+                }
+                return code_I(k);
+            }
+            // I: levels finer than i_level
+            bool code_I(int k){
+                while(i_level < target_level){
+                    uint32_t sig = 0;
+                    if(ENCODE) sig = (finer_max[i_level + 1] >> k) != 0;
+                    if(!code_bit(sig)) return false;
+                    if(!sig) return true;
+                    i_level ++;
+                    for(auto& box:level_boxes(i_level)){
+                        if(!code_new_set(box, k)) return false;
+                    }
+                }
+                return true;
+            }
+            bool refinement_pass(int k, size_t num_refined){
+                for(size_t i=0; i<num_refined; i++){
+                    SignificantCoefficient& c = lsp[i];
+                    uint32_t bit = 0;
+                    if(ENCODE){
+                        const T_fp magnitude = magnitudes[c.index];
+                        const double x = magnitude + (double) fractions[c.index];
+                        squared_error += squared(x - reconstruct(magnitude, k)) - squared(x - reconstruct(magnitude, k + 1));
+                        bit = (magnitude >> k) & 1;
+                    }
+                    if(!code_bit(bit)) return false;
+                    c.magnitude |= ((T_fp) bit) << k;
+                    c.plane = k;
+                }
+                return true;
+            }
+            // recompute the error after each bitplane to avoid drifting, and checkpoint at the next byte
+            void end_bitplane(int k){
+                squared_error = 0;
+                for(size_t i=0; i<num_elements; i++){
+                    const double x = magnitudes[i] + (double) fractions[i];
+                    squared_error += significant[i] ? squared(x - reconstruct(magnitudes[i], k)) : squared(x);
+                }
+                if((num_bits & 7) == 0){
+                    if(checkpoints->back().num_bytes != (num_bits >> 3)) checkpoints->push_back(EmbeddedCheckpoint(num_bits >> 3, squared_error));
+                    else checkpoints->back().squared_error = squared_error;
+                }
+                else pending_checkpoint = true;
+            }
+
+            const int num_dims;
+            const std::vector<std::vector<uint32_t>>& level_dims;
+            const int target_level;
+            const uint8_t num_bitplanes;
+            size_t strides[MAX_DIMS];
+            size_t num_elements = 0;
+            std::vector<std::vector<Box>> lis;
+            std::vector<SignificantCoefficient> lsp;
+            int i_level = 0;
+            uint64_t num_bits = 0;
+            // encoder
+            T_fp const * magnitudes = NULL;
+            float const * fractions = NULL;
+            uint8_t const * signs = NULL;
+            std::vector<uint8_t> significant;
+            std::vector<T_fp> finer_max;
+            std::vector<uint8_t> * output = NULL;
+            std::vector<EmbeddedCheckpoint> * checkpoints = NULL;
+            uint64_t checkpoint_interval = 256;
+            double squared_error = 0;
+            bool pending_checkpoint = false;
+            // decoder
+            uint8_t const * input = NULL;
+            uint64_t total_bits = 0;
+        };
+    };
+}
+#endif
@@ -2,5 +2,8 @@
 #define _MDR_DECOMPOSER_HPP
 
 #include "MGARD.hpp"
+#include "NativeMGARD.hpp"
+#include "InterpolationDecomposer.hpp"
+#include "WaveletDecomposer.hpp"
 
 #endif
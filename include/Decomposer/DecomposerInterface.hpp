@@ -15,6 +15,9 @@ namespace MDR {
 
             virtual void recompose(T * data, const std::vector<uint32_t>& dimensions, uint32_t target_level, std::vector<uint32_t> strides) const = 0;
 
+            // highest target level supported for the given dimensions
+            virtual uint32_t max_level(const std::vector<uint32_t>& dimensions) const = 0;
+
             virtual void print() const = 0;
         };
     }
@@ -0,0 +1,127 @@
+#ifndef _MDR_INTERPOLATION_DECOMPOSER_HPP
+#define _MDR_INTERPOLATION_DECOMPOSER_HPP
+
+#include "DecomposerInterface.hpp"
+#include "LineTransform.hpp"
+
+namespace MDR {
+    // multilevel interpolation decomposer (SZ3-style prediction, no projection)
+    // each level reorders every dimension into (nodal, coefficient) halves as in MGARD, then predicts the
+    // coefficients dimension by dimension with linear or cubic interpolation along the lines:
+    // the pass along dimension d covers the lines that are nodal in the dimensions after d,
+    // so it may use the values of the points predicted by the passes along the dimensions before d
+    // recompose runs the passes forward, and decompose runs them backward so that every prediction
+    // is computed from original values; recompose is exact up to rounding
+    template<class T>
+    class InterpolationDecomposer : public concepts::DecomposerInterface<T> {
+    public:
+        InterpolationDecomposer(bool cubic=true) : cubic(cubic) {}
+        void decompose(T * data, const std::vector<uint32_t>& dimensions, uint32_t target_level, std::vector<uint32_t> strides=std::vector<uint32_t>()) const {
+            auto data_strides = data_strides_of(dimensions, strides);
+            std::vector<uint32_t> box(dimensions);
+            for(int level=0; level<target_level; level++){
+                const int num_dims = box.size();
+                for(int d=num_dims-1; d>=0; d--){
+                    if(box[d] >= 3) batched_line_transform(data, box, data_strides, d, reorder_lines<T>);
+                }
+                for(int d=num_dims-1; d>=0; d--){
+                    if(box[d] >= 3) predict(data, box, data_strides, d, false);
+                }
+                box = coarse_box(box);
+            }
+        }
+        void recompose(T * data, const std::vector<uint32_t>& dimensions, uint32_t target_level, std::vector<uint32_t> strides=std::vector<uint32_t>()) const {
+            auto data_strides = data_strides_of(dimensions, strides);
+            std::vector<std::vector<uint32_t>> boxes(1, dimensions);
+            for(int level=1; level<target_level; level++){
+                boxes.push_back(coarse_box(boxes.back()));
+            }
+            for(int level=target_level-1; level>=0; level--){
+                const std::vector<uint32_t>& box = boxes[level];
+                const int num_dims = box.size();
+                for(int d=0; d<num_dims; d++){
+                    if(box[d] >= 3) predict(data, box, data_strides, d, true);
+                }
+                for(int d=0; d<num_dims; d++){
+                    if(box[d] >= 3) batched_line_transform(data, box, data_strides, d, restore_lines<T>);
+                }
+            }
+        }
+        uint32_t max_level(const std::vector<uint32_t>& dimensions) const {
+            return max_box_level(dimensions);
+        }
+        void print() const {
+            std::cout << "Interpolation decomposer (" << (cubic ? "cubic" : "linear") << ")" << std::endl;
+        }
+    private:
+        // prediction pass along dimension d over the lines that are nodal in the dimensions after d
+        void predict(T * data, const std::vector<uint32_t>& box, const std::vector<size_t>& strides, int d, bool add) const {
+            std::vector<uint32_t> lines_box(box);
+            for(int i=d+1; i<box.size(); i++){
+                lines_box[i] = coarse_line_size(box[i]);
+            }
+            const bool cubic = this->cubic;
+            batched_line_transform(data, lines_box, strides, d, [cubic, add](T * pos, size_t n, size_t stride, size_t width, T * buffer){
+                if(cubic) predict_lines_cubic(pos, n, stride, width, add);
+                else predict_lines_linear(pos, n, stride, width, add);
+            });
+        }
+        static inline void update(T * c, T const * prediction, size_t width, bool add){
+            if(add){
+                for(size_t k=0; k<width; k++) c[k] += prediction[k];
+            }
+            else{
+                for(size_t k=0; k<width; k++) c[k] -= prediction[k];
+            }
+        }
+        static void predict_lines_linear(T * pos, size_t n, size_t stride, size_t width, bool add){
+            const size_t n_nodal = (n >> 1) + 1;
+            const size_t n_coeff = n - n_nodal;
+            T prediction[LINE_BATCH_WIDTH];
+            for(size_t i=0; i<n_coeff; i++){
+                T const * a0 = pos + i * stride;
+                T const * a1 = a0 + stride;
+                for(size_t k=0; k<width; k++){
+                    prediction[k] = (a0[k] + a1[k]) / 2;
+                }
+                update(pos + (n_nodal + i) * stride, prediction, width, add);
+            }
+        }
+        // cubic interpolation (-1, 9, 9, -1) / 16 inside, quadratic (3, 6, -1) / 8 next to the boundaries
+        static void predict_lines_cubic(T * pos, size_t n, size_t stride, size_t width, bool add){
+            const size_t n_nodal = (n >> 1) + 1;
+            const size_t n_coeff = n - n_nodal;
+            if(n_nodal < 3){
+                predict_lines_linear(pos, n, stride, width, add);
+                return;
+            }
+            T prediction[LINE_BATCH_WIDTH];
+            for(size_t i=0; i<n_coeff; i++){
+                T const * a1 = pos + i * stride;
+                T const * a2 = a1 + stride;
+                if(i == 0){
+                    T const * a3 = a2 + stride;
+                    for(size_t k=0; k<width; k++){
+                        prediction[k] = (3 * a1[k] + 6 * a2[k] - a3[k]) / 8;
+                    }
+                }
+                else if(i + 2 == n_nodal){
+                    T const * a0 = a1 - stride;
+                    for(size_t k=0; k<width; k++){
+                        prediction[k] = (- a0[k] + 6 * a1[k] + 3 * a2[k]) / 8;
+                    }
+                }
+                else{
+                    T const * a0 = a1 - stride;
+                    T const * a3 = a2 + stride;
+                    for(size_t k=0; k<width; k++){
+                        prediction[k] = (- a0[k] + 9 * a1[k] + 9 * a2[k] - a3[k]) / 16;
+                    }
+                }
+                update(pos + (n_nodal + i) * stride, prediction, width, add);
+            }
+        }
+        bool cubic = true;
+    };
+}
+#endif
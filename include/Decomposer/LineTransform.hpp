@@ -0,0 +1,159 @@
+#ifndef _MDR_LINE_TRANSFORM_HPP
+#define _MDR_LINE_TRANSFORM_HPP
+
+#include <vector>
+#include <cstring>
+#include <algorithm>
+
+namespace MDR {
+    // building blocks of the in-tree decomposers: one-dimensional transforms applied to all lines of a box
+    // lines along the last dimension are processed one by one; lines along other dimensions are processed
+    // in batches of up to LINE_BATCH_WIDTH consecutive lines (contiguous along the last dimension),
+    // so that the inner loops vectorize, and batches are processed in parallel with OpenMP
+    const size_t LINE_BATCH_WIDTH = 64;
+
+    // size of the coarse box along a dimension; dimensions with fewer than 3 nodes are not decomposed
+    inline uint32_t coarse_line_size(uint32_t n){
+        return (n >= 3) ? (n >> 1) + 1 : n;
+    }
+    inline std::vector<uint32_t> coarse_box(const std::vector<uint32_t>& box){
+        std::vector<uint32_t> coarse(box.size());
+        for(int i=0; i<box.size(); i++){
+            coarse[i] = coarse_line_size(box[i]);
+        }
+        return coarse;
+    }
+    // number of levels until a dimension of size n is down to 3 nodes
+    inline uint32_t max_line_level(uint32_t n){
+        uint32_t level = 0;
+        while(n > 3){
+            n = coarse_line_size(n);
+            level ++;
+        }
+        return level;
+    }
+    // decomposition stops along short dimensions and continues along long ones (anisotropic levels),
+    // so the longest dimension sets the number of levels
+    inline uint32_t max_box_level(const std::vector<uint32_t>& box){
+        uint32_t level = 0;
+        for(const auto& n:box) level = std::max(level, max_line_level(n));
+        return level;
+    }
+    inline size_t box_num_elements(const std::vector<uint32_t>& box){
+        size_t num = 1;
+        for(const auto& n:box) num *= n;
+        return num;
+    }
+    inline std::vector<size_t> compact_strides(const std::vector<uint32_t>& box){
+        std::vector<size_t> strides(box.size());
+        size_t stride = 1;
+        for(int i=box.size()-1; i>=0; i--){
+            strides[i] = stride;
+            stride *= box[i];
+        }
+        return strides;
+    }
+    // strides of data as size_t, computed from the dimensions if not given
+    inline std::vector<size_t> data_strides_of(const std::vector<uint32_t>& dimensions, const std::vector<uint32_t>& strides){
+        if(strides.empty()) return compact_strides(dimensions);
+        return std::vector<size_t>(strides.begin(), strides.end());
+    }
+
+    /*
+        @params data: data of the box
+        @params box: dimensions of the box
+        @params strides: strides of data
+        @params d: dimension of the lines
+        @params transform: called as transform(pos, n, stride, width, buffer) for each batch, where line k of
+            the batch holds pos[i * stride + k] for i < n, and buffer has room for n * width elements
+    */
+    template<class T, class Transform>
+    void batched_line_transform(T * data, const std::vector<uint32_t>& box, const std::vector<size_t>& strides, int d, Transform transform){
+        const int num_dims = box.size();
+        const int last = num_dims - 1;
+        if(box_num_elements(box) == 0) return;
+        const size_t n = box[d];
+        const size_t width = (d == last) ? 1 : std::min((size_t) box[last], LINE_BATCH_WIDTH);
+        const size_t num_chunks = (d == last) ? 1 : (box[last] + width - 1) / width;
+        // number of batches: all combinations of the dimensions other than d and last, times chunks
+        size_t num_outer = 1;
+        for(int i=0; i<last; i++){
+            if(i != d) num_outer *= box[i];
+        }
+        const int64_t num_batches = num_outer * num_chunks;
+        #pragma omp parallel
+        {
+            std::vector<T> buffer(n * width);
+            #pragma omp for schedule(static)
+            for(int64_t b=0; b<num_batches; b++){
+                size_t outer = b / num_chunks;
+                size_t chunk = b % num_chunks;
+                size_t offset = 0;
+                for(int i=last-1; i>=0; i--){
+                    if(i == d) continue;
+                    offset += (outer % box[i]) * strides[i];
+                    outer /= box[i];
+                }
+                size_t batch_width = width;
+                if(d != last){
+                    offset += chunk * width * strides[last];
+                    batch_width = std::min(width, box[last] - chunk * width);
+                }
+                transform(data + offset, n, strides[d], batch_width, buffer.data());
+            }
+        }
+    }
+
+    // reorder lines into (nodal, coefficient): even indices first, then odd indices
+    // for even sizes, the last nodal value is extrapolated so that its interpolant with the previous one
+    // reproduces the last sample, which is then not stored
+    template<class T>
+    void reorder_lines(T * pos, size_t n, size_t stride, size_t width, T * buffer){
+        const size_t n_nodal = (n >> 1) + 1;
+        const size_t n_coeff = n - n_nodal;
+        T * nodal = buffer;
+        T * coeff = buffer + n_nodal * width;
+        for(size_t i=0; i<n_coeff; i++){
+            memcpy(nodal + i * width, pos + 2 * i * stride, width * sizeof(T));
+            memcpy(coeff + i * width, pos + (2 * i + 1) * stride, width * sizeof(T));
+        }
+        memcpy(nodal + n_coeff * width, pos + 2 * n_coeff * stride, width * sizeof(T));
+        if(n_nodal == n_coeff + 2){
+            T * extra = nodal + (n_coeff + 1) * width;
+            T const * last = pos + (n - 1) * stride;
+            T const * prev = nodal + n_coeff * width;
+            for(size_t k=0; k<width; k++){
+                extra[k] = 2 * last[k] - prev[k];
+            }
+        }
+        for(size_t i=0; i<n; i++){
+            memcpy(pos + i * stride, buffer + i * width, width * sizeof(T));
+        }
+    }
+
+    // inverse of reorder_lines
+    template<class T>
+    void restore_lines(T * pos, size_t n, size_t stride, size_t width, T * buffer){
+        const size_t n_nodal = (n >> 1) + 1;
+        const size_t n_coeff = n - n_nodal;
+        for(size_t i=0; i<n; i++){
+            memcpy(buffer + i * width, pos + i * stride, width * sizeof(T));
+        }
+        T const * nodal = buffer;
+        T const * coeff = buffer + n_nodal * width;
+        for(size_t i=0; i<n_coeff; i++){
+            memcpy(pos + 2 * i * stride, nodal + i * width, width * sizeof(T));
+            memcpy(pos + (2 * i + 1) * stride, coeff + i * width, width * sizeof(T));
+        }
+        memcpy(pos + 2 * n_coeff * stride, nodal + n_coeff * width, width * sizeof(T));
+        if(n_nodal == n_coeff + 2){
+            T * last = pos + (n - 1) * stride;
+            T const * prev = nodal + n_coeff * width;
+            T const * extra = prev + width;
+            for(size_t k=0; k<width; k++){
+                last[k] = (prev[k] + extra[k]) / 2;
+            }
+        }
+    }
+}
+#endif
@@ -33,6 +33,10 @@ namespace MDR {
                 recomposer.recompose(data, dims, target_level, false, strs);
             }
         }
+        // MGARDx coarsens all dimensions together, so the shortest dimension sets the limit
+        uint32_t max_level(const std::vector<uint32_t>& dimensions) const {
+            return std::max(0, (int) log2(*std::min_element(dimensions.begin(), dimensions.end())) - 1);
+        }
         void print() const {
             std::cout << "MGARD orthogonal decomposer" << std::endl;
         }
@@ -64,6 +68,10 @@ namespace MDR {
                 recomposer.recompose(data, dims, target_level, true, strs);
             }
         }
+        // MGARDx coarsens all dimensions together, so the shortest dimension sets the limit
+        uint32_t max_level(const std::vector<uint32_t>& dimensions) const {
+            return std::max(0, (int) log2(*std::min_element(dimensions.begin(), dimensions.end())) - 1);
+        }
         void print() const {
             std::cout << "MGARD hierarchical decomposer" << std::endl;
         }
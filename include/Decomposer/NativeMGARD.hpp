@@ -0,0 +1,373 @@
+#ifndef _MDR_NATIVE_MGARD_DECOMPOSER_HPP
+#define _MDR_NATIVE_MGARD_DECOMPOSER_HPP
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include "DecomposerInterface.hpp"
+#include "LineTransform.hpp"
+
+namespace MDR {
+    // dimension-dependent state of NativeMGARDTransform for one (dimensions, strides, target_level):
+    // data strides, level boxes and the Thomas factors of the coarse mass matrices (orthogonal basis)
+    // a plan is immutable once built, so copies of a decomposer share it read-only
+    template<class T>
+    class NativeMGARDPlan {
+    public:
+        NativeMGARDPlan(const std::vector<uint32_t>& dimensions, uint32_t target_level, const std::vector<uint32_t>& strides, bool hierarchical)
+            : data_strides(data_strides_of(dimensions, strides)), num_elements(box_num_elements(dimensions)) {
+            boxes.push_back(dimensions);
+            for(int level=1; level<target_level; level++){
+                boxes.push_back(coarse_box(boxes.back()));
+            }
+            factors = std::vector<std::vector<std::vector<T>>>(target_level);
+            if(hierarchical) return;
+            for(int level=0; level<target_level; level++){
+                const auto coarse = coarse_box(boxes[level]);
+                factors[level] = std::vector<std::vector<T>>(coarse.size());
+                for(int d=0; d<coarse.size(); d++){
+                    if(boxes[level][d] >= 3) factors[level][d] = compute_thomas_factors(coarse[d]);
+                }
+            }
+        }
+        std::vector<size_t> data_strides;
+        size_t num_elements = 0;
+        // boxes[level] is the box decomposed at level (0 is the finest), for level < target_level
+        std::vector<std::vector<uint32_t>> boxes;
+        // factors[level][d] for the projection along d at level
+        std::vector<std::vector<std::vector<T>>> factors;
+    private:
+        // factors[j] = 1 / (diag_j - off * c'_{j-1}), and c'_j = off * factors[j]
+        static std::vector<T> compute_thomas_factors(size_t n_nodal){
+            std::vector<T> factors(n_nodal);
+            const T off = (T) 1 / 3;
+            T c = 0;
+            for(size_t j=0; j<n_nodal; j++){
+                T diag = ((j == 0) || (j == n_nodal - 1)) ? (T) 2 / 3 : (T) 4 / 3;
+                factors[j] = 1 / (diag - off * c);
+                c = off * factors[j];
+            }
+            return factors;
+        }
+    };
+
+    // in-tree MGARD transform on piecewise multilinear elements
+    // each level reorders every dimension into (nodal, coefficient) halves, replaces the coefficients with
+    // their difference to the multilinear interpolant of the nodal values, and (for the orthogonal basis)
+    // adds the L2 projection of this multilevel component to the nodal values
+    // the layout is the one of MGARDx, so the interleavers are unchanged
+    // a dimension of even size n is extended with an extrapolated nodal value whose interpolant
+    // reproduces the last sample, and dimensions with fewer than 3 nodes are left untouched
+    // plans are cached per (dimensions, strides, target_level) in a cache shared by the copies of a transform
+    // and guarded by a mutex, and the work buffers are taken from a pool in the same cache for the time of a call,
+    // so repeated calls on the same grid (e.g. time steps) do no setup and no allocation, concurrent calls are safe,
+    // and the buffers are released with the last copy of the transform
+    template<class T>
+    class NativeMGARDTransform {
+    public:
+        NativeMGARDTransform(bool hierarchical) : hierarchical(hierarchical), cache(std::make_shared<PlanCache>()) {}
+        void decompose(T * data, const std::vector<uint32_t>& dimensions, uint32_t target_level, std::vector<uint32_t> strides) const {
+            if(target_level == 0) return;
+            const auto plan = get_plan(dimensions, target_level, strides);
+            WorkBuffer buffer(*cache, plan->num_elements);
+            T * w = buffer.data();
+            for(int level=0; level<target_level; level++){
+                const std::vector<uint32_t>& box = plan->boxes[level];
+                const int num_dims = box.size();
+                for(int d=num_dims-1; d>=0; d--){
+                    if(box[d] >= 3) batched_line_transform(data, box, plan->data_strides, d, reorder_lines<T>);
+                }
+                compute_interpolant(data, box, plan->data_strides, w);
+                update_coefficients(data, box, plan->data_strides, w, false);
+                if(!hierarchical) apply_correction(data, box, plan->data_strides, plan->factors[level], w, true);
+            }
+        }
+        void recompose(T * data, const std::vector<uint32_t>& dimensions, uint32_t target_level, std::vector<uint32_t> strides) const {
+            if(target_level == 0) return;
+            const auto plan = get_plan(dimensions, target_level, strides);
+            WorkBuffer buffer(*cache, plan->num_elements);
+            T * w = buffer.data();
+            for(int level=target_level-1; level>=0; level--){
+                const std::vector<uint32_t>& box = plan->boxes[level];
+                const int num_dims = box.size();
+                if(!hierarchical) apply_correction(data, box, plan->data_strides, plan->factors[level], w, false);
+                compute_interpolant(data, box, plan->data_strides, w);
+                update_coefficients(data, box, plan->data_strides, w, true);
+                for(int d=0; d<num_dims; d++){
+                    if(box[d] >= 3) batched_line_transform(data, box, plan->data_strides, d, restore_lines<T>);
+                }
+            }
+        }
+    private:
+        struct PlanCache {
+            std::mutex mutex;
+            std::map<std::vector<uint32_t>, std::shared_ptr<const NativeMGARDPlan<T>>> plans;
+            std::vector<std::vector<T>> buffers;    // work buffers not in use
+        };
+        // work buffer of at least num_elements (not initialized) taken from the pool, and given back at the end of the call
+        class WorkBuffer {
+        public:
+            WorkBuffer(PlanCache& cache, size_t num_elements) : cache(cache) {
+                {
+                    std::lock_guard<std::mutex> lock(cache.mutex);
+                    if(cache.buffers.size()){
+                        buffer.swap(cache.buffers.back());
+                        cache.buffers.pop_back();
+                    }
+                }
+                if(buffer.size() < num_elements){
+                    buffer = std::vector<T>();
+                    buffer.resize(num_elements);
+                }
+            }
+            WorkBuffer(const WorkBuffer&) = delete;
+            WorkBuffer& operator=(const WorkBuffer&) = delete;
+            ~WorkBuffer(){
+                std::lock_guard<std::mutex> lock(cache.mutex);
+                cache.buffers.push_back(std::move(buffer));
+            }
+            T * data(){
+                return buffer.data();
+            }
+        private:
+            PlanCache& cache;
+            std::vector<T> buffer;
+        };
+        // cached plan for the given shape; the cache is cleared when it grows beyond MAX_NUM_PLANS shapes,
+        // and the returned plan stays valid for the caller
+        std::shared_ptr<const NativeMGARDPlan<T>> get_plan(const std::vector<uint32_t>& dimensions, uint32_t target_level, const std::vector<uint32_t>& strides) const {
+            std::vector<uint32_t> key(dimensions);
+            key.insert(key.end(), strides.begin(), strides.end());
+            key.push_back(strides.size());
+            key.push_back(target_level);
+            std::lock_guard<std::mutex> lock(cache->mutex);
+            auto it = cache->plans.find(key);
+            if(it != cache->plans.end()) return it->second;
+            if(cache->plans.size() >= MAX_NUM_PLANS) cache->plans.clear();
+            auto plan = std::make_shared<const NativeMGARDPlan<T>>(dimensions, target_level, strides, hierarchical);
+            cache->plans[key] = plan;
+            return plan;
+        }
+        // linear interpolation of the coefficient positions from the nodal values (reordered lines)
+        static void interpolate_lines(T * pos, size_t n, size_t stride, size_t width, T * buffer){
+            const size_t n_nodal = (n >> 1) + 1;
+            const size_t n_coeff = n - n_nodal;
+            for(size_t i=0; i<n_coeff; i++){
+                T * c = pos + (n_nodal + i) * stride;
+                T const * left = pos + i * stride;
+                T const * right = left + stride;
+                for(size_t k=0; k<width; k++){
+                    c[k] = (left[k] + right[k]) / 2;
+                }
+            }
+        }
+        // L2 projection of a line of the (reordered) fine grid function onto the coarse nodes:
+        // load vector R * M_fine * w, then solve M_coarse * z = load; z overwrites the nodal part
+        // with unit fine spacing, the load is a_{j-1}/12 + 5a_j/6 + a_{j+1}/12 + (b_{j-1} + b_j)/2
+        // for nodal values a and coefficients b, and M_coarse = tridiag(1/3, 4/3, 1/3) with 2/3 at both ends
+        // the coefficient next to the extrapolated node of even sizes is not stored;
+        // it is the average of its two nodal neighbors, as the original sample is reproduced by the interpolant
+        static void project_lines(T * pos, size_t n, size_t stride, size_t width, T * buffer, const std::vector<T>& factors){
+            const size_t n_nodal = (n >> 1) + 1;
+            const size_t n_coeff = n - n_nodal;
+            for(size_t i=0; i<n; i++){
+                memcpy(buffer + i * width, pos + i * stride, width * sizeof(T));
+            }
+            T const * a = buffer;
+            T const * b = buffer + n_nodal * width;
+            for(size_t j=0; j<n_nodal; j++){
+                T * load = pos + j * stride;
+                T const * a_cur = a + j * width;
+                T const * a_prev = (j > 0) ? a_cur - width : NULL;
+                T const * a_next = (j + 1 < n_nodal) ? a_cur + width : NULL;
+                T const * b_prev = ((j > 0) && (j - 1 < n_coeff)) ? b + (j - 1) * width : NULL;
+                T const * b_cur = (j < n_coeff) ? b + j * width : NULL;
+                const T diag = (a_prev && a_next) ? (T) 5 / 6 : (T) 5 / 12;
+                for(size_t k=0; k<width; k++){
+                    load[k] = diag * a_cur[k];
+                }
+                if(a_prev) for(size_t k=0; k<width; k++) load[k] += a_prev[k] / 12;
+                if(a_next) for(size_t k=0; k<width; k++) load[k] += a_next[k] / 12;
+                if(b_prev) for(size_t k=0; k<width; k++) load[k] += b_prev[k] / 2;
+                if(b_cur) for(size_t k=0; k<width; k++) load[k] += b_cur[k] / 2;
+            }
+            if(n_nodal == n_coeff + 2){
+                T * load_prev = pos + (n_nodal - 2) * stride;
+                T * load_last = pos + (n_nodal - 1) * stride;
+                T const * a_prev = a + (n_nodal - 2) * width;
+                T const * a_last = a + (n_nodal - 1) * width;
+                for(size_t k=0; k<width; k++){
+                    T missing = (a_prev[k] + a_last[k]) / 4;
+                    load_prev[k] += missing;
+                    load_last[k] += missing;
+                }
+            }
+            // Thomas algorithm with the precomputed forward elimination factors
+            // factors[j] = 1 / (diag_j - off * c'_{j-1}), and c'_j = off * factors[j]
+            const T off = (T) 1 / 3;
+            T * prev = pos;
+            for(size_t k=0; k<width; k++) prev[k] *= factors[0];
+            for(size_t j=1; j<n_nodal; j++){
+                T * cur = pos + j * stride;
+                for(size_t k=0; k<width; k++){
+                    cur[k] = (cur[k] - off * prev[k]) * factors[j];
+                }
+                prev = cur;
+            }
+            for(size_t j=n_nodal-1; j>0; j--){
+                T * cur = pos + (j - 1) * stride;
+                T const * next = pos + j * stride;
+                const T c = off * factors[j - 1];
+                for(size_t k=0; k<width; k++){
+                    cur[k] -= c * next[k];
+                }
+            }
+        }
+        // copy the box of data into the compact buffer w, rows along the last dimension in parallel
+        // entries in the coarse box are set to 0 if zero_coarse
+        void copy_box(T const * data, const std::vector<uint32_t>& box, const std::vector<size_t>& strides, T * w, bool zero_coarse) const {
+            const int last = box.size() - 1;
+            const size_t row_size = box[last];
+            const int64_t num_rows = box_num_elements(box) / row_size;
+            const uint32_t coarse_last = coarse_line_size(box[last]);
+            #pragma omp parallel for schedule(static)
+            for(int64_t r=0; r<num_rows; r++){
+                size_t offset = 0;
+                bool in_coarse = true;
+                size_t index = r;
+                for(int i=last-1; i>=0; i--){
+                    size_t id = index % box[i];
+                    index /= box[i];
+                    offset += id * strides[i];
+                    in_coarse = in_coarse && (id < coarse_line_size(box[i]));
+                }
+                T * w_row = w + r * row_size;
+                memcpy(w_row, data + offset, row_size * sizeof(T));
+                if(zero_coarse && in_coarse) memset(w_row, 0, coarse_last * sizeof(T));
+            }
+        }
+        // multilinear interpolant of the nodal values at all points of the box, stored compactly in w
+        void compute_interpolant(T const * data, const std::vector<uint32_t>& box, const std::vector<size_t>& strides, T * w) const {
+            copy_box(data, box, strides, w, false);
+            auto w_strides = compact_strides(box);
+            for(int d=box.size()-1; d>=0; d--){
+                if(box[d] >= 3) batched_line_transform(w, box, w_strides, d, interpolate_lines);
+            }
+        }
+        // subtract (decompose) or add back (recompose) the interpolant at the coefficient positions
+        void update_coefficients(T * data, const std::vector<uint32_t>& box, const std::vector<size_t>& strides, T const * w, bool add) const {
+            const int last = box.size() - 1;
+            const size_t row_size = box[last];
+            const int64_t num_rows = box_num_elements(box) / row_size;
+            const uint32_t coarse_last = coarse_line_size(box[last]);
+            #pragma omp parallel for schedule(static)
+            for(int64_t r=0; r<num_rows; r++){
+                size_t offset = 0;
+                bool in_coarse = true;
+                size_t index = r;
+                for(int i=last-1; i>=0; i--){
+                    size_t id = index % box[i];
+                    index /= box[i];
+                    offset += id * strides[i];
+                    in_coarse = in_coarse && (id < coarse_line_size(box[i]));
+                }
+                T * row = data + offset;
+                T const * w_row = w + r * row_size;
+                const size_t begin = in_coarse ? coarse_last : 0;
+                if(add){
+                    for(size_t k=begin; k<row_size; k++) row[k] += w_row[k];
+                }
+                else{
+                    for(size_t k=begin; k<row_size; k++) row[k] -= w_row[k];
+                }
+            }
+        }
+        // add (decompose) or subtract (recompose) the projection of the multilevel component to the nodal values
+        // the multilevel component is the stored data with the coarse nodal values set to 0
+        void apply_correction(T * data, const std::vector<uint32_t>& box, const std::vector<size_t>& strides, const std::vector<std::vector<T>>& level_factors, T * w, bool add) const {
+            const int last = box.size() - 1;
+            const auto coarse = coarse_box(box);
+            const auto w_strides = compact_strides(box);
+            copy_box(data, box, strides, w, true);
+            // project along each dimension; the box of w shrinks to the coarse size
+            std::vector<uint32_t> w_box(box);
+            for(int d=last; d>=0; d--){
+                if(box[d] >= 3){
+                    const std::vector<T>& factors = level_factors[d];
+                    batched_line_transform(w, w_box, w_strides, d, [&factors](T * pos, size_t n, size_t stride, size_t width, T * buffer){
+                        project_lines(pos, n, stride, width, buffer, factors);
+                    });
+                    w_box[d] = coarse[d];
+                }
+            }
+            // update the coarse box of data
+            const int64_t num_coarse_rows = box_num_elements(coarse) / coarse[last];
+            #pragma omp parallel for schedule(static)
+            for(int64_t r=0; r<num_coarse_rows; r++){
+                size_t offset = 0;
+                size_t w_offset = 0;
+                size_t index = r;
+                for(int i=last-1; i>=0; i--){
+                    size_t id = index % coarse[i];
+                    index /= coarse[i];
+                    offset += id * strides[i];
+                    w_offset += id * w_strides[i];
+                }
+                T * row = data + offset;
+                T const * w_row = w + w_offset;
+                if(add){
+                    for(size_t k=0; k<coarse[last]; k++) row[k] += w_row[k];
+                }
+                else{
+                    for(size_t k=0; k<coarse[last]; k++) row[k] -= w_row[k];
+                }
+            }
+        }
+        static const size_t MAX_NUM_PLANS = 16;
+        bool hierarchical = false;
+        std::shared_ptr<PlanCache> cache;
+    };
+
+    // in-tree MGARD decomposer with orthogonal basis
+    template<class T>
+    class NativeMGARDOrthogonalDecomposer : public concepts::DecomposerInterface<T> {
+    public:
+        NativeMGARDOrthogonalDecomposer() : transform(false) {}
+        void decompose(T * data, const std::vector<uint32_t>& dimensions, uint32_t target_level, std::vector<uint32_t> strides=std::vector<uint32_t>()) const {
+            transform.decompose(data, dimensions, target_level, strides);
+        }
+        void recompose(T * data, const std::vector<uint32_t>& dimensions, uint32_t target_level, std::vector<uint32_t> strides=std::vector<uint32_t>()) const {
+            transform.recompose(data, dimensions, target_level, strides);
+        }
+        uint32_t max_level(const std::vector<uint32_t>& dimensions) const {
+            return max_box_level(dimensions);
+        }
+        void print() const {
+            std::cout << "Native MGARD orthogonal decomposer" << std::endl;
+        }
+    private:
+        NativeMGARDTransform<T> transform;
+    };
+
+    // in-tree MGARD decomposer with hierarchical basis
+    template<class T>
+    class NativeMGARDHierarchicalDecomposer : public concepts::DecomposerInterface<T> {
+    public:
+        NativeMGARDHierarchicalDecomposer() : transform(true) {}
+        void decompose(T * data, const std::vector<uint32_t>& dimensions, uint32_t target_level, std::vector<uint32_t> strides=std::vector<uint32_t>()) const {
+            transform.decompose(data, dimensions, target_level, strides);
+        }
+        void recompose(T * data, const std::vector<uint32_t>& dimensions, uint32_t target_level, std::vector<uint32_t> strides=std::vector<uint32_t>()) const {
+            transform.recompose(data, dimensions, target_level, strides);
+        }
+        uint32_t max_level(const std::vector<uint32_t>& dimensions) const {
+            return max_box_level(dimensions);
+        }
+        void print() const {
+            std::cout << "Native MGARD hierarchical decomposer" << std::endl;
+        }
+    private:
+        NativeMGARDTransform<T> transform;
+    };
+}
+#endif
@@ -0,0 +1,219 @@
+#ifndef _MDR_WAVELET_DECOMPOSER_HPP
+#define _MDR_WAVELET_DECOMPOSER_HPP
+
+#include "DecomposerInterface.hpp"
+#include "LineTransform.hpp"
+
+namespace MDR {
+    enum WaveletType {CDF53, CDF97};
+
+    // separable biorthogonal wavelet decomposer with CDF 5/3 or 9/7 lifting
+    // each level lifts the lines of every dimension in place (symmetric extension at the boundaries)
+    // and stores them as (low, high) halves, so the level layout is the one of the MGARD decomposers
+    // a dimension of even size n lifts its first n - 1 samples and keeps the last sample as an extra
+    // low value, which gives the (n >> 1) + 1 nodes expected by the interleavers
+    // low-pass filters have unit DC gain, so coarse levels stay in the range of the data
+    template<class T>
+    class WaveletDecomposer : public concepts::DecomposerInterface<T> {
+    public:
+        WaveletDecomposer(WaveletType type=CDF97) : type(type) {}
+        void decompose(T * data, const std::vector<uint32_t>& dimensions, uint32_t target_level, std::vector<uint32_t> strides=std::vector<uint32_t>()) const {
+            auto data_strides = data_strides_of(dimensions, strides);
+            const WaveletType type = this->type;
+            std::vector<uint32_t> box(dimensions);
+            for(int level=0; level<target_level; level++){
+                for(int d=0; d<box.size(); d++){
+                    if(box[d] >= 3) batched_line_transform(data, box, data_strides, d, [type](T * pos, size_t n, size_t stride, size_t width, T * buffer){
+                        forward_lines(pos, n, stride, width, buffer, type);
+                    });
+                }
+                box = coarse_box(box);
+            }
+        }
+        void recompose(T * data, const std::vector<uint32_t>& dimensions, uint32_t target_level, std::vector<uint32_t> strides=std::vector<uint32_t>()) const {
+            auto data_strides = data_strides_of(dimensions, strides);
+            const WaveletType type = this->type;
+            std::vector<std::vector<uint32_t>> boxes(1, dimensions);
+            for(int level=1; level<target_level; level++){
+                boxes.push_back(coarse_box(boxes.back()));
+            }
+            for(int level=target_level-1; level>=0; level--){
+                const std::vector<uint32_t>& box = boxes[level];
+                for(int d=box.size()-1; d>=0; d--){
+                    if(box[d] >= 3) batched_line_transform(data, box, data_strides, d, [type](T * pos, size_t n, size_t stride, size_t width, T * buffer){
+                        inverse_lines(pos, n, stride, width, buffer, type);
+                    });
+                }
+            }
+        }
+        /*
+            squared L2 norms of the synthesis functions of each level, for L2 error estimation
+            @params num_dims: number of dimensions
+            @params target_level: number of decomposition levels
+            1D norms are measured by recomposing unit coefficients in the middle and at both ends of a line,
+            taking the maximum; a level mixes subbands that are low or high in every dimension,
+            so its weight is the largest product of the 1D norms over these subbands
+        */
+        std::vector<T> level_weights(int num_dims, uint32_t target_level) const {
+            std::vector<uint32_t> line(1, (16u << target_level) + 1);
+            auto level_dims = std::vector<std::vector<uint32_t>>(1, line);
+            for(int level=0; level<target_level; level++){
+                level_dims.push_back(coarse_box(level_dims.back()));
+            }
+            // low[j] and high[j]: norms after j + 1 decomposition steps
+            std::vector<T> low(target_level);
+            std::vector<T> high(target_level);
+            for(int j=0; j<target_level; j++){
+                low[j] = max_squared_norm(line, j + 1, 0, level_dims[j + 1][0]);
+                high[j] = max_squared_norm(line, j + 1, level_dims[j + 1][0], level_dims[j][0]);
+            }
+            std::vector<T> weights(target_level + 1, 1);
+            if(target_level == 0) return weights;
+            weights[0] = pow(low[target_level - 1], num_dims);
+            for(int l=1; l<=target_level; l++){
+                const int j = target_level - l;
+                weights[l] = high[j] * pow(std::max(low[j], high[j]), num_dims - 1);
+            }
+            return weights;
+        }
+        uint32_t max_level(const std::vector<uint32_t>& dimensions) const {
+            return max_box_level(dimensions);
+        }
+        void print() const {
+            std::cout << "Wavelet decomposer (" << (type == CDF53 ? "CDF 5/3" : "CDF 9/7") << ")" << std::endl;
+        }
+    private:
+        // lifting coefficients of CDF 9/7, and the scaling giving unit DC gain to the low-pass filter
+        static constexpr double ALPHA = -1.586134342059924;
+        static constexpr double BETA = -0.052980118572961;
+        static constexpr double GAMMA = 0.882911075530934;
+        static constexpr double DELTA = 0.443506852043971;
+        static constexpr double K = 1.230174104914001;
+
+        // largest squared norm of the synthesis functions of coefficients [begin, end) of a line
+        T max_squared_norm(const std::vector<uint32_t>& line, uint32_t num_levels, uint32_t begin, uint32_t end) const {
+            T max_norm = 0;
+            for(uint32_t index : {begin, (begin + end) / 2, end - 1}){
+                std::vector<T> impulse(line[0], 0);
+                impulse[index] = 1;
+                recompose(impulse.data(), line, num_levels);
+                T norm = 0;
+                for(const auto& v:impulse) norm += v * v;
+                max_norm = std::max(max_norm, norm);
+            }
+            return max_norm;
+        }
+        // d_i += c * (s_i + s_{i+1}) for the nd odd samples, which all have two even neighbors
+        static inline void predict(T const * s, T * d, size_t nd, size_t width, T c){
+            for(size_t i=0; i<nd; i++){
+                T const * s0 = s + i * width;
+                T const * s1 = s0 + width;
+                T * di = d + i * width;
+                for(size_t k=0; k<width; k++){
+                    di[k] += c * (s0[k] + s1[k]);
+                }
+            }
+        }
+        // s_i += c * (d_{i-1} + d_i) for the nd + 1 even samples, with symmetric extension at both ends
+        static inline void update(T * s, T const * d, size_t nd, size_t width, T c){
+            for(size_t k=0; k<width; k++){
+                s[k] += 2 * c * d[k];
+            }
+            for(size_t i=1; i<nd; i++){
+                T const * d0 = d + (i - 1) * width;
+                T const * d1 = d0 + width;
+                T * si = s + i * width;
+                for(size_t k=0; k<width; k++){
+                    si[k] += c * (d0[k] + d1[k]);
+                }
+            }
+            T * s_last = s + nd * width;
+            T const * d_last = d + (nd - 1) * width;
+            for(size_t k=0; k<width; k++){
+                s_last[k] += 2 * c * d_last[k];
+            }
+        }
+        static inline void scale(T * x, size_t num, T c){
+            for(size_t i=0; i<num; i++){
+                x[i] *= c;
+            }
+        }
+        // lift a batch of lines and store them as (low, high) halves
+        static void forward_lines(T * pos, size_t n, size_t stride, size_t width, T * buffer, WaveletType type){
+            const size_t n_lifted = (n & 1) ? n : n - 1;
+            const size_t nd = n_lifted >> 1;
+            const size_t ns = nd + 1;
+            const size_t n_nodal = (n >> 1) + 1;
+            T * s = buffer;
+            T * d = buffer + ns * width;
+            for(size_t i=0; i<nd; i++){
+                memcpy(s + i * width, pos + 2 * i * stride, width * sizeof(T));
+                memcpy(d + i * width, pos + (2 * i + 1) * stride, width * sizeof(T));
+            }
+            memcpy(s + nd * width, pos + 2 * nd * stride, width * sizeof(T));
+            if(type == CDF53){
+                predict(s, d, nd, width, -0.5);
+                update(s, d, nd, width, 0.25);
+            }
+            else{
+                predict(s, d, nd, width, ALPHA);
+                update(s, d, nd, width, BETA);
+                predict(s, d, nd, width, GAMMA);
+                update(s, d, nd, width, DELTA);
+                scale(s, ns * width, 1 / K);
+                scale(d, nd * width, K / 2);
+            }
+            // the last sample of even sizes is kept as is (it has not been overwritten yet)
+            if(n_nodal > ns){
+                memcpy(pos + ns * stride, pos + (n - 1) * stride, width * sizeof(T));
+            }
+            for(size_t i=0; i<ns; i++){
+                memcpy(pos + i * stride, s + i * width, width * sizeof(T));
+            }
+            for(size_t i=0; i<nd; i++){
+                memcpy(pos + (n_nodal + i) * stride, d + i * width, width * sizeof(T));
+            }
+        }
+        // inverse of forward_lines
+        static void inverse_lines(T * pos, size_t n, size_t stride, size_t width, T * buffer, WaveletType type){
+            const size_t n_lifted = (n & 1) ? n : n - 1;
+            const size_t nd = n_lifted >> 1;
+            const size_t ns = nd + 1;
+            const size_t n_nodal = (n >> 1) + 1;
+            T * s = buffer;
+            T * d = buffer + ns * width;
+            T * last = d + nd * width;
+            for(size_t i=0; i<ns; i++){
+                memcpy(s + i * width, pos + i * stride, width * sizeof(T));
+            }
+            for(size_t i=0; i<nd; i++){
+                memcpy(d + i * width, pos + (n_nodal + i) * stride, width * sizeof(T));
+            }
+            if(n_nodal > ns){
+                memcpy(last, pos + ns * stride, width * sizeof(T));
+            }
+            if(type == CDF53){
+                update(s, d, nd, width, -0.25);
+                predict(s, d, nd, width, 0.5);
+            }
+            else{
+                scale(s, ns * width, K);
+                scale(d, nd * width, 2 / K);
+                update(s, d, nd, width, -DELTA);
+                predict(s, d, nd, width, -GAMMA);
+                update(s, d, nd, width, -BETA);
+                predict(s, d, nd, width, -ALPHA);
+            }
+            for(size_t i=0; i<nd; i++){
+                memcpy(pos + 2 * i * stride, s + i * width, width * sizeof(T));
+                memcpy(pos + (2 * i + 1) * stride, d + i * width, width * sizeof(T));
+            }
+            memcpy(pos + 2 * nd * stride, s + nd * width, width * sizeof(T));
+            if(n_nodal > ns){
+                memcpy(pos + (n - 1) * stride, last, width * sizeof(T));
+            }
+        }
+        WaveletType type = CDF97;
+    };
+}
+#endif
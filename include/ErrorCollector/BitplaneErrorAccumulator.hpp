@@ -0,0 +1,162 @@
+#ifndef _MDR_BITPLANE_ERROR_ACCUMULATOR_HPP
+#define _MDR_BITPLANE_ERROR_ACCUMULATOR_HPP
+
+#include <vector>
+#include <cmath>
+#include <type_traits>
+#include <cstring>
+#include <cstdint>
+
+#define EXACT_CONVERSION_BITS 51 // fixed points below 2^51 are converted to double without the scalar conversion
+
+namespace MDR {
+    // squared error of bitplane truncation, accumulated block by block on the fixed-point values of the encoder
+    // level_errors[i] is the squared error when the i most significant bitplanes are kept
+    // for bitplanes above the most significant bit of a block the error is the squared value itself,
+    // so only the bitplanes below it are accumulated, one vectorizable pass over the block per bitplane
+    // exact errors take one term per value and significant bitplane: a pass per value up to its own leading one
+    // does not vectorize and is slower than these passes
+    template<class T_fp>
+    class BitplaneErrorAccumulator {
+    public:
+        BitplaneErrorAccumulator(int num_bitplanes) : num_bitplanes(num_bitplanes), errors(num_bitplanes + 1, 0), full_errors(num_bitplanes + 1, 0) {
+            static_assert(std::is_unsigned<T_fp>::value, "BitplaneErrorAccumulator: fixed points must be unsigned integers.");
+        }
+
+        // sign-magnitude fixed points
+        /*
+            @params fp: fixed-point magnitudes of the shifted data
+            @params fraction: fractional part of the shifted magnitudes
+            @params n: number of elements in the block
+        */
+        void accumulate(T_fp const * fp, double const * fraction, size_t n){
+            T_fp block_bits = 0;
+            for(int j=0; j<n; j++){
+                block_bits |= fp[j];
+            }
+            const int num_significant = significant_bitplanes(block_bits);
+            for(int k=0; k<num_significant; k++){
+                const T_fp mask = (((T_fp) 1) << k) - 1;
+                double sum = 0;
+                if(k < EXACT_CONVERSION_BITS){
+                    for(int j=0; j<n; j++){
+                        double diff = to_double(fp[j] & mask) + fraction[j];
+                        sum += diff * diff;
+                    }
+                }
+                else{
+                    for(int j=0; j<n; j++){
+                        double diff = (double) (fp[j] & mask) + fraction[j];
+                        sum += diff * diff;
+                    }
+                }
+                errors[num_bitplanes - k] += sum;
+            }
+            double sum = 0;
+            if(num_significant < EXACT_CONVERSION_BITS){
+                for(int j=0; j<n; j++){
+                    double val = to_double(fp[j]) + fraction[j];
+                    sum += val * val;
+                }
+            }
+            else{
+                for(int j=0; j<n; j++){
+                    double val = (double) fp[j] + fraction[j];
+                    sum += val * val;
+                }
+            }
+            full_errors[num_bitplanes - num_significant] += sum;
+        }
+
+        // negabinary fixed points
+        /*
+            @params nb: negabinary representation of the integer part of the shifted data
+            @params fraction: signed fractional part of the shifted data
+            @params n: number of elements in the block
+        */
+        void accumulate_negabinary(T_fp const * nb, double const * fraction, size_t n){
+            T_fp block_bits = 0;
+            for(int j=0; j<n; j++){
+                block_bits |= nb[j];
+            }
+            const int num_significant = significant_bitplanes(block_bits);
+            for(int k=0; k<num_significant; k++){
+                const T_fp mask = (((T_fp) 1) << k) - 1;
+                double sum = 0;
+                if(k < EXACT_CONVERSION_BITS){
+                    for(int j=0; j<n; j++){
+                        double diff = to_double(negabinary2binary(nb[j] & mask)) + fraction[j];
+                        sum += diff * diff;
+                    }
+                }
+                else{
+                    for(int j=0; j<n; j++){
+                        double diff = (double) negabinary2binary(nb[j] & mask) + fraction[j];
+                        sum += diff * diff;
+                    }
+                }
+                errors[num_bitplanes - k] += sum;
+            }
+            double sum = 0;
+            if(num_significant < EXACT_CONVERSION_BITS){
+                for(int j=0; j<n; j++){
+                    double val = to_double(negabinary2binary(nb[j])) + fraction[j];
+                    sum += val * val;
+                }
+            }
+            else{
+                for(int j=0; j<n; j++){
+                    double val = (double) negabinary2binary(nb[j]) + fraction[j];
+                    sum += val * val;
+                }
+            }
+            full_errors[num_bitplanes - num_significant] += sum;
+        }
+
+        // level errors in the original data scale
+        /*
+            @params exp: exponent that the data was shifted by (data * 2^(num_bitplanes - exp))
+        */
+        std::vector<double> get_level_errors(int exp) const {
+            std::vector<double> level_errors(errors);
+            double suffix_sum = 0;
+            for(int i=num_bitplanes; i>=0; i--){
+                suffix_sum += full_errors[i];
+                level_errors[i] += suffix_sum;
+            }
+            for(int i=0; i<level_errors.size(); i++){
+                level_errors[i] = ldexp(level_errors[i], 2*(- num_bitplanes + exp));
+            }
+            return level_errors;
+        }
+    private:
+        inline int significant_bitplanes(T_fp bits) const {
+            int count = 0;
+            while(bits){
+                bits >>= 1;
+                count ++;
+            }
+            return (count < num_bitplanes) ? count : num_bitplanes;
+        }
+        inline int64_t negabinary2binary(const T_fp x) const {
+            using T_fps = typename std::make_signed<T_fp>::type;
+            const T_fp mask = (T_fp) 0xaaaaaaaaaaaaaaaaull;
+            return (T_fps) ((x ^ mask) - mask);
+        }
+        // exact for magnitudes below 2^EXACT_CONVERSION_BITS: the integer is added to the bits of 1.5 * 2^52,
+        // which vectorizes where the conversion of 64-bit integers is scalar
+        inline double to_double(int64_t x) const {
+            const int64_t magic_bits = 0x4338000000000000ll;
+            const double magic = 6755399441055744.0;
+            int64_t bits = x + magic_bits;
+            double val = 0;
+            memcpy(&val, &bits, sizeof(double));
+            return val - magic;
+        }
+        int num_bitplanes = 0;
+        std::vector<double> errors;
+        // squared values of blocks whose bitplanes above the index are all 0
+        std::vector<double> full_errors;
+    };
+}
+#endif
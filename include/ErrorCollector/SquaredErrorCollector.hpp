@@ -2,6 +2,7 @@
 #define _MDR_SQUARED_ERROR_COLLECTOR_HPP
 
 #include "ErrorCollectorInterface.hpp"
+#include "BitplaneErrorAccumulator.hpp"
 
 namespace MDR {
     union FloatingInt32{
@@ -23,45 +24,21 @@ namespace MDR {
         std::vector<double> collect_level_error(T const * data, size_t n, int num_bitplanes, T max_level_error) const {
             int level_exp = 0;
             frexp(max_level_error, &level_exp);
-            const int prec = std::is_same<T, double>::value ? 52 : 23;
-            using FloatingInt = typename std::conditional<std::is_same<T, double>::value, FloatingInt64, FloatingInt32>::type;
-            const int encode_prec = num_bitplanes;
-            std::vector<double> squared_error = std::vector<double>(num_bitplanes + 1, 0);
-            FloatingInt fi;
-            for(int i=0; i<n; i++){
-                if(data[i] == 0) continue;
-                int data_exp = 0;
-                frexp(data[i], &data_exp);
-                T val = data[i];
-                fi.f = val;
-                int exp_diff = level_exp - data_exp + prec - encode_prec;
-                // int exp_diff = level_exp - encode_prec - data_exp + prec + 1;
-                int index = encode_prec;
-                if(exp_diff > 0){
-                    // zeroing out unrecorded bitplanes
-                    for(int b=0; b<exp_diff; b++){
-                        fi.i &= ~(1u << b);            
-                    }
-                }
-                else{
-                    // skip padding 0s (no errors)
-                    index += exp_diff;
-                    exp_diff = 0;
-                }
-                if(index > 0){
-                    for(int b=exp_diff; b<prec; b++){
-                        // change b-th bit to 0
-                        fi.i &= ~(1u << b);
-                        squared_error[index] += (data[i] - fi.f)*(data[i] - fi.f);
-                        index --;
-                    }
-                    while(index >= 0){
-                        squared_error[index] += data[i] * data[i];
-                        index --;
-                    }
+            // accumulate on 64-bit fixed points by blocks
+            const size_t block_size = 64;
+            BitplaneErrorAccumulator<uint64_t> error_accumulator(num_bitplanes);
+            std::vector<uint64_t> int_data_buffer(block_size, 0);
+            std::vector<double> fraction_buffer(block_size, 0);
+            for(size_t i=0; i<n; i+=block_size){
+                size_t size = std::min(block_size, n - i);
+                for(int j=0; j<size; j++){
+                    T shifted_data = ldexp(fabs(data[i + j]), num_bitplanes - level_exp);
+                    int_data_buffer[j] = (uint64_t) shifted_data;
+                    fraction_buffer[j] = shifted_data - int_data_buffer[j];
                 }
+                error_accumulator.accumulate(int_data_buffer.data(), fraction_buffer.data(), size);
             }
-            return squared_error;
+            return error_accumulator.get_level_errors(level_exp);
         }
         void print() const {
             std::cout << "Squared error collector." << std::endl;
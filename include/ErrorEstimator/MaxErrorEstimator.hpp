@@ -66,5 +66,64 @@ namespace MDR {
             std::cout << "Max absolute error estimator for hierarchical basis." << std::endl;
         }
     };
+    // max error estimator for InterpolationDecomposer
+    // a prediction pass adds its coefficient error to r times the max error of its sources,
+    // where r is the sum of the absolute interpolation weights (1 for linear, 1.25 for cubic),
+    // so the coefficients of level l contribute with (1 + r + ... + r^(d-1)) * (r^d)^(target_level - l)
+    // (r^(d * (target_level - l)) for the coarsest level, whose values are stored directly)
+    template<class T>
+    class MaxErrorEstimatorIP : public MaxErrorEstimator<T> {
+    public:
+        MaxErrorEstimatorIP(int num_dims, int target_level, bool cubic=true){
+            const T r = cubic ? 1.25 : 1;
+            T level_amplification = 1;
+            T pass_sum = 0;
+            for(int i=0; i<num_dims; i++){
+                pass_sum += level_amplification;
+                level_amplification *= r;
+            }
+            c = std::vector<T>(target_level + 1);
+            T amplification = 1;
+            for(int l=target_level; l>=0; l--){
+                c[l] = ((l == 0) ? 1 : pass_sum) * amplification;
+                amplification *= level_amplification;
+            }
+        }
+        MaxErrorEstimatorIP() : MaxErrorEstimatorIP(1, 0) {}
+
+        inline T estimate_error(T error, int level) const {
+            return c[level] * error;
+        }
+        inline T estimate_error(T data, T reconstructed_data, int level) const {
+            return c[level] * (data - reconstructed_data);
+        }
+        inline T estimate_error_gain(T base, T current_level_err, T next_level_err, int level) const {
+            return c[level] * (current_level_err - next_level_err);
+        }
+        void print() const {
+            std::cout << "Max absolute error estimator for interpolation decomposer." << std::endl;
+        }
+    private:
+        std::vector<T> c;
+    };
+    // max error estimator using the error tables measured during refactoring
+    // measured errors already account for recomposition, so c = 1 and level errors add up by triangle inequality
+    template<class T>
+    class MeasuredMaxErrorEstimator : public MaxErrorEstimator<T> {
+    public:
+        MeasuredMaxErrorEstimator(){}
+        inline T estimate_error(T error, int level) const {
+            return error;
+        }
+        inline T estimate_error(T data, T reconstructed_data, int level) const {
+            return data - reconstructed_data;
+        }
+        inline T estimate_error_gain(T base, T current_level_err, T next_level_err, int level) const {
+            return current_level_err - next_level_err;
+        }
+        void print() const {
+            std::cout << "Max absolute error estimator using measured error tables." << std::endl;
+        }
+    };
 }
 #endif
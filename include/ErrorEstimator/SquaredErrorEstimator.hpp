@@ -37,6 +37,31 @@ namespace MDR {
         std::vector<T> s_table;
     };
 
+    // L2 error estimator for WaveletDecomposer
+    // the squared error is the sum of the level squared errors weighted by the squared norms
+    // of the synthesis functions; biorthogonal bases are nearly orthogonal, so cross terms are ignored
+    // the weights are given by WaveletDecomposer::level_weights
+    template<class T>
+    class L2ErrorEstimator_WT : public SquaredErrorEstimator<T> {
+    public:
+        L2ErrorEstimator_WT(const std::vector<T>& level_weights) : s_table(level_weights) {}
+        L2ErrorEstimator_WT() : s_table(1, 1) {}
+        inline T estimate_error(T error, int level) const {
+            return s_table[level] * error;
+        }
+        inline T estimate_error(T data, T reconstructed_data, int level) const {
+            return s_table[level] * (data - reconstructed_data);
+        }
+        inline T estimate_error_gain(T base, T current_level_err, T next_level_err, int level) const {
+            return s_table[level] * (current_level_err - next_level_err);
+        }
+        void print() const {
+            std::cout << "L2-norm error estimator for wavelet decomposer" << std::endl;
+        }
+    private:
+        std::vector<T> s_table;
+    };
+
     // S-norm error estimator for orthogonal basis
     template<class T>
     class SNormErrorEstimator : public SquaredErrorEstimator<T> {
@@ -2,145 +2,149 @@
 #define _MDR_BLOCKED_INTERLEAVER_HPP
 
 #include "InterleaverInterface.hpp"
+#include "LevelReader.hpp"
+#include "LevelWriter.hpp"
+#include <iostream>
+#include <cstdlib>
 
 namespace MDR {
-    // direct interleaver with in-order recording
-    template<class T>
-    class BlockedInterleaver : public concepts::InterleaverInterface<T> {
+    // cursor over the level coefficients of BlockedInterleaver (3D)
+    // the 7 subbands of a level (the whole fine box for level 0) are visited block by block,
+    // and the rows of a block along the last dimension are the contiguous runs
+    class BlockedLevelCursor {
     public:
-        BlockedInterleaver(){}
-        void interleave(T const * data, const std::vector<uint32_t>& dims, const std::vector<uint32_t>& dims_fine, const std::vector<uint32_t>& dims_coasre, T * buffer) const {
-            size_t n1_nodal = dims_coasre[0];
-            size_t n2_nodal = dims_coasre[1];
-            size_t n3_nodal = dims_coasre[2];
-            size_t n1_coeff = dims_fine[0] - n1_nodal;
-            size_t n2_coeff = dims_fine[1] - n2_nodal;
-            size_t n3_coeff = dims_fine[2] - n3_nodal;
-            size_t dim0_offset = dims[1] * dims[2];
-            size_t dim1_offset = dims[2];
-            const int block_size = 4;
-            if(n1_nodal * n2_nodal * n3_nodal == 0){
-                collect_data_3d_blocked(data, n1_coeff, n2_coeff, n3_coeff, dim0_offset, dim1_offset, block_size, buffer);
+        /*
+            @params dims: dimensions of data
+            @params dims_fine: dimensions of the fine box
+            @params dims_coarse: dimensions of the coarse box (0s for level 0)
+            @params strides: strides of data, computed from dims if empty
+            @params block_size: size of the blocks in each dimension
+        */
+        BlockedLevelCursor(const std::vector<uint32_t>& dims, const std::vector<uint32_t>& dims_fine, const std::vector<uint32_t>& dims_coarse, std::vector<uint32_t> strides=std::vector<uint32_t>(), uint32_t block_size=4)
+            : block_size(block_size) {
+            if(dims.size() != 3){
+                std::cerr << "BlockedLevelCursor: only 3D data is supported." << std::endl;
+                exit(-1);
             }
-            else{
-                const T * nodal_nodal_coeff_pos = data + n3_nodal;
-                const T * nodal_coeff_nodal_pos = data + n2_nodal * dim1_offset;
-                const T * nodal_coeff_coeff_pos = nodal_coeff_nodal_pos + n3_nodal;
-                const T * coeff_nodal_nodal_pos = data + n1_nodal * dim0_offset;
-                const T * coeff_nodal_coeff_pos = coeff_nodal_nodal_pos + n3_nodal;
-                const T * coeff_coeff_nodal_pos = coeff_nodal_nodal_pos + n2_nodal * dim1_offset;
-                const T * coeff_coeff_coeff_pos = coeff_coeff_nodal_pos + n3_nodal;
-                T * buffer_pos = buffer;
-                buffer_pos += collect_data_3d_blocked(nodal_nodal_coeff_pos, n1_nodal, n2_nodal, n3_coeff, dim0_offset, dim1_offset, block_size, buffer_pos);
-                buffer_pos += collect_data_3d_blocked(nodal_coeff_nodal_pos, n1_nodal, n2_coeff, n3_nodal, dim0_offset, dim1_offset, block_size, buffer_pos);
-                buffer_pos += collect_data_3d_blocked(nodal_coeff_coeff_pos, n1_nodal, n2_coeff, n3_coeff, dim0_offset, dim1_offset, block_size, buffer_pos);
-                buffer_pos += collect_data_3d_blocked(coeff_nodal_nodal_pos, n1_coeff, n2_nodal, n3_nodal, dim0_offset, dim1_offset, block_size, buffer_pos);
-                buffer_pos += collect_data_3d_blocked(coeff_nodal_coeff_pos, n1_coeff, n2_nodal, n3_coeff, dim0_offset, dim1_offset, block_size, buffer_pos);
-                buffer_pos += collect_data_3d_blocked(coeff_coeff_nodal_pos, n1_coeff, n2_coeff, n3_nodal, dim0_offset, dim1_offset, block_size, buffer_pos);
-                buffer_pos += collect_data_3d_blocked(coeff_coeff_coeff_pos, n1_coeff, n2_coeff, n3_coeff, dim0_offset, dim1_offset, block_size, buffer_pos);
+            size_t stride = 1;
+            for(int i=2; i>=0; i--){
+                this->strides[i] = strides.size() ? strides[i] : stride;
+                stride *= dims[i];
+                this->dims_fine[i] = dims_fine[i];
+                this->dims_coarse[i] = dims_coarse[i];
             }
+            reset();
         }
-        void reposition(T const * buffer, const std::vector<uint32_t>& dims, const std::vector<uint32_t>& dims_fine, const std::vector<uint32_t>& dims_coasre, T * data) const {
-            size_t n1_nodal = dims_coasre[0];
-            size_t n2_nodal = dims_coasre[1];
-            size_t n3_nodal = dims_coasre[2];
-            size_t n1_coeff = dims_fine[0] - n1_nodal;
-            size_t n2_coeff = dims_fine[1] - n2_nodal;
-            size_t n3_coeff = dims_fine[2] - n3_nodal;
-            size_t dim0_offset = dims[1] * dims[2];
-            size_t dim1_offset = dims[2];
-            const int block_size = 4;
-            if(n1_nodal * n2_nodal * n3_nodal == 0){
-                reposition_data_3d_blocked(buffer, n1_coeff, n2_coeff, n3_coeff, dim0_offset, dim1_offset, block_size, data);
-            }
-            else{
-                T * nodal_nodal_coeff_pos = data + n3_nodal;
-                T * nodal_coeff_nodal_pos = data + n2_nodal * dim1_offset;
-                T * nodal_coeff_coeff_pos = nodal_coeff_nodal_pos + n3_nodal;
-                T * coeff_nodal_nodal_pos = data + n1_nodal * dim0_offset;
-                T * coeff_nodal_coeff_pos = coeff_nodal_nodal_pos + n3_nodal;
-                T * coeff_coeff_nodal_pos = coeff_nodal_nodal_pos + n2_nodal * dim1_offset;
-                T * coeff_coeff_coeff_pos = coeff_coeff_nodal_pos + n3_nodal;
-                T const * buffer_pos = buffer;
-                buffer_pos += reposition_data_3d_blocked(buffer_pos, n1_nodal, n2_nodal, n3_coeff, dim0_offset, dim1_offset, block_size, nodal_nodal_coeff_pos);
-                buffer_pos += reposition_data_3d_blocked(buffer_pos, n1_nodal, n2_coeff, n3_nodal, dim0_offset, dim1_offset, block_size, nodal_coeff_nodal_pos);
-                buffer_pos += reposition_data_3d_blocked(buffer_pos, n1_nodal, n2_coeff, n3_coeff, dim0_offset, dim1_offset, block_size, nodal_coeff_coeff_pos);
-                buffer_pos += reposition_data_3d_blocked(buffer_pos, n1_coeff, n2_nodal, n3_nodal, dim0_offset, dim1_offset, block_size, coeff_nodal_nodal_pos);
-                buffer_pos += reposition_data_3d_blocked(buffer_pos, n1_coeff, n2_nodal, n3_coeff, dim0_offset, dim1_offset, block_size, coeff_nodal_coeff_pos);
-                buffer_pos += reposition_data_3d_blocked(buffer_pos, n1_coeff, n2_coeff, n3_nodal, dim0_offset, dim1_offset, block_size, coeff_coeff_nodal_pos);
-                buffer_pos += reposition_data_3d_blocked(buffer_pos, n1_coeff, n2_coeff, n3_coeff, dim0_offset, dim1_offset, block_size, coeff_coeff_coeff_pos);
+        // offset of the next contiguous run and its length (at most count elements)
+        size_t next_run(size_t& offset, size_t count){
+            while(run_remaining == 0){
+                if(!next_row()) return 0;
             }
+            size_t length = (count < run_remaining) ? count : run_remaining;
+            offset = run_offset;
+            run_offset += length;
+            run_remaining -= length;
+            return length;
         }
-        void print() const {
-            std::cout << "Blocked interleaver" << std::endl;
+        void reset(){
+            subband = 0;
+            in_box = false;
+            run_remaining = 0;
         }
     private:
-        size_t collect_data_3d_blocked(const T * data, const size_t n1, const size_t n2, const size_t n3, const size_t dim0_offset, const size_t dim1_offset, const int block_size, T * buffer) const{
-            size_t num_block_1 = (n1 - 1) / block_size + 1;
-            size_t num_block_2 = (n2 - 1) / block_size + 1;
-            size_t num_block_3 = (n3 - 1) / block_size + 1;
-            size_t index = 0;
-            const T * data_x_pos = data;
-            for(int i=0; i<num_block_1; i++){
-                int size_1 = (i == num_block_1 - 1) ? n1 - i * block_size : block_size;
-                const T * data_y_pos = data_x_pos;
-                for(int j=0; j<num_block_2; j++){
-                    int size_2 = (j == num_block_2 - 1) ? n2 - j * block_size : block_size;
-                    const T * data_z_pos = data_y_pos;
-                    for(int k=0; k<num_block_3; k++){
-                        int size_3 = (k == num_block_3 - 1) ? n3 - k * block_size : block_size;
-                        const T * cur_data_pos = data_z_pos;
-                        for(int ii=0; ii<size_1; ii++){
-                            for(int jj=0; jj<size_2; jj++){
-                                for(int kk=0; kk<size_3; kk++){
-                                    buffer[index ++] = *cur_data_pos;
-                                    cur_data_pos ++;
-                                }
-                                cur_data_pos += dim1_offset - size_3;
-                            }
-                            cur_data_pos += dim0_offset - size_2 * dim1_offset;
-                        }
-                        data_z_pos += size_3;
-                    }
-                    data_y_pos += dim1_offset * size_2;
+        // move to the next non-empty box: the fine box minus the coarse box for level 0, otherwise the subbands
+        // in the order nodal/coeff per dimension, with the first dimension as the highest bit
+        bool start_box(){
+            const bool level_zero = (dims_coarse[0] * dims_coarse[1] * dims_coarse[2] == 0);
+            while(++ subband < 8){
+                if(level_zero && (subband > 1)) return false;
+                bool empty = false;
+                base_offset = 0;
+                for(int d=0; d<3; d++){
+                    bool coeff = level_zero || ((subband >> (2 - d)) & 1);
+                    uint32_t begin = (coeff && !level_zero) ? dims_coarse[d] : 0;
+                    size[d] = (coeff ? dims_fine[d] - dims_coarse[d] : dims_coarse[d]);
+                    base_offset += (size_t) begin * strides[d];
+                    block[d] = 0;
+                    if(size[d] == 0) empty = true;
                 }
-                data_x_pos += dim0_offset * size_1;
+                if(empty) continue;
+                row[0] = row[1] = 0;
+                return true;
             }
-            return index;
+            return false;
         }
-        size_t reposition_data_3d_blocked(const T * buffer, const size_t n1, const size_t n2, const size_t n3, const size_t dim0_offset, const size_t dim1_offset, const int block_size, T * data) const{
-            size_t num_block_1 = (n1 - 1) / block_size + 1;
-            size_t num_block_2 = (n2 - 1) / block_size + 1;
-            size_t num_block_3 = (n3 - 1) / block_size + 1;
-            size_t index = 0;
-            T * data_x_pos = data;
-            for(int i=0; i<num_block_1; i++){
-                int size_1 = (i == num_block_1 - 1) ? n1 - i * block_size : block_size;
-                T * data_y_pos = data_x_pos;
-                for(int j=0; j<num_block_2; j++){
-                    int size_2 = (j == num_block_2 - 1) ? n2 - j * block_size : block_size;
-                    T * data_z_pos = data_y_pos;
-                    for(int k=0; k<num_block_3; k++){
-                        int size_3 = (k == num_block_3 - 1) ? n3 - k * block_size : block_size;
-                        T * cur_data_pos = data_z_pos;
-                        for(int ii=0; ii<size_1; ii++){
-                            for(int jj=0; jj<size_2; jj++){
-                                for(int kk=0; kk<size_3; kk++){
-                                    *cur_data_pos = buffer[index ++];
-                                    cur_data_pos ++;
-                                }
-                                cur_data_pos += dim1_offset - size_3;
-                            }
-                            cur_data_pos += dim0_offset - size_2 * dim1_offset;
-                        }
-                        data_z_pos += size_3;
+        inline uint32_t block_extent(int d) const {
+            return (size[d] - block[d] < block_size) ? size[d] - block[d] : block_size;
+        }
+        // locate the next row of the current block, moving to the next block or box when it is done
+        bool next_row(){
+            if(!in_box){
+                if(!start_box()) return false;
+                in_box = true;
+            }
+            else if(++ row[1] == block_extent(1)){
+                row[1] = 0;
+                if(++ row[0] == block_extent(0)){
+                    row[0] = 0;
+                    int d = 2;
+                    while(d >= 0){
+                        block[d] += block_size;
+                        if(block[d] < size[d]) break;
+                        block[d] = 0;
+                        d --;
+                    }
+                    if(d < 0){
+                        in_box = false;
+                        return next_row();
                     }
-                    data_y_pos += dim1_offset * size_2;
                 }
-                data_x_pos += dim0_offset * size_1;
             }
-            return index;
+            run_offset = base_offset + (size_t) (block[0] + row[0]) * strides[0] + (size_t) (block[1] + row[1]) * strides[1] + (size_t) block[2] * strides[2];
+            run_remaining = block_extent(2);
+            return true;
+        }
+        uint32_t block_size = 4;
+        uint32_t dims_fine[3] = {0};
+        uint32_t dims_coarse[3] = {0};
+        size_t strides[3] = {0};
+        // current box, block and row in the block
+        int subband = 0;
+        bool in_box = false;
+        uint32_t size[3] = {0};
+        size_t base_offset = 0;
+        uint32_t block[3] = {0};
+        uint32_t row[2] = {0};
+        size_t run_offset = 0;
+        size_t run_remaining = 0;
+    };
+
+    // blocked interleaver for 3D data: coefficients are recorded subband by subband, in blocks of block_size^3
+    template<class T>
+    class BlockedInterleaver : public concepts::InterleaverInterface<T> {
+    public:
+        BlockedInterleaver(uint32_t block_size=4) : block_size(block_size) {}
+        void interleave(T const * data, const std::vector<uint32_t>& dims, const std::vector<uint32_t>& dims_fine, const std::vector<uint32_t>& dims_coasre, T * buffer, std::vector<uint32_t> strides=std::vector<uint32_t>()) const {
+            auto reader = level_reader(data, dims, dims_fine, dims_coasre, strides);
+            reader.read(buffer, (size_t) -1);
+        }
+        void reposition(T const * buffer, const std::vector<uint32_t>& dims, const std::vector<uint32_t>& dims_fine, const std::vector<uint32_t>& dims_coasre, T * data, std::vector<uint32_t> strides=std::vector<uint32_t>()) const {
+            auto writer = level_writer(data, dims, dims_fine, dims_coasre, strides);
+            writer.write(buffer, (size_t) -1);
+        }
+        // reader visiting the level coefficients in place, in the same order as interleave
+        CursorLevelReader<T, BlockedLevelCursor> level_reader(T const * data, const std::vector<uint32_t>& dims, const std::vector<uint32_t>& dims_fine, const std::vector<uint32_t>& dims_coasre, std::vector<uint32_t> strides=std::vector<uint32_t>()) const {
+            return CursorLevelReader<T, BlockedLevelCursor>(data, BlockedLevelCursor(dims, dims_fine, dims_coasre, strides, block_size));
         }
+        // writer storing the level coefficients in place, in the same order as reposition
+        CursorLevelWriter<T, BlockedLevelCursor> level_writer(T * data, const std::vector<uint32_t>& dims, const std::vector<uint32_t>& dims_fine, const std::vector<uint32_t>& dims_coasre, std::vector<uint32_t> strides=std::vector<uint32_t>()) const {
+            return CursorLevelWriter<T, BlockedLevelCursor>(data, BlockedLevelCursor(dims, dims_fine, dims_coasre, strides, block_size));
+        }
+        void print() const {
+            std::cout << "Blocked interleaver" << std::endl;
+        }
+    private:
+        uint32_t block_size = 4;
     };
 }
 #endif
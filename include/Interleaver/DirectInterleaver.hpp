@@ -2,89 +2,91 @@
 #define _MDR_DIRECT_INTERLEAVER_HPP
 
 #include "InterleaverInterface.hpp"
+#include "LevelReader.hpp"
+#include "LevelWriter.hpp"
+#include <algorithm>
 
 namespace MDR {
     // direct interleaver with in-order recording
+    // a level (fine box minus coarse box) is split into contiguous runs along the last dimension,
+    // and rows of the first dimension are processed in parallel
     template<class T>
     class DirectInterleaver : public concepts::InterleaverInterface<T> {
     public:
         DirectInterleaver(){}
         void interleave(T const * data, const std::vector<uint32_t>& dims, const std::vector<uint32_t>& dims_fine, const std::vector<uint32_t>& dims_coasre, T * buffer, std::vector<uint32_t> strides=std::vector<uint32_t>()) const {
-            if(dims.size() == 1){
-                uint32_t count = 0;
-                for(int i=dims_coasre[0]; i<dims_fine[0]; i++){
-                    buffer[count ++] = data[i];
-                }
-            }
-            else if(dims.size() == 2){
-                uint32_t dim0_offset = strides.size() ? strides[0] : dims[1];
-                uint32_t count = 0;
-                for(int i=0; i<dims_fine[0]; i++){
-                    for(int j=0; j<dims_fine[1]; j++){
-                        if((i < dims_coasre[0]) && (j < dims_coasre[1]))
-                            continue;
-                        buffer[count ++] = data[i*dim0_offset + j];
-                    }
-                }                
-            }
-            else if(dims.size() == 3){
-                uint32_t dim0_offset = strides.size() ? strides[0] : (dims[1] * dims[2]);
-                uint32_t dim1_offset = strides.size() ? strides[1] : dims[2];
-                uint32_t count = 0;
-                for(int i=0; i<dims_fine[0]; i++){
-                    for(int j=0; j<dims_fine[1]; j++){
-                        for(int k=0; k<dims_fine[2]; k++){
-                            if((i < dims_coasre[0]) && (j < dims_coasre[1]) && (k < dims_coasre[2]))
-                                continue;
-                            buffer[count ++] = data[i*dim0_offset + j*dim1_offset + k];
-                        }
-                    }
-                }                
-            }
-            else{
-                std::cout << "Dimension higher than 4 is not supported\n";
-                exit(-1);
-            }
+            copy_level<true>(const_cast<T *>(data), dims, dims_fine, dims_coasre, buffer, strides);
         }
         void reposition(T const * buffer, const std::vector<uint32_t>& dims, const std::vector<uint32_t>& dims_fine, const std::vector<uint32_t>& dims_coasre, T * data, std::vector<uint32_t> strides=std::vector<uint32_t>()) const {
-            if(dims.size() == 1){
-                uint32_t count = 0;
-                for(int i=dims_coasre[0]; i<dims_fine[0]; i++){
-                    data[i] = buffer[count ++];
-                }
+            copy_level<false>(data, dims, dims_fine, dims_coasre, const_cast<T *>(buffer), strides);
+        }
+        // reader visiting the level coefficients in place, in the same order as interleave
+        CursorLevelReader<T, DirectLevelCursor> level_reader(T const * data, const std::vector<uint32_t>& dims, const std::vector<uint32_t>& dims_fine, const std::vector<uint32_t>& dims_coasre, std::vector<uint32_t> strides=std::vector<uint32_t>()) const {
+            return CursorLevelReader<T, DirectLevelCursor>(data, DirectLevelCursor(dims, dims_fine, dims_coasre, strides));
+        }
+        // writer storing the level coefficients in place, in the same order as reposition
+        CursorLevelWriter<T, DirectLevelCursor> level_writer(T * data, const std::vector<uint32_t>& dims, const std::vector<uint32_t>& dims_fine, const std::vector<uint32_t>& dims_coasre, std::vector<uint32_t> strides=std::vector<uint32_t>()) const {
+            return CursorLevelWriter<T, DirectLevelCursor>(data, DirectLevelCursor(dims, dims_fine, dims_coasre, strides));
+        }
+        void print() const {
+            std::cout << "Direct interleaver" << std::endl;
+        }
+    private:
+        // copy level coefficients between data and buffer
+        /*
+            @params gather: true for data -> buffer (interleave), false for buffer -> data (reposition)
+        */
+        template<bool gather>
+        void copy_level(T * data, const std::vector<uint32_t>& dims, const std::vector<uint32_t>& dims_fine, const std::vector<uint32_t>& dims_coasre, T * buffer, const std::vector<uint32_t>& strides) const {
+            const int num_dims = dims.size();
+            std::vector<size_t> data_strides(num_dims);
+            if(strides.size()){
+                for(int i=0; i<num_dims; i++) data_strides[i] = strides[i];
             }
-            else if(dims.size() == 2){
-                uint32_t dim0_offset = strides.size() ? strides[0] : dims[1];
-                uint32_t count = 0;
-                for(int i=0; i<dims_fine[0]; i++){
-                    for(int j=0; j<dims_fine[1]; j++){
-                        if((i < dims_coasre[0]) && (j < dims_coasre[1]))
-                            continue;
-                        data[i*dim0_offset + j] = buffer[count ++];
-                    }
+            else{
+                size_t stride = 1;
+                for(int i=num_dims-1; i>=0; i--){
+                    data_strides[i] = stride;
+                    stride *= dims[i];
                 }
             }
-            else if(dims.size() == 3){
-                uint32_t dim0_offset = strides.size() ? strides[0] : (dims[1] * dims[2]);
-                uint32_t dim1_offset = strides.size() ? strides[1] : dims[2];
-                uint32_t count = 0;
-                for(int i=0; i<dims_fine[0]; i++){
-                    for(int j=0; j<dims_fine[1]; j++){
-                        for(int k=0; k<dims_fine[2]; k++){
-                            if((i < dims_coasre[0]) && (j < dims_coasre[1]) && (k < dims_coasre[2]))
-                                continue;
-                            data[i*dim0_offset + j*dim1_offset + k] = buffer[count ++];
-                        }
-                    }
-                }
+            if(num_dims == 1){
+                copy_box<gather>(data, buffer, dims_fine, dims_coasre, data_strides, 0, true);
+                return;
             }
-            else{
-                std::cout << "Dimension higher than 4 is not supported\n";
-                exit(-1);
+            // number of elements in a row of the first dimension, inside and outside the coarse box
+            size_t fine_row_size = 1;
+            size_t coarse_row_size = 1;
+            for(int i=1; i<num_dims; i++){
+                fine_row_size *= dims_fine[i];
+                coarse_row_size *= dims_coasre[i];
+            }
+            const int64_t num_rows = dims_fine[0];
+            const int64_t num_coarse_rows = dims_coasre[0];
+            #pragma omp parallel for schedule(static)
+            for(int64_t i=0; i<num_rows; i++){
+                // rows in the coarse box only contain the coefficients outside it
+                size_t offset = i * fine_row_size - std::min(i, num_coarse_rows) * coarse_row_size;
+                copy_box<gather>(data + i * data_strides[0], buffer + offset, dims_fine, dims_coasre, data_strides, 1, i < num_coarse_rows);
             }
         }
-        void print() const {
-            std::cout << "Direct interleaver" << std::endl;
+        // copy the box of dimensions d.. recursively; the coarse box is excluded if in_coarse
+        // returns the number of copied elements
+        template<bool gather>
+        size_t copy_box(T * data, T * buffer, const std::vector<uint32_t>& dims_fine, const std::vector<uint32_t>& dims_coasre, const std::vector<size_t>& data_strides, int d, bool in_coarse) const {
+            const int last = dims_fine.size() - 1;
+            if(d == last){
+                size_t begin = in_coarse ? dims_coasre[last] : 0;
+                size_t length = dims_fine[last] - begin;
+                if(gather) memcpy(buffer, data + begin, length * sizeof(T));
+                else memcpy(data + begin, buffer, length * sizeof(T));
+                return length;
+            }
+            size_t count = 0;
+            for(size_t i=0; i<dims_fine[d]; i++){
+                count += copy_box<gather>(data + i * data_strides[d], buffer + count, dims_fine, dims_coasre, data_strides, d + 1, in_coarse && (i < dims_coasre[d]));
+            }
+            return count;
         }
     };
 }
@@ -15,6 +15,11 @@ namespace MDR {
 
             virtual void reposition(T const * buffer, const std::vector<uint32_t>& dims, const std::vector<uint32_t>& dims_fine, const std::vector<uint32_t>& dims_coasre, T * data, std::vector<uint32_t> strides=std::vector<uint32_t>()) const = 0;
 
+            // interleavers used by ComposedRefactor also provide
+            // level_reader(data, dims, dims_fine, dims_coasre, strides) returning a level reader (see LevelReader.hpp)
+            // interleavers used by ComposedReconstructor also provide
+            // level_writer(data, dims, dims_fine, dims_coasre, strides) returning a level writer (see LevelWriter.hpp)
+
             virtual void print() const = 0;
         };
     }
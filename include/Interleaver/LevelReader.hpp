@@ -0,0 +1,152 @@
+#ifndef _MDR_LEVEL_READER_HPP
+#define _MDR_LEVEL_READER_HPP
+
+#include <vector>
+#include <cstring>
+#include <cmath>
+
+namespace MDR {
+    // level readers feed level coefficients to the encoders chunk by chunk
+    // read(buffer, count) copies the next count elements in the interleaved order
+
+    // reader over an already interleaved level
+    template<class T>
+    class ContiguousReader {
+    public:
+        ContiguousReader(T const * data) : data(data), pos(data) {}
+        size_t read(T * buffer, size_t count){
+            memcpy(buffer, pos, count * sizeof(T));
+            pos += count;
+            return count;
+        }
+        void reset(){
+            pos = data;
+        }
+    private:
+        T const * data = NULL;
+        T const * pos = NULL;
+    };
+
+    // cursor over the level coefficients of DirectInterleaver, i.e. the fine box minus the coarse box
+    // the level is visited as contiguous runs along the last dimension, in the interleaved order
+    class DirectLevelCursor {
+    public:
+        /*
+            @params dims: dimensions of data
+            @params dims_fine: dimensions of the fine box
+            @params dims_coarse: dimensions of the coarse box (0s for level 0)
+            @params strides: strides of data, computed from dims if empty
+        */
+        DirectLevelCursor(const std::vector<uint32_t>& dims, const std::vector<uint32_t>& dims_fine, const std::vector<uint32_t>& dims_coarse, std::vector<uint32_t> strides=std::vector<uint32_t>())
+            : dims_fine(dims_fine), dims_coarse(dims_coarse), strides(strides) {
+            if(this->strides.empty()){
+                this->strides = std::vector<uint32_t>(dims.size());
+                uint32_t stride = 1;
+                for(int i=dims.size()-1; i>=0; i--){
+                    this->strides[i] = stride;
+                    stride *= dims[i];
+                }
+            }
+            reset();
+        }
+        // offset of the next contiguous run and its length (at most count elements)
+        size_t next_run(size_t& offset, size_t count){
+            while(run_remaining == 0){
+                if(finished) return 0;
+                start_run();
+            }
+            size_t length = (count < run_remaining) ? count : run_remaining;
+            offset = run_offset;
+            run_offset += length;
+            run_remaining -= length;
+            return length;
+        }
+        void reset(){
+            index = std::vector<uint32_t>(dims_fine.size(), 0);
+            run_remaining = 0;
+            finished = false;
+            for(const auto& dim:dims_fine){
+                if(dim == 0) finished = true;
+            }
+            started = false;
+        }
+    private:
+        // locate the run at the current outer index, then advance the outer index
+        void start_run(){
+            const int last = dims_fine.size() - 1;
+            if(started){
+                // advance the outer index (all dimensions but the last)
+                int d = last - 1;
+                while(d >= 0){
+                    if(++ index[d] < dims_fine[d]) break;
+                    index[d] = 0;
+                    d --;
+                }
+                if(d < 0){
+                    finished = true;
+                    return;
+                }
+            }
+            started = true;
+            bool in_coarse = true;
+            size_t offset = 0;
+            for(int d=0; d<last; d++){
+                in_coarse = in_coarse && (index[d] < dims_coarse[d]);
+                offset += (size_t) index[d] * strides[d];
+            }
+            uint32_t begin = in_coarse ? dims_coarse[last] : 0;
+            run_offset = offset + begin;
+            run_remaining = dims_fine[last] - begin;
+            if(last == 0) finished = true;
+        }
+        std::vector<uint32_t> dims_fine;
+        std::vector<uint32_t> dims_coarse;
+        std::vector<uint32_t> strides;
+        std::vector<uint32_t> index;
+        size_t run_offset = 0;
+        size_t run_remaining = 0;
+        bool started = false;
+        bool finished = false;
+    };
+
+    // reader over the level coefficients in place, without staging
+    // the cursor gives the offsets of the coefficients in the interleaved order as runs (next_run/reset)
+    template<class T, class Cursor>
+    class CursorLevelReader {
+    public:
+        CursorLevelReader(T const * data, const Cursor& cursor) : data(data), cursor(cursor) {}
+        size_t read(T * buffer, size_t count){
+            size_t num = 0;
+            size_t offset = 0;
+            while(num < count){
+                size_t length = cursor.next_run(offset, count - num);
+                if(length == 0) break;
+                memcpy(buffer + num, data + offset, length * sizeof(T));
+                num += length;
+            }
+            return num;
+        }
+        // max absolute value of the level, visited in place
+        T compute_max_abs_value(){
+            T max_val = 0;
+            size_t offset = 0;
+            size_t length = 0;
+            while((length = cursor.next_run(offset, (size_t) -1)) > 0){
+                T const * run = data + offset;
+                for(size_t i=0; i<length; i++){
+                    T val = fabs(run[i]);
+                    if(val > max_val) max_val = val;
+                }
+            }
+            reset();
+            return max_val;
+        }
+        void reset(){
+            cursor.reset();
+        }
+    private:
+        T const * data = NULL;
+        Cursor cursor;
+    };
+}
+#endif
@@ -0,0 +1,52 @@
+#ifndef _MDR_LEVEL_WRITER_HPP
+#define _MDR_LEVEL_WRITER_HPP
+
+#include "LevelReader.hpp"
+
+namespace MDR {
+    // level writers receive decoded level coefficients chunk by chunk
+    // write(buffer, count) stores the next count elements of the interleaved order to their destination
+
+    // writer into a contiguous level buffer
+    template<class T>
+    class ContiguousWriter {
+    public:
+        ContiguousWriter(T * data) : data(data), pos(data) {}
+        size_t write(T const * buffer, size_t count){
+            memcpy(pos, buffer, count * sizeof(T));
+            pos += count;
+            return count;
+        }
+        void reset(){
+            pos = data;
+        }
+    private:
+        T * data = NULL;
+        T * pos = NULL;
+    };
+
+    // writer scattering the level coefficients to their final (strided) locations given by the cursor
+    template<class T, class Cursor>
+    class CursorLevelWriter {
+    public:
+        CursorLevelWriter(T * data, const Cursor& cursor) : data(data), cursor(cursor) {}
+        size_t write(T const * buffer, size_t count){
+            size_t num = 0;
+            size_t offset = 0;
+            while(num < count){
+                size_t length = cursor.next_run(offset, count - num);
+                if(length == 0) break;
+                memcpy(data + offset, buffer + num, length * sizeof(T));
+                num += length;
+            }
+            return num;
+        }
+        void reset(){
+            cursor.reset();
+        }
+    private:
+        T * data = NULL;
+        Cursor cursor;
+    };
+}
+#endif
@@ -0,0 +1,190 @@
+#ifndef _MDR_SFC_LEVEL_CURSOR_HPP
+#define _MDR_SFC_LEVEL_CURSOR_HPP
+
+#include <vector>
+#include <cstdint>
+#include <iostream>
+#include <cstdlib>
+
+namespace MDR {
+    enum SFCOrder {MORTON, HILBERT};
+
+    // cursor over the level coefficients (fine box minus coarse box) in space-filling-curve order
+    // the level is split into 2^d - 1 subbands (coefficient or nodal range per dimension),
+    // and each subband is visited along a Morton or Hilbert curve over its bounding power-of-2 cube,
+    // skipping the sub-cubes outside the subband
+    // the traversal keeps a fixed-size stack, so no memory is allocated while visiting
+    class SFCLevelCursor {
+    public:
+        static const int MAX_DIMS = 4;
+        /*
+            @params dims: dimensions of data
+            @params dims_fine: dimensions of the fine box
+            @params dims_coarse: dimensions of the coarse box (0s for level 0)
+            @params strides: strides of data, computed from dims if empty
+            @params order: MORTON or HILBERT
+        */
+        SFCLevelCursor(const std::vector<uint32_t>& dims, const std::vector<uint32_t>& dims_fine, const std::vector<uint32_t>& dims_coarse, std::vector<uint32_t> strides=std::vector<uint32_t>(), SFCOrder order=MORTON)
+            : num_dims(dims.size()), order(order) {
+            if((num_dims < 1) || (num_dims > MAX_DIMS)){
+                std::cerr << "SFCLevelCursor: " << num_dims << " dimensions are not supported." << std::endl;
+                exit(-1);
+            }
+            size_t stride = 1;
+            for(int i=num_dims-1; i>=0; i--){
+                this->strides[i] = strides.size() ? strides[i] : stride;
+                stride *= dims[i];
+                this->dims_fine[i] = dims_fine[i];
+                this->dims_coarse[i] = dims_coarse[i];
+            }
+            reset();
+        }
+        // offset of the next coefficient; runs along a space-filling curve have length 1
+        inline size_t next_run(size_t& offset, size_t count){
+            if(finished || (count == 0)) return 0;
+            if(!next_point()){
+                while(true){
+                    if(!start_subband()){
+                        finished = true;
+                        return 0;
+                    }
+                    if(next_point()) break;
+                }
+            }
+            offset = base_offset;
+            for(int d=0; d<num_dims; d++){
+                offset += (size_t) point[d] * strides[d];
+            }
+            return 1;
+        }
+        void reset(){
+            subband = 0;
+            depth = -1;
+            finished = false;
+            for(int d=0; d<num_dims; d++){
+                if(dims_fine[d] == 0) finished = true;
+            }
+        }
+    private:
+        // move to the next non-empty subband
+        bool start_subband(){
+            const int num_subbands = 1 << num_dims;
+            while(++ subband < num_subbands){
+                bool empty = false;
+                base_offset = 0;
+                uint32_t max_size = 0;
+                for(int d=0; d<num_dims; d++){
+                    // bit d set: coefficient range [coarse, fine), otherwise nodal range [0, coarse)
+                    bool coeff = (subband >> d) & 1;
+                    uint32_t begin = coeff ? dims_coarse[d] : 0;
+                    size[d] = (coeff ? dims_fine[d] : dims_coarse[d]) - begin;
+                    base_offset += (size_t) begin * strides[d];
+                    if(size[d] == 0) empty = true;
+                    if(size[d] > max_size) max_size = size[d];
+                }
+                if(empty) continue;
+                num_levels = 0;
+                while((1u << num_levels) < max_size) num_levels ++;
+                depth = 0;
+                child[0] = 0;
+                entry[0] = 0;
+                direction[0] = 0;
+                for(int d=0; d<num_dims; d++) origin[0][d] = 0;
+                return true;
+            }
+            return false;
+        }
+        // advance to the next point of the current subband inside its size
+        bool next_point(){
+            if(depth < 0) return false;
+            if(num_levels == 0){
+                // single point subband
+                for(int d=0; d<num_dims; d++) point[d] = 0;
+                depth = -1;
+                return true;
+            }
+            const uint32_t num_children = 1u << num_dims;
+            while(depth >= 0){
+                if(child[depth] == num_children){
+                    depth --;
+                    if(depth >= 0) child[depth] ++;
+                    continue;
+                }
+                const uint32_t w = child[depth];
+                uint32_t bits = (order == HILBERT) ? hilbert_child(w, entry[depth], direction[depth]) : w;
+                const int shift = num_levels - depth - 1;
+                bool inside = true;
+                for(int d=0; d<num_dims; d++){
+                    // the lowest bit moves along the last (fastest) dimension
+                    point[d] = origin[depth][d] + (((bits >> (num_dims - 1 - d)) & 1u) << shift);
+                    inside = inside && (point[d] < size[d]);
+                }
+                if(!inside){
+                    child[depth] ++;
+                    continue;
+                }
+                if(shift == 0){
+                    child[depth] ++;
+                    return true;
+                }
+                // descend into the sub-cube
+                if(order == HILBERT){
+                    entry[depth + 1] = entry[depth] ^ rotate_left(hilbert_entry(w), direction[depth] + 1);
+                    direction[depth + 1] = (direction[depth] + hilbert_direction(w) + 1) % num_dims;
+                }
+                for(int d=0; d<num_dims; d++) origin[depth + 1][d] = point[d];
+                depth ++;
+                child[depth] = 0;
+            }
+            return false;
+        }
+        // Hilbert curve in d dimensions following Hamilton, "Compact Hilbert indices" (2006)
+        // position bits of the w-th sub-cube under the transform (entry, direction)
+        inline uint32_t hilbert_child(uint32_t w, uint32_t e, uint32_t dir) const {
+            return rotate_left(gray_code(w), dir + 1) ^ e;
+        }
+        inline uint32_t gray_code(uint32_t i) const {
+            return i ^ (i >> 1);
+        }
+        // number of trailing set bits
+        inline uint32_t trailing_set_bits(uint32_t i) const {
+            uint32_t count = 0;
+            while(i & 1){
+                i >>= 1;
+                count ++;
+            }
+            return count;
+        }
+        inline uint32_t hilbert_entry(uint32_t i) const {
+            return (i == 0) ? 0 : gray_code(2 * ((i - 1) / 2));
+        }
+        inline uint32_t hilbert_direction(uint32_t i) const {
+            if(i == 0) return 0;
+            return ((i & 1) ? trailing_set_bits(i) : trailing_set_bits(i - 1)) % num_dims;
+        }
+        inline uint32_t rotate_left(uint32_t x, uint32_t r) const {
+            r %= num_dims;
+            const uint32_t mask = (1u << num_dims) - 1;
+            return ((x << r) | (x >> (num_dims - r))) & mask;
+        }
+        int num_dims = 0;
+        SFCOrder order = MORTON;
+        uint32_t dims_fine[MAX_DIMS] = {0};
+        uint32_t dims_coarse[MAX_DIMS] = {0};
+        size_t strides[MAX_DIMS] = {0};
+        // current subband
+        int subband = 0;
+        uint32_t size[MAX_DIMS] = {0};
+        size_t base_offset = 0;
+        int num_levels = 0;
+        // traversal stack: sub-cube origin, next child and Hilbert transform per depth
+        int depth = -1;
+        uint32_t origin[33][MAX_DIMS] = {{0}};
+        uint32_t child[33] = {0};
+        uint32_t entry[33] = {0};
+        uint32_t direction[33] = {0};
+        uint32_t point[MAX_DIMS] = {0};
+        bool finished = false;
+    };
+}
+#endif
@@ -3,9 +3,14 @@
 
 #include "LevelCompressorInterface.hpp"
 #include "LosslessCompressor.hpp"
+#include "LevelSink.hpp"
+#include "LevelSource.hpp"
 
 namespace MDR {
     #define CR_THRESHOLD 1.05
+    // bitplanes predicted below CR_PREDICTION_THRESHOLD are not compressed, and the others are compressed to measure
+    // their ratios, as ZSTD may do better than the predicted (order-0) ratio
+    #define CR_PREDICTION_THRESHOLD 1.02
     // compress all layers
     class AdaptiveLevelCompressor : public concepts::LevelCompressorInterface {
     public:
@@ -36,7 +41,43 @@ namespace MDR {
             }
             return stopping_index;
         }
+        // bitplanes predicted compressible are compressed while being encoded, and the others are kept raw
+        AdaptiveLevelSink level_sink(uint8_t num_bitplanes) const {
+            return AdaptiveLevelSink(num_bitplanes, CR_PREDICTION_THRESHOLD);
+        }
+        // the stopping index is the first bitplane (but the first) with a measured or predicted ratio below the threshold,
+        // so that incompressible bitplanes are not passed to ZSTD unless they need to be compressed
+        uint8_t compress_level(AdaptiveLevelSink& sink, std::vector<uint8_t*>& streams, std::vector<uint32_t>& stream_sizes) const {
+            std::vector<bool> compressed;
+            std::vector<double> ratios;
+            sink.finish(streams, stream_sizes, compressed, ratios);
+            int stopping_index = stream_sizes.size();
+            for(int i=1; i<streams.size(); i++){
+                if(ratios[i] < CR_THRESHOLD){
+                    stopping_index = i;
+                    break;
+                }
+            }
+            // bitplanes up to the stopping index and from the latter index are compressed, see decompress_level
+            for(int i=0; i<streams.size(); i++){
+                bool compress = (i <= stopping_index) || (i >= latter_index);
+                uint8_t * converted = NULL;
+                if(compress && !compressed[i]){
+                    stream_sizes[i] = ZSTD::compress(streams[i], stream_sizes[i], &converted);
+                }
+                else if(!compress && compressed[i]){
+                    stream_sizes[i] = ZSTD::decompress(streams[i], stream_sizes[i], &converted);
+                }
+                else continue;
+                free(streams[i]);
+                streams[i] = converted;
+            }
+            return stopping_index;
+        }
         void decompress_level(std::vector<const uint8_t*>& streams, const std::vector<uint32_t>& stream_sizes, uint8_t starting_bitplane, uint8_t num_bitplanes, uint8_t stopping_index) {
+            decompress_level(streams, stream_sizes, starting_bitplane, num_bitplanes, stopping_index, buffer);
+        }
+        void decompress_level(std::vector<const uint8_t*>& streams, const std::vector<uint32_t>& stream_sizes, uint8_t starting_bitplane, uint8_t num_bitplanes, uint8_t stopping_index, std::vector<uint8_t*>& buffer) const {
             for(int i=0; i<num_bitplanes; i++){
                 int bitplane_index = starting_bitplane + i;
                 if((bitplane_index <= stopping_index) || (bitplane_index >= latter_index)){
@@ -47,7 +88,19 @@ namespace MDR {
                 }
             }
         }
+        ZSTDLevelSource level_sources(const std::vector<const uint8_t*>& streams, const std::vector<uint32_t>& stream_sizes, uint8_t starting_bitplane, uint8_t num_bitplanes, uint8_t stopping_index) const {
+            ZSTDLevelSource sources(num_bitplanes);
+            for(int i=0; i<num_bitplanes; i++){
+                int bitplane_index = starting_bitplane + i;
+                bool compressed = (bitplane_index <= stopping_index) || (bitplane_index >= latter_index);
+                sources.add(streams[i], stream_sizes[bitplane_index], compressed);
+            }
+            return sources;
+        }
         void decompress_release(){
+            decompress_release(buffer);
+        }
+        void decompress_release(std::vector<uint8_t*>& buffer) const {
             for(int i=0; i<buffer.size(); i++){
                 if(buffer[i]) free(buffer[i]);
             }
@@ -3,6 +3,8 @@
 
 #include "LevelCompressorInterface.hpp"
 #include "LosslessCompressor.hpp"
+#include "LevelSink.hpp"
+#include "LevelSource.hpp"
 #include "RefactorUtils.hpp"
 
 namespace MDR {
@@ -24,7 +26,19 @@ namespace MDR {
             // timer.print("Lossless: ");
             return 0;
         }
+        // bitplanes are compressed while being encoded
+        ZSTDLevelSink level_sink(uint8_t num_bitplanes) const {
+            return ZSTDLevelSink(num_bitplanes);
+        }
+        uint8_t compress_level(ZSTDLevelSink& sink, std::vector<uint8_t*>& streams, std::vector<uint32_t>& stream_sizes) const {
+            std::vector<uint32_t> raw_sizes;
+            sink.finish(streams, stream_sizes, raw_sizes);
+            return 0;
+        }
         void decompress_level(std::vector<const uint8_t*>& streams, const std::vector<uint32_t>& stream_sizes, uint8_t starting_bitplane, uint8_t num_bitplanes, uint8_t stopping_index) {
+            decompress_level(streams, stream_sizes, starting_bitplane, num_bitplanes, stopping_index, buffer);
+        }
+        void decompress_level(std::vector<const uint8_t*>& streams, const std::vector<uint32_t>& stream_sizes, uint8_t starting_bitplane, uint8_t num_bitplanes, uint8_t stopping_index, std::vector<uint8_t*>& buffer) const {
             for(int i=0; i<num_bitplanes; i++){
                 uint8_t * decompressed = NULL;
                 auto decompressed_size = ZSTD::decompress(streams[i], stream_sizes[starting_bitplane + i], &decompressed);
@@ -32,7 +46,17 @@ namespace MDR {
                 streams[i] = decompressed;
             }
         }
+        ZSTDLevelSource level_sources(const std::vector<const uint8_t*>& streams, const std::vector<uint32_t>& stream_sizes, uint8_t starting_bitplane, uint8_t num_bitplanes, uint8_t stopping_index) const {
+            ZSTDLevelSource sources(num_bitplanes);
+            for(int i=0; i<num_bitplanes; i++){
+                sources.add(streams[i], stream_sizes[starting_bitplane + i], true);
+            }
+            return sources;
+        }
         void decompress_release(){
+            decompress_release(buffer);
+        }
+        void decompress_release(std::vector<uint8_t*>& buffer) const {
             for(int i=0; i<buffer.size(); i++){
                 free(buffer[i]);
             }
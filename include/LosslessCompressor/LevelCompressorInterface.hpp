@@ -13,12 +13,25 @@ namespace MDR {
             // compress level, overwrite and free original streams; rewrite streams sizes
             virtual uint8_t compress_level(std::vector<uint8_t*>& streams, std::vector<uint32_t>& stream_sizes) const = 0;
 
+            // level compressors used by ComposedRefactor also provide
+            // level_sink(num_bitplanes) returning a level sink (see LevelSink.hpp) that the encoder writes bitplanes into, and
+            // compress_level(sink, streams, stream_sizes) returning the streams and stopping index as compress_level above
+
             // decompress level, create new buffer and overwrite original streams; will not change stream sizes
             virtual void decompress_level(std::vector<const uint8_t*>& streams, const std::vector<uint32_t>& stream_sizes, uint8_t starting_bitplane, uint8_t num_bitplanes, uint8_t stopping_index) = 0;
 
             // release the buffer created
             virtual void decompress_release() = 0;
 
+            // thread-safe variants keeping the created buffers in the given vector instead of the compressor
+            virtual void decompress_level(std::vector<const uint8_t*>& streams, const std::vector<uint32_t>& stream_sizes, uint8_t starting_bitplane, uint8_t num_bitplanes, uint8_t stopping_index, std::vector<uint8_t*>& buffer) const = 0;
+
+            virtual void decompress_release(std::vector<uint8_t*>& buffer) const = 0;
+
+            // level compressors used by ComposedReconstructor also provide
+            // level_sources(streams, stream_sizes, starting_bitplane, num_bitplanes, stopping_index) returning a
+            // level source (see LevelSource.hpp) that decompresses the given streams while the encoder decodes them
+
             virtual void print() const = 0;
         };
     }
@@ -0,0 +1,169 @@
+#ifndef _MDR_LEVEL_SINK_HPP
+#define _MDR_LEVEL_SINK_HPP
+
+#include "LosslessCompressor.hpp"
+
+namespace MDR {
+    // level sinks receive the bitplanes of a level chunk by chunk from the encoders,
+    // so that the uncompressed bitplanes of a level do not need to exist in memory at once
+    // chunks of a bitplane are written in order, while bitplanes can be interleaved
+
+    // compress each bitplane incrementally in ZSTD frames (see ZSTD::StreamCompressor)
+    class ZSTDLevelSink {
+    public:
+        ZSTDLevelSink(uint8_t num_bitplanes) : compressors(num_bitplanes) {}
+        void write(uint8_t bitplane, uint8_t const * data, uint32_t size){
+            compressors[bitplane].append(data, size);
+        }
+        // compressed streams, and the uncompressed sizes of the bitplanes
+        void finish(std::vector<uint8_t*>& streams, std::vector<uint32_t>& stream_sizes, std::vector<uint32_t>& raw_sizes){
+            streams = std::vector<uint8_t*>(compressors.size(), NULL);
+            stream_sizes = std::vector<uint32_t>(compressors.size(), 0);
+            raw_sizes = std::vector<uint32_t>(compressors.size(), 0);
+            for(int i=0; i<compressors.size(); i++){
+                raw_sizes[i] = compressors[i].get_raw_size();
+                stream_sizes[i] = compressors[i].finish(&streams[i]);
+            }
+        }
+    private:
+        std::vector<ZSTD::StreamCompressor> compressors;
+    };
+
+    // keep the bitplanes uncompressed
+    class RawLevelSink {
+    public:
+        RawLevelSink(uint8_t num_bitplanes) : streams(num_bitplanes, NULL), stream_sizes(num_bitplanes, 0), capacities(num_bitplanes, 0) {}
+        RawLevelSink(RawLevelSink&& other) : streams(std::move(other.streams)), stream_sizes(std::move(other.stream_sizes)), capacities(std::move(other.capacities)) {
+            other.streams.clear();
+        }
+        RawLevelSink(const RawLevelSink&) = delete;
+        void write(uint8_t bitplane, uint8_t const * data, uint32_t size){
+            if(stream_sizes[bitplane] + size > capacities[bitplane]){
+                capacities[bitplane] = std::max(stream_sizes[bitplane] + size, 2 * capacities[bitplane]);
+                streams[bitplane] = (uint8_t *) realloc(streams[bitplane], capacities[bitplane]);
+            }
+            memcpy(streams[bitplane] + stream_sizes[bitplane], data, size);
+            stream_sizes[bitplane] += size;
+        }
+        void finish(std::vector<uint8_t*>& streams, std::vector<uint32_t>& stream_sizes){
+            streams = this->streams;
+            stream_sizes = this->stream_sizes;
+            this->streams.clear();
+        }
+        uint8_t const * data(uint8_t bitplane) const {
+            return streams[bitplane];
+        }
+        uint32_t size(uint8_t bitplane) const {
+            return stream_sizes[bitplane];
+        }
+        // drop the data written to a bitplane
+        void clear(uint8_t bitplane){
+            free(streams[bitplane]);
+            streams[bitplane] = NULL;
+            stream_sizes[bitplane] = 0;
+            capacities[bitplane] = 0;
+        }
+        ~RawLevelSink(){
+            for(int i=0; i<streams.size(); i++){
+                free(streams[i]);
+            }
+        }
+    private:
+        std::vector<uint8_t*> streams;
+        std::vector<uint32_t> stream_sizes;
+        std::vector<uint32_t> capacities;
+    };
+
+    #define HISTOGRAM_CHUNK_SIZE 1024 // bytes counted in a row by ByteHistogram
+    #define HISTOGRAM_CHUNK_STRIDE 4 // ByteHistogram counts one chunk out of HISTOGRAM_CHUNK_STRIDE
+    // sampled byte histogram of a stream, predicting its compression ratio by the order-0 entropy
+    class ByteHistogram {
+    public:
+        ByteHistogram() : counts(256, 0) {}
+        void add(uint8_t const * data, uint32_t size){
+            uint64_t end = position + size;
+            while(position < end){
+                uint64_t chunk_id = position / HISTOGRAM_CHUNK_SIZE;
+                uint64_t chunk_end = std::min(end, (chunk_id + 1) * HISTOGRAM_CHUNK_SIZE);
+                if(chunk_id % HISTOGRAM_CHUNK_STRIDE == 0){
+                    uint8_t const * chunk = data + (size - (end - position));
+                    for(uint64_t i=0; i<chunk_end - position; i++){
+                        counts[chunk[i]] ++;
+                    }
+                    num_counted += chunk_end - position;
+                }
+                position = chunk_end;
+            }
+        }
+        uint64_t size() const {
+            return position;
+        }
+        // 8 bits over the entropy in bits per byte
+        double predict_ratio() const {
+            if(num_counted == 0) return 1;
+            double entropy = 0;
+            for(const auto& count:counts){
+                if(count) entropy -= count * log2((double) count / num_counted);
+            }
+            entropy /= num_counted;
+            return (entropy > 1e-3) ? 8 / entropy : 8e3;
+        }
+    private:
+        std::vector<uint64_t> counts;
+        uint64_t position = 0;
+        uint64_t num_counted = 0;
+    };
+
+    #define CR_SAMPLE_SIZE (1u << 16) // bytes of a bitplane written before predicting its compression ratio
+    // compress the bitplanes whose predicted compression ratio reaches the threshold, and keep the others raw
+    // bitplanes are kept raw until CR_SAMPLE_SIZE bytes are written, and then compressed incrementally if predicted compressible
+    class AdaptiveLevelSink {
+    public:
+        AdaptiveLevelSink(uint8_t num_bitplanes, double threshold) : compressors(num_bitplanes), raw(num_bitplanes), histograms(num_bitplanes), states(num_bitplanes, UNDECIDED), threshold(threshold) {}
+        void write(uint8_t bitplane, uint8_t const * data, uint32_t size){
+            histograms[bitplane].add(data, size);
+            if(states[bitplane] == COMPRESSED){
+                compressors[bitplane].append(data, size);
+                return;
+            }
+            raw.write(bitplane, data, size);
+            if((states[bitplane] == UNDECIDED) && (raw.size(bitplane) >= CR_SAMPLE_SIZE)){
+                if(histograms[bitplane].predict_ratio() >= threshold){
+                    states[bitplane] = COMPRESSED;
+                    compressors[bitplane].append(raw.data(bitplane), raw.size(bitplane));
+                    raw.clear(bitplane);
+                }
+                else states[bitplane] = RAW;
+            }
+        }
+        // streams, whether they are compressed, and the compression ratios: measured for the compressed bitplanes,
+        // predicted for the raw ones
+        void finish(std::vector<uint8_t*>& streams, std::vector<uint32_t>& stream_sizes, std::vector<bool>& compressed, std::vector<double>& ratios){
+            raw.finish(streams, stream_sizes);
+            compressed = std::vector<bool>(streams.size(), false);
+            ratios = std::vector<double>(streams.size(), 1);
+            for(int i=0; i<streams.size(); i++){
+                ratios[i] = histograms[i].predict_ratio();
+                // bitplanes shorter than the sample are decided now
+                if((states[i] == UNDECIDED) && (ratios[i] >= threshold)){
+                    compressors[i].append(streams[i], stream_sizes[i]);
+                    free(streams[i]);
+                    states[i] = COMPRESSED;
+                }
+                if(states[i] == COMPRESSED){
+                    stream_sizes[i] = compressors[i].finish(&streams[i]);
+                    compressed[i] = true;
+                    ratios[i] = histograms[i].size() * 1.0 / stream_sizes[i];
+                }
+            }
+        }
+    private:
+        enum State {UNDECIDED, COMPRESSED, RAW};
+        std::vector<ZSTD::StreamCompressor> compressors;
+        RawLevelSink raw;
+        std::vector<ByteHistogram> histograms;
+        std::vector<State> states;
+        double threshold;
+    };
+}
+#endif
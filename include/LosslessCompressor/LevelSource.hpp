@@ -0,0 +1,104 @@
+#ifndef _MDR_LEVEL_SOURCE_HPP
+#define _MDR_LEVEL_SOURCE_HPP
+
+#include "LosslessCompressor.hpp"
+
+namespace MDR {
+    // level sources hand the retrieved bitplanes of a level to the decoders chunk by chunk,
+    // so that the decompressed bitplanes of a level do not need to exist in memory at once
+    // the bitplane sources follow RawBitplaneSource (see BitplaneEncoder/BitplaneSource.hpp)
+
+    // bitplane compressed as by ZSTD::compress or ZSTD::StreamCompressor, or kept raw
+    // compressed bitplanes are decompressed one ZSTD frame at a time into a window, so that
+    // about a frame (ZSTD_FRAME_SIZE bytes) is kept per bitplane
+    // data compressed before bitplanes were split into frames hold a single frame per bitplane,
+    // which is then decompressed into the window at once
+    class ZSTDBitplaneSource {
+    public:
+        ZSTDBitplaneSource(uint8_t const * stream, uint32_t size, bool compressed, ZSTD_DCtx * dctx) : stream(stream) {
+            if(compressed){
+                this->dctx = dctx;
+                input = stream + sizeof(size_t);
+                input_end = stream + size;
+            }
+        }
+        ZSTDBitplaneSource(ZSTDBitplaneSource&& other) : stream(other.stream), dctx(other.dctx), input(other.input), input_end(other.input_end), window(other.window), window_size(other.window_size), capacity(other.capacity) {
+            other.window = NULL;
+        }
+        ZSTDBitplaneSource(const ZSTDBitplaneSource&) = delete;
+        ZSTDBitplaneSource& operator=(const ZSTDBitplaneSource&) = delete;
+        ~ZSTDBitplaneSource(){
+            free(window);
+        }
+        uint8_t const * begin(){
+            if(!dctx) return stream;
+            if(!window) fill(0);
+            return window;
+        }
+        inline uint8_t const * ensure(uint8_t const * pos, uint32_t size){
+            if(!dctx || (input == input_end) || (pos + size <= window + window_size)) return pos;
+            // keep the unread bytes and decompress the next frames after them
+            uint32_t left = window + window_size - pos;
+            memmove(window, pos, left);
+            window_size = left;
+            fill(size);
+            return window;
+        }
+    private:
+        // decompress at least a frame, and until size bytes are in the window
+        void fill(uint32_t size){
+            do{
+                size_t frame_size = ZSTD_findFrameCompressedSize(input, input_end - input);
+                unsigned long long raw_size = ZSTD_getFrameContentSize(input, input_end - input);
+                if(ZSTD_isError(frame_size) || (raw_size == ZSTD_CONTENTSIZE_UNKNOWN) || (raw_size == ZSTD_CONTENTSIZE_ERROR)){
+                    std::cerr << "Invalid ZSTD frame in bitplane." << std::endl;
+                    exit(-1);
+                }
+                if(window_size + raw_size > capacity){
+                    capacity = window_size + raw_size;
+                    window = (uint8_t *) realloc(window, capacity);
+                }
+                ZSTD_decompressDCtx(dctx, window + window_size, raw_size, input, frame_size);
+                window_size += raw_size;
+                input += frame_size;
+            }while((window_size < size) && (input < input_end));
+        }
+        uint8_t const * stream = NULL;
+        ZSTD_DCtx * dctx = NULL;
+        uint8_t const * input = NULL;
+        uint8_t const * input_end = NULL;
+        uint8_t * window = NULL;
+        uint32_t window_size = 0;
+        uint32_t capacity = 0;
+    };
+
+    // sources of the retrieved bitplanes of a level, sharing a ZSTD context
+    class ZSTDLevelSource {
+    public:
+        ZSTDLevelSource(uint8_t num_bitplanes){
+            sources.reserve(num_bitplanes);
+        }
+        ZSTDLevelSource(ZSTDLevelSource&& other) : dctx(other.dctx), sources(std::move(other.sources)) {
+            other.dctx = NULL;
+        }
+        ZSTDLevelSource(const ZSTDLevelSource&) = delete;
+        ZSTDLevelSource& operator=(const ZSTDLevelSource&) = delete;
+        ~ZSTDLevelSource(){
+            if(dctx) ZSTD_freeDCtx(dctx);
+        }
+        void add(uint8_t const * stream, uint32_t size, bool compressed){
+            if(compressed && !dctx) dctx = ZSTD_createDCtx();
+            sources.emplace_back(stream, size, compressed, dctx);
+        }
+        ZSTDBitplaneSource& operator[](size_t i){
+            return sources[i];
+        }
+        size_t size() const {
+            return sources.size();
+        }
+    private:
+        ZSTD_DCtx * dctx = NULL;
+        std::vector<ZSTDBitplaneSource> sources;
+    };
+}
+#endif
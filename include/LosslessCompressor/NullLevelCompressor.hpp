@@ -2,6 +2,8 @@
 #define _MDR_NULL_LEVEL_COMPRESSOR_HPP
 
 #include "LevelCompressorInterface.hpp"
+#include "LevelSink.hpp"
+#include "LevelSource.hpp"
 
 namespace MDR {
     // Null lossless compressor
@@ -9,8 +11,22 @@ namespace MDR {
     public:
         NullLevelCompressor(){}
         uint8_t compress_level(std::vector<uint8_t*>& streams, std::vector<uint32_t>& stream_sizes) const { return 0;}
+        RawLevelSink level_sink(uint8_t num_bitplanes) const { return RawLevelSink(num_bitplanes); }
+        uint8_t compress_level(RawLevelSink& sink, std::vector<uint8_t*>& streams, std::vector<uint32_t>& stream_sizes) const {
+            sink.finish(streams, stream_sizes);
+            return 0;
+        }
         void decompress_level(std::vector<const uint8_t*>& streams, const std::vector<uint32_t>& stream_sizes, uint8_t starting_bitplane, uint8_t num_bitplanes, uint8_t stopping_index){}
+        void decompress_level(std::vector<const uint8_t*>& streams, const std::vector<uint32_t>& stream_sizes, uint8_t starting_bitplane, uint8_t num_bitplanes, uint8_t stopping_index, std::vector<uint8_t*>& buffer) const {}
+        ZSTDLevelSource level_sources(const std::vector<const uint8_t*>& streams, const std::vector<uint32_t>& stream_sizes, uint8_t starting_bitplane, uint8_t num_bitplanes, uint8_t stopping_index) const {
+            ZSTDLevelSource sources(num_bitplanes);
+            for(int i=0; i<num_bitplanes; i++){
+                sources.add(streams[i], stream_sizes[starting_bitplane + i], false);
+            }
+            return sources;
+        }
         void decompress_release(){}
+        void decompress_release(std::vector<uint8_t*>& buffer) const {}
         void print() const {
             std::cout << "Null level compressor" << std::endl;
         }
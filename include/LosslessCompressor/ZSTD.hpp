@@ -6,18 +6,25 @@
 namespace MDR {
     namespace ZSTD{
         #define ZSTD_LEVEL 3 //default setting of level is 3
+        #define ZSTD_FRAME_SIZE (1u << 16) // data compressed in each frame
         // ZSTD lossless compressor
+        // data are compressed in independent frames of ZSTD_FRAME_SIZE bytes, which ZSTD_decompress reads back as one stream,
+        // so that a bitplane can be decompressed frame by frame into a small window (see ZSTDBitplaneSource)
         uint32_t compress(const uint8_t* data, uint32_t dataLength, uint8_t** compressBytes) {
-            uint32_t outSize = 0; 
-            size_t estimatedCompressedSize = 0;
-            if(dataLength < 1024) 
-                estimatedCompressedSize = 2048;
-            else
-                estimatedCompressedSize = (dataLength*1.2)/8 * 8;
+            size_t estimatedCompressedSize = sizeof(size_t);
+            uint32_t num_frames = (dataLength + ZSTD_FRAME_SIZE - 1) / ZSTD_FRAME_SIZE;
+            if(num_frames == 0) num_frames = 1;
+            for(uint32_t i=0; i<num_frames; i++){
+                estimatedCompressedSize += ZSTD_compressBound(std::min(ZSTD_FRAME_SIZE, dataLength - i * ZSTD_FRAME_SIZE));
+            }
             *compressBytes = (uint8_t*)malloc(estimatedCompressedSize);
             *reinterpret_cast<size_t*>(*compressBytes) = dataLength;
-            outSize = ZSTD_compress(*compressBytes + sizeof(size_t), estimatedCompressedSize, data, dataLength, ZSTD_LEVEL); 
-            return outSize + sizeof(size_t);
+            size_t outSize = sizeof(size_t);
+            for(uint32_t i=0; i<num_frames; i++){
+                uint32_t frame_size = std::min(ZSTD_FRAME_SIZE, dataLength - i * ZSTD_FRAME_SIZE);
+                outSize += ZSTD_compress(*compressBytes + outSize, estimatedCompressedSize - outSize, data + i * ZSTD_FRAME_SIZE, frame_size, ZSTD_LEVEL);
+            }
+            return outSize;
         }
         uint32_t decompress(const uint8_t* compressBytes, uint32_t cmpSize, uint8_t** oriData) {
             uint32_t outSize = 0;
@@ -26,6 +33,76 @@ namespace MDR {
             ZSTD_decompress(*oriData, outSize, compressBytes + sizeof(size_t), cmpSize - sizeof(size_t));
             return outSize;
         }
+
+        // incremental ZSTD compressor producing the same layout as compress()
+        // appended data are buffered and compressed as an independent frame every ZSTD_FRAME_SIZE bytes;
+        // streams within a frame are compressed as by compress()
+        class StreamCompressor {
+        public:
+            StreamCompressor(){}
+            StreamCompressor(const StreamCompressor&) = delete;
+            StreamCompressor& operator=(const StreamCompressor&) = delete;
+            ~StreamCompressor(){
+                free(buffer);
+                for(auto frame:frames) free(frame);
+            }
+            void append(const uint8_t * data, uint32_t size){
+                if(!buffer) buffer = (uint8_t *) malloc(ZSTD_FRAME_SIZE);
+                raw_size += size;
+                while(size){
+                    uint32_t copy_size = std::min(size, ZSTD_FRAME_SIZE - buffered_size);
+                    memcpy(buffer + buffered_size, data, copy_size);
+                    buffered_size += copy_size;
+                    data += copy_size;
+                    size -= copy_size;
+                    // keep the last frame buffered so that a single frame stream is compressed as by compress()
+                    if((buffered_size == ZSTD_FRAME_SIZE) && size) compress_frame();
+                }
+            }
+            // end the stream and hand over the compressed bytes; return the compressed size
+            uint32_t finish(uint8_t** compressBytes){
+                uint32_t outSize = 0;
+                if(frames.empty()){
+                    outSize = compress(buffer, buffered_size, compressBytes);
+                }
+                else{
+                    if(buffered_size) compress_frame();
+                    outSize = sizeof(size_t);
+                    for(const auto& size:frame_sizes) outSize += size;
+                    *compressBytes = (uint8_t *) malloc(outSize);
+                    *reinterpret_cast<size_t*>(*compressBytes) = raw_size;
+                    uint8_t * pos = *compressBytes + sizeof(size_t);
+                    for(int i=0; i<frames.size(); i++){
+                        memcpy(pos, frames[i], frame_sizes[i]);
+                        pos += frame_sizes[i];
+                        free(frames[i]);
+                    }
+                    frames.clear();
+                    frame_sizes.clear();
+                }
+                free(buffer);
+                buffer = NULL;
+                buffered_size = 0;
+                return outSize;
+            }
+            uint32_t get_raw_size() const {
+                return raw_size;
+            }
+        private:
+            void compress_frame(){
+                size_t bound = ZSTD_compressBound(buffered_size);
+                uint8_t * frame = (uint8_t *) malloc(bound);
+                size_t frame_size = ZSTD_compress(frame, bound, buffer, buffered_size, ZSTD_LEVEL);
+                frames.push_back((uint8_t *) realloc(frame, frame_size));
+                frame_sizes.push_back(frame_size);
+                buffered_size = 0;
+            }
+            uint8_t * buffer = NULL;
+            uint32_t buffered_size = 0;
+            uint32_t raw_size = 0;
+            std::vector<uint8_t *> frames;
+            std::vector<uint32_t> frame_sizes;
+        };
     }
 }
 #endif
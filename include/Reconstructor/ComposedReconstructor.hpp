@@ -25,78 +25,26 @@ namespace MDR {
         }
         // reconstruct data from encoded streams
         T * reconstruct(double tolerance, int max_level=-1){
-            // Timer timer;
-            // timer.start();
-            std::vector<std::vector<double>> level_abs_errors;
-            uint8_t target_level = level_error_bounds.size() - 1;
-            std::vector<std::vector<double>>& level_errors = level_squared_errors;
-            if(std::is_base_of<MaxErrorEstimator<T>, ErrorEstimator>::value){
-                std::cout << "ErrorEstimator is base of MaxErrorEstimator, computing absolute error" << std::endl;
-                MaxErrorCollector<T> collector = MaxErrorCollector<T>();
-                for(int i=0; i<=target_level; i++){
-                    auto collected_error = collector.collect_level_error(NULL, 0, level_squared_errors[i].size(), level_error_bounds[i]);
-                    level_abs_errors.push_back(collected_error);
-                }
-                level_errors = level_abs_errors;
-            }
-            else if(std::is_base_of<SquaredErrorEstimator<T>, ErrorEstimator>::value){
-                std::cout << "ErrorEstimator is base of SquaredErrorEstimator, using level squared error directly" << std::endl;
-            }
-            else{
-                std::cerr << "Customized error estimator not supported yet" << std::endl;
-                exit(-1);
-            }
-            // timer.end();
-            // timer.print("Preprocessing");            
+            return interpret_and_reconstruct([&](const std::vector<std::vector<uint32_t>>& sizes, const std::vector<std::vector<double>>& errors, std::vector<uint8_t>& index){
+                return interpreter.interpret_retrieve_size(sizes, errors, tolerance, index);
+            }, max_level);
+        }
 
-            // timer.start();
-            auto prev_level_num_bitplanes(level_num_bitplanes);
-            if(max_level == -1 || (max_level >= level_num_bitplanes.size())){
-                auto retrieve_sizes = interpreter.interpret_retrieve_size(level_sizes, level_errors, tolerance, level_num_bitplanes);
-                // retrieve data
-                level_components = retriever.retrieve_level_components(level_sizes, retrieve_sizes, prev_level_num_bitplanes, level_num_bitplanes);                
-            }
-            else{
-                std::vector<std::vector<uint32_t>> tmp_level_sizes;
-                std::vector<std::vector<double>> tmp_level_errors;
-                std::vector<uint8_t> tmp_level_num_bitplanes;
-                for(int i=0; i<=max_level; i++){
-                    tmp_level_sizes.push_back(level_sizes[i]);
-                    tmp_level_errors.push_back(level_errors[i]);
-                    tmp_level_num_bitplanes.push_back(level_num_bitplanes[i]);
-                }
-                auto retrieve_sizes = interpreter.interpret_retrieve_size(tmp_level_sizes, tmp_level_errors, tolerance, tmp_level_num_bitplanes);
-                level_components = retriever.retrieve_level_components(tmp_level_sizes, retrieve_sizes, prev_level_num_bitplanes, tmp_level_num_bitplanes);                
-                // add level_num_bitplanes
-                for(int i=0; i<=max_level; i++){
-                    level_num_bitplanes[i] = tmp_level_num_bitplanes[i];
-                }
-            }
-            // check whether to reconstruct to full resolution
-            int skipped_level = 0;
-            for(int i=0; i<=target_level; i++){
-                if(level_num_bitplanes[target_level - i] != 0){
-                    skipped_level = i;
-                    break;
-                }
-            }
-            // TODO: uncomment skip level to reconstruct low resolution data
-            // target_level -= skipped_level;
-            // timer.end();
-            // timer.print("Interpret and retrieval");
-            int reconstruct_level = target_level - skipped_level;
-            // std::cout << "skipped_level = " << skipped_level << ", target_level = " << +target_level << std::endl;
+        // reconstruct data with the minimal estimated error within a byte budget
+        // the budget counts the bytes retrieved by this call, and the estimated error is available via get_estimated_error()
+        T * reconstruct_with_budget(uint64_t budget, int max_level=-1){
+            return interpret_and_reconstruct([&](const std::vector<std::vector<uint32_t>>& sizes, const std::vector<std::vector<double>>& errors, std::vector<uint8_t>& index){
+                return interpreter.interpret_retrieve_size_with_budget(sizes, errors, budget, index, estimated_error);
+            }, max_level);
+        }
 
-            bool success = reconstruct(reconstruct_level, prev_level_num_bitplanes);
-            retriever.release();
-            if(success){
-                current_level = reconstruct_level;
-                return data.data();
-            }
-            else{
-                std::cerr << "Reconstruct unsuccessful, return NULL pointer" << std::endl;
-                return NULL;
-            }
+        // reconstruct data within a wall-clock budget (in seconds)
+        // the budget is translated into bytes using the throughput and recomposition time measured in previous reconstructions
+        T * reconstruct_with_time_budget(double time_budget, int max_level=-1){
+            double available_time = time_budget - recompose_time;
+            uint64_t budget = (available_time > 0) ? available_time * throughput : 0;
+            std::cout << "Time budget = " << time_budget << "s, throughput = " << throughput << " B/s, byte budget = " << budget << std::endl;
+            return reconstruct_with_budget(budget, max_level);
         }
 
         T * progressive_reconstruct(double tolerance){
@@ -133,6 +81,14 @@ namespace MDR {
         void load_metadata(){
             uint8_t * metadata = retriever.load_metadata();
             uint8_t const * metadata_pos = metadata;
+            uint8_t version = 0;
+            if(*metadata_pos & METADATA_VERSION_FLAG){
+                version = *(metadata_pos ++) & ~METADATA_VERSION_FLAG;
+                if(version > METADATA_VERSION){
+                    std::cerr << "Metadata version " << +version << " is not supported." << std::endl;
+                    exit(-1);
+                }
+            }
             uint8_t num_dims = *(metadata_pos ++);
             deserialize(metadata_pos, num_dims, dimensions);
             uint8_t num_levels = *(metadata_pos ++);
@@ -141,6 +97,18 @@ namespace MDR {
             deserialize(metadata_pos, num_levels, level_sizes);
             deserialize(metadata_pos, num_levels, stopping_indices);
             deserialize(metadata_pos, num_levels, level_num);
+            retrieval_plans.clear();
+            level_measured_errors.clear();
+            if(version >= 1){
+                uint8_t num_plans = *(metadata_pos ++);
+                retrieval_plans = std::vector<RetrievalPlan>(num_plans);
+                for(int i=0; i<num_plans; i++){
+                    deserialize(metadata_pos, retrieval_plans[i]);
+                }
+                uint8_t num_measured_levels = *(metadata_pos ++);
+                deserialize(metadata_pos, num_measured_levels, level_measured_errors);
+            }
+            interpreter.load_retrieval_plans(retrieval_plans);
             level_num_bitplanes = std::vector<uint8_t>(num_levels, 0);
             strides = std::vector<uint32_t>(dimensions.size());
             uint32_t stride = 1;
@@ -164,6 +132,38 @@ namespace MDR {
             return current_level;
         }
 
+        // estimated error achieved by the last budget-based reconstruction
+        double get_estimated_error() const {
+            return estimated_error;
+        }
+
+        // total number of bytes retrieved so far
+        uint64_t get_retrieved_size() const {
+            uint64_t retrieved_size = 0;
+            for(int i=0; i<level_num_bitplanes.size(); i++){
+                for(int j=0; j<level_num_bitplanes[i]; j++){
+                    retrieved_size += level_sizes[i][j];
+                }
+            }
+            return retrieved_size;
+        }
+
+        // retrieval throughput (bytes per second) used to translate time budgets
+        double get_throughput() const {
+            return throughput;
+        }
+
+        // initial throughput assumed before the first reconstruction is measured
+        void set_throughput(double t){
+            throughput = t;
+        }
+
+        // decode the levels concurrently (with OpenMP) before recomposing
+        // each thread keeps the decompression windows of its level, which takes more memory
+        void set_parallel_levels(bool parallel){
+            parallel_levels = parallel;
+        }
+
         ~ComposedReconstructor(){}
 
         void print() const {
@@ -175,10 +175,119 @@ namespace MDR {
             std::cout << "Retriever: "; retriever.print();
         }
     private:
+        // interpret retrieval sizes with the given policy, then retrieve and reconstruct
+        template<class Interpret>
+        T * interpret_and_reconstruct(Interpret interpret, int max_level){
+            std::vector<std::vector<double>> level_abs_errors;
+            uint8_t target_level = level_error_bounds.size() - 1;
+            std::vector<std::vector<double>> level_errors = level_squared_errors;
+            if(std::is_base_of<MeasuredMaxErrorEstimator<T>, ErrorEstimator>::value){
+                std::cout << "ErrorEstimator is MeasuredMaxErrorEstimator, using measured max error" << std::endl;
+                if(level_measured_errors.empty()){
+                    std::cerr << "Measured errors are not stored in metadata." << std::endl;
+                    exit(-1);
+                }
+                level_errors = level_measured_errors;
+            }
+            else if(std::is_base_of<MaxErrorEstimator<T>, ErrorEstimator>::value){
+                std::cout << "ErrorEstimator is base of MaxErrorEstimator, computing absolute error" << std::endl;
+                MaxErrorCollector<T> collector = MaxErrorCollector<T>();
+                for(int i=0; i<=target_level; i++){
+                    auto collected_error = collector.collect_level_error(NULL, 0, level_squared_errors[i].size(), level_error_bounds[i]);
+                    level_abs_errors.push_back(collected_error);
+                }
+                level_errors = level_abs_errors;
+            }
+            else if(std::is_base_of<SquaredErrorEstimator<T>, ErrorEstimator>::value){
+                std::cout << "ErrorEstimator is base of SquaredErrorEstimator, using level squared error directly" << std::endl;
+            }
+            else{
+                std::cerr << "Customized error estimator not supported yet" << std::endl;
+                exit(-1);
+            }
+            // timer.end();
+            // timer.print("Preprocessing");            
+
+            // timer.start();
+            Timer timer;
+            timer.start();
+            auto prev_level_num_bitplanes(level_num_bitplanes);
+            if(max_level == -1 || (max_level >= level_num_bitplanes.size())){
+                auto retrieve_sizes = interpret(level_sizes, level_errors, level_num_bitplanes);
+                // retrieve data
+                level_components = retriever.retrieve_level_components(level_sizes, retrieve_sizes, prev_level_num_bitplanes, level_num_bitplanes);                
+            }
+            else{
+                std::vector<std::vector<uint32_t>> tmp_level_sizes;
+                std::vector<std::vector<double>> tmp_level_errors;
+                std::vector<uint8_t> tmp_level_num_bitplanes;
+                for(int i=0; i<=max_level; i++){
+                    tmp_level_sizes.push_back(level_sizes[i]);
+                    tmp_level_errors.push_back(level_errors[i]);
+                    tmp_level_num_bitplanes.push_back(level_num_bitplanes[i]);
+                }
+                auto retrieve_sizes = interpret(tmp_level_sizes, tmp_level_errors, tmp_level_num_bitplanes);
+                level_components = retriever.retrieve_level_components(tmp_level_sizes, retrieve_sizes, prev_level_num_bitplanes, tmp_level_num_bitplanes);                
+                // add level_num_bitplanes
+                for(int i=0; i<=max_level; i++){
+                    level_num_bitplanes[i] = tmp_level_num_bitplanes[i];
+                }
+            }
+            timer.end();
+            double retrieval_time = timer.get();
+            uint64_t retrieved_size = 0;
+            for(int i=0; i<prev_level_num_bitplanes.size(); i++){
+                for(int j=prev_level_num_bitplanes[i]; j<level_num_bitplanes[i]; j++){
+                    retrieved_size += level_sizes[i][j];
+                }
+            }
+            // check whether to reconstruct to full resolution
+            int skipped_level = 0;
+            for(int i=0; i<=target_level; i++){
+                if(level_num_bitplanes[target_level - i] != 0){
+                    skipped_level = i;
+                    break;
+                }
+            }
+            // TODO: uncomment skip level to reconstruct low resolution data
+            // target_level -= skipped_level;
+            // timer.end();
+            // timer.print("Interpret and retrieval");
+            int reconstruct_level = target_level - skipped_level;
+            // std::cout << "skipped_level = " << skipped_level << ", target_level = " << +target_level << std::endl;
+
+            timer.start();
+            bool success = reconstruct(reconstruct_level, prev_level_num_bitplanes);
+            retriever.release();
+            timer.end();
+            double decode_time = timer.get() - last_recompose_time;
+            update_throughput(retrieved_size, retrieval_time + decode_time, last_recompose_time);
+            if(success){
+                current_level = reconstruct_level;
+                return data.data();
+            }
+            else{
+                std::cerr << "Reconstruct unsuccessful, return NULL pointer" << std::endl;
+                return NULL;
+            }
+        }
+
+        // exponential moving average of the retrieval and decoding throughput (bytes per second)
+        // recomposition does not scale with the retrieved size and is tracked separately
+        void update_throughput(uint64_t retrieved_size, double io_time, double measured_recompose_time){
+            recompose_time = throughput_measured ? 0.5 * recompose_time + 0.5 * measured_recompose_time : measured_recompose_time;
+            if((retrieved_size > 0) && (io_time > 0)){
+                double measured_throughput = retrieved_size / io_time;
+                throughput = throughput_measured ? 0.5 * throughput + 0.5 * measured_throughput : measured_throughput;
+            }
+            throughput_measured = true;
+        }
         bool reconstruct(uint8_t target_level, const std::vector<uint8_t>& prev_level_num_bitplanes, bool progressive=true){
             auto num_levels = level_num.size();
             auto level_dims = compute_level_dims(dimensions, num_levels - 1);
             auto reconstruct_dimensions = level_dims[target_level];
+            Timer timer;
+            last_recompose_time = 0;
             std::cout << "target_level = " << +target_level << ", dims = " << reconstruct_dimensions[0] << " " << reconstruct_dimensions[1] << " " << reconstruct_dimensions[2] << std::endl;
             // update with stride
             std::vector<T> cur_data(data);
@@ -186,22 +295,17 @@ namespace MDR {
 
             // std::cout << "current_level = " << current_level << std::endl;
             auto level_elements = compute_level_elements(level_dims, target_level);
-            std::vector<uint32_t> dims_dummy(reconstruct_dimensions.size(), 0);
+            std::vector<int> levels;
             for(int i=0; i<=current_level; i++){
-                if(level_num_bitplanes[i] - prev_level_num_bitplanes[i] > 0){
-                    compressor.decompress_level(level_components[i], level_sizes[i], prev_level_num_bitplanes[i], level_num_bitplanes[i] - prev_level_num_bitplanes[i], stopping_indices[i]);
-                    int level_exp = 0;
-                    frexp(level_error_bounds[i], &level_exp);
-                    auto level_decoded_data = encoder.progressive_decode(level_components[i], level_elements[i], level_exp, prev_level_num_bitplanes[i], level_num_bitplanes[i] - prev_level_num_bitplanes[i], i);
-                    compressor.decompress_release();
-                    const std::vector<uint32_t>& prev_dims = (i == 0) ? dims_dummy : level_dims[i - 1];
-                    interleaver.reposition(level_decoded_data, reconstruct_dimensions, level_dims[i], prev_dims, data.data(), this->strides);
-                    free(level_decoded_data);                    
-                }
+                if(level_num_bitplanes[i] - prev_level_num_bitplanes[i] > 0) levels.push_back(i);
             }
+            decode_levels(levels, prev_level_num_bitplanes, level_dims, level_elements, reconstruct_dimensions);
             // decompose data to current level
             if(current_level >= 0){
+                timer.start();
                 if(current_level) decomposer.recompose(data.data(), current_dimensions, current_level, this->strides);
+                timer.end();
+                last_recompose_time += timer.get();
                 std::cout << "update data\n";
                 // update data with strides
                 if(dimensions.size() == 1){
@@ -228,27 +332,57 @@ namespace MDR {
             }
             std::cout << "decompose to target_level\n";
             // decompose data to target level
+            levels.clear();
             for(int i=current_level+1; i<=target_level; i++){
-                compressor.decompress_level(level_components[i], level_sizes[i], prev_level_num_bitplanes[i], level_num_bitplanes[i] - prev_level_num_bitplanes[i], stopping_indices[i]);
-                int level_exp = 0;
-                frexp(level_error_bounds[i], &level_exp);
-                auto level_decoded_data = encoder.progressive_decode(level_components[i], level_elements[i], level_exp, prev_level_num_bitplanes[i], level_num_bitplanes[i] - prev_level_num_bitplanes[i], i);
-                compressor.decompress_release();
-                const std::vector<uint32_t>& prev_dims = (i == 0) ? dims_dummy : level_dims[i - 1];
-                interleaver.reposition(level_decoded_data, reconstruct_dimensions, level_dims[i], prev_dims, data.data(), this->strides);
-                free(level_decoded_data);                    
+                levels.push_back(i);
             }
+            decode_levels(levels, prev_level_num_bitplanes, level_dims, level_elements, reconstruct_dimensions);
+            timer.start();
             if(current_level >= 0){
                 decomposer.recompose(data.data(), reconstruct_dimensions, target_level - current_level, this->strides);                
             }
             else{
                 decomposer.recompose(data.data(), reconstruct_dimensions, target_level, this->strides);
             }
+            timer.end();
+            last_recompose_time += timer.get();
             current_dimensions = reconstruct_dimensions;
             return true;
 
         }
 
+        // decompress and decode the new bitplanes of the given levels into their final locations in data
+        // levels write disjoint coefficients, so they are decoded concurrently in the parallel mode
+        void decode_levels(const std::vector<int>& levels, const std::vector<uint8_t>& prev_level_num_bitplanes, const std::vector<std::vector<uint32_t>>& level_dims, const std::vector<uint32_t>& level_elements, const std::vector<uint32_t>& reconstruct_dimensions){
+            if(parallel_levels){
+                encoder.init_levels(level_dims.size());
+                #pragma omp parallel for schedule(dynamic)
+                for(int j=0; j<levels.size(); j++){
+                    decode_level(levels[j], prev_level_num_bitplanes, level_dims, level_elements, reconstruct_dimensions);
+                }
+            }
+            else{
+                for(int j=0; j<levels.size(); j++){
+                    decode_level(levels[j], prev_level_num_bitplanes, level_dims, level_elements, reconstruct_dimensions);
+                }
+            }
+        }
+
+        // only touches the state of level i, given that the encoder levels are initialized
+        void decode_level(int i, const std::vector<uint8_t>& prev_level_num_bitplanes, const std::vector<std::vector<uint32_t>>& level_dims, const std::vector<uint32_t>& level_elements, const std::vector<uint32_t>& reconstruct_dimensions){
+            // the bitplanes are decompressed a frame at a time while being decoded
+            auto sources = compressor.level_sources(level_components[i], level_sizes[i], prev_level_num_bitplanes[i], level_num_bitplanes[i] - prev_level_num_bitplanes[i], stopping_indices[i]);
+            int level_exp = 0;
+            frexp(level_error_bounds[i], &level_exp);
+            std::vector<uint32_t> dims_dummy(reconstruct_dimensions.size(), 0);
+            const std::vector<uint32_t>& prev_dims = (i == 0) ? dims_dummy : level_dims[i - 1];
+            // decode into the final locations
+            auto writer = interleaver.level_writer(data.data(), reconstruct_dimensions, level_dims[i], prev_dims, this->strides);
+            encoder.stream_progressive_decode_from_sources(sources, level_elements[i], level_exp, prev_level_num_bitplanes[i], level_num_bitplanes[i] - prev_level_num_bitplanes[i], i, writer);
+            // no more bitplanes to decode for the level
+            if(level_num_bitplanes[i] == level_sizes[i].size()) encoder.release_level(i);
+        }
+
         void clear_data(T * dst, const std::vector<uint32_t>& coarse_dims, const std::vector<uint32_t>& fine_dims, const std::vector<uint32_t>& dims){
             for(int i=0; i<fine_dims[0]; i++){
                 for(int j=0; j<fine_dims[1]; j++){
@@ -280,8 +414,16 @@ namespace MDR {
         std::vector<std::vector<uint32_t>> level_sizes;
         std::vector<uint32_t> level_num;
         std::vector<std::vector<double>> level_squared_errors;
+        std::vector<std::vector<double>> level_measured_errors;
+        std::vector<RetrievalPlan> retrieval_plans;
         int current_level = -1;
         std::vector<uint32_t> strides;
+        double estimated_error = -1;
+        double throughput = 1e8;
+        double recompose_time = 0;
+        double last_recompose_time = 0;
+        bool throughput_measured = false;
+        bool parallel_levels = false;
     };
 }
 #endif
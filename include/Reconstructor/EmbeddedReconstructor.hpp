@@ -0,0 +1,134 @@
+#ifndef _MDR_EMBEDDED_RECONSTRUCTOR_HPP
+#define _MDR_EMBEDDED_RECONSTRUCTOR_HPP
+
+#include "ReconstructorInterface.hpp"
+#include "Decomposer/Decomposer.hpp"
+#include "BitplaneEncoder/SPECKEncoder.hpp"
+#include "Retriever/Retriever.hpp"
+#include "SizeInterpreter/SizeInterpreter.hpp"
+#include "RefactorUtils.hpp"
+
+namespace MDR {
+    // reconstructor for EmbeddedRefactor: retrieve more segments of the embedded stream when needed,
+    // then decode the whole retrieved prefix and recompose
+    template<class T, class Decomposer, class Encoder, class SizeInterpreter, class Retriever>
+    class EmbeddedReconstructor : public concepts::ReconstructorInterface<T> {
+    public:
+        EmbeddedReconstructor(Decomposer decomposer, Encoder encoder, SizeInterpreter interpreter, Retriever retriever)
+            : decomposer(decomposer), encoder(encoder), interpreter(interpreter), retriever(retriever){}
+
+        // reconstruct data with the estimated error (weighted squared error) within tolerance
+        T * reconstruct(double tolerance){
+            return interpret_and_reconstruct([&](std::vector<uint8_t>& index){
+                return interpreter.interpret_retrieve_size(level_sizes, level_errors, tolerance, index);
+            });
+        }
+
+        // reconstruct data with the minimal estimated error within a byte budget
+        // the budget counts the bytes retrieved by this call, and the estimated error is available via get_estimated_error()
+        T * reconstruct_with_budget(uint64_t budget){
+            return interpret_and_reconstruct([&](std::vector<uint8_t>& index){
+                double estimated_error = 0;
+                return interpreter.interpret_retrieve_size_with_budget(level_sizes, level_errors, budget, index, estimated_error);
+            });
+        }
+
+        // the stream is embedded, so progressive reconstruction only retrieves the missing segments
+        T * progressive_reconstruct(double tolerance){
+            return reconstruct(tolerance);
+        }
+
+        void load_metadata(){
+            uint8_t * metadata = retriever.load_metadata();
+            uint8_t const * metadata_pos = metadata;
+            uint8_t num_dims = *(metadata_pos ++);
+            deserialize(metadata_pos, num_dims, dimensions);
+            uint8_t num_levels = *(metadata_pos ++);
+            deserialize(metadata_pos, num_levels, level_scales);
+            num_bitplanes = *(metadata_pos ++);
+            exp = *reinterpret_cast<const int32_t*>(metadata_pos);
+            metadata_pos += sizeof(int32_t);
+            num_bits = *reinterpret_cast<const uint64_t*>(metadata_pos);
+            metadata_pos += sizeof(uint64_t);
+            uint8_t num_segments = *(metadata_pos ++);
+            level_sizes = std::vector<std::vector<uint32_t>>(1);
+            level_errors = std::vector<std::vector<double>>(1);
+            deserialize(metadata_pos, num_segments, level_sizes[0]);
+            deserialize(metadata_pos, num_segments + 1, level_errors[0]);
+            level_num_segments = std::vector<uint8_t>(1, 0);
+            level_dims = compute_level_dims(dimensions, num_levels - 1);
+            size_t num_elements = 1;
+            for(const auto& d:dimensions) num_elements *= d;
+            data = std::vector<T>(num_elements, 0);
+            stream.clear();
+            free(metadata);
+        }
+
+        const std::vector<uint32_t>& get_dimensions(){
+            return dimensions;
+        }
+
+        // estimated error of the current reconstruction
+        double get_estimated_error() const {
+            return level_errors[0][level_num_segments[0]];
+        }
+
+        // total number of bytes retrieved so far
+        uint64_t get_retrieved_size() const {
+            return stream.size();
+        }
+
+        ~EmbeddedReconstructor(){}
+
+        void print() const {
+            std::cout << "Embedded reconstructor with the following components." << std::endl;
+            std::cout << "Decomposer: "; decomposer.print();
+            std::cout << "Encoder: "; encoder.print();
+            std::cout << "SizeInterpreter: "; interpreter.print();
+            std::cout << "Retriever: "; retriever.print();
+        }
+    private:
+        template<class Interpret>
+        T * interpret_and_reconstruct(Interpret interpret){
+            Timer timer;
+            timer.start();
+            auto prev_level_num_segments(level_num_segments);
+            auto retrieve_sizes = interpret(level_num_segments);
+            if(level_num_segments[0] == prev_level_num_segments[0]){
+                return data.data();
+            }
+            auto level_components = retriever.retrieve_level_components(level_sizes, retrieve_sizes, prev_level_num_segments, level_num_segments);
+            // segments of a level are contiguous
+            stream.insert(stream.end(), level_components[0][0], level_components[0][0] + retrieve_sizes[0]);
+            retriever.release();
+            timer.end();
+            timer.print("Retrieve");
+            timer.start();
+            encoder.decode(stream.data(), std::min(num_bits, (uint64_t) stream.size() * 8), data.data(), dimensions, level_dims, level_scales, num_bitplanes, exp);
+            timer.end();
+            timer.print("Decode");
+            timer.start();
+            decomposer.recompose(data.data(), dimensions, level_dims.size() - 1);
+            timer.end();
+            timer.print("Recompose");
+            return data.data();
+        }
+
+        Decomposer decomposer;
+        Encoder encoder;
+        SizeInterpreter interpreter;
+        Retriever retriever;
+        std::vector<T> data;
+        std::vector<uint32_t> dimensions;
+        std::vector<std::vector<uint32_t>> level_dims;
+        std::vector<T> level_scales;
+        uint8_t num_bitplanes = 0;
+        int exp = 0;
+        uint64_t num_bits = 0;
+        std::vector<std::vector<uint32_t>> level_sizes;
+        std::vector<std::vector<double>> level_errors;
+        std::vector<uint8_t> level_num_segments;
+        std::vector<uint8_t> stream;
+    };
+}
+#endif
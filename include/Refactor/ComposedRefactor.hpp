@@ -8,7 +8,10 @@
 #include "ErrorCollector/ErrorCollector.hpp"
 #include "LosslessCompressor/LevelCompressor.hpp"
 #include "Writer/Writer.hpp"
+#include "ErrorEstimator/ErrorEstimator.hpp"
+#include "SizeInterpreter/RetrievalPlan.hpp"
 #include "RefactorUtils.hpp"
+#include <functional>
 
 namespace MDR {
     // a decomposition-based scientific data refactor: compose a refactor using decomposer, interleaver, encoder, and error collector
@@ -32,6 +35,7 @@ namespace MDR {
                 timer.end();
                 timer.print("Refactor");
                 timer.start();
+                writer.set_retrieval_plans(retrieval_plans);
                 level_num = writer.write_level_components(level_components, level_sizes);
                 timer.end();
                 timer.print("Write");                
@@ -45,12 +49,49 @@ namespace MDR {
             }
         }
 
+        // precompute a retrieval plan for the given estimator and store it in metadata
+        // plans are indexed in the order they are added
+        template<class ErrorEstimator>
+        void add_retrieval_plan(const ErrorEstimator& estimator){
+            plan_generators.push_back([estimator](const std::vector<std::vector<uint32_t>>& level_sizes, const std::vector<std::vector<double>>& level_abs_errors, const std::vector<std::vector<double>>& level_squared_errors, const std::vector<std::vector<double>>& level_measured_errors) -> RetrievalPlan {
+                if(std::is_base_of<MeasuredMaxErrorEstimator<T>, ErrorEstimator>::value){
+                    if(level_measured_errors.empty()){
+                        std::cerr << "Measured errors are required by the retrieval plan, enable set_measure_errors." << std::endl;
+                        exit(-1);
+                    }
+                    return generate_retrieval_plan(level_sizes, level_measured_errors, estimator);
+                }
+                else if(std::is_base_of<MaxErrorEstimator<T>, ErrorEstimator>::value){
+                    return generate_retrieval_plan(level_sizes, level_abs_errors, estimator);
+                }
+                else if(std::is_base_of<SquaredErrorEstimator<T>, ErrorEstimator>::value){
+                    return generate_retrieval_plan(level_sizes, level_squared_errors, estimator);
+                }
+                std::cerr << "Customized error estimator not supported yet" << std::endl;
+                exit(-1);
+            });
+        }
+
+        // measure the max error of the recomposed data when each level is truncated at each bitplane
+        // the measured tables are stored in metadata for MeasuredMaxErrorEstimator
+        // this costs one recomposition per level and bitplane
+        void set_measure_errors(bool measure){
+            measure_errors = measure;
+        }
+
         void write_metadata() const {
-            uint32_t metadata_size = sizeof(uint8_t) + get_size(dimensions) // dimensions
+            uint32_t metadata_size = sizeof(uint8_t) // version
+                            + sizeof(uint8_t) + get_size(dimensions) // dimensions
                             + sizeof(uint8_t) + get_size(level_error_bounds) + get_size(level_squared_errors) + get_size(level_sizes) // level information
                             + get_size(stopping_indices) + get_size(level_num);
+            metadata_size += sizeof(uint8_t); // retrieval plans
+            for(const auto& plan:retrieval_plans){
+                metadata_size += get_size(plan);
+            }
+            metadata_size += sizeof(uint8_t) + get_size(level_measured_errors); // measured errors
             uint8_t * metadata = (uint8_t *) malloc(metadata_size);
             uint8_t * metadata_pos = metadata;
+            *(metadata_pos ++) = METADATA_VERSION_FLAG | METADATA_VERSION;
             *(metadata_pos ++) = (uint8_t) dimensions.size();
             serialize(dimensions, metadata_pos);
             *(metadata_pos ++) = (uint8_t) level_error_bounds.size();
@@ -59,6 +100,12 @@ namespace MDR {
             serialize(level_sizes, metadata_pos);
             serialize(stopping_indices, metadata_pos);
             serialize(level_num, metadata_pos);
+            *(metadata_pos ++) = (uint8_t) retrieval_plans.size();
+            for(const auto& plan:retrieval_plans){
+                serialize(plan, metadata_pos);
+            }
+            *(metadata_pos ++) = (uint8_t) level_measured_errors.size();
+            serialize(level_measured_errors, metadata_pos);
             writer.write_metadata(metadata, metadata_size);
             free(metadata);
         }
@@ -73,7 +120,7 @@ namespace MDR {
         }
     private:
         bool refactor(uint8_t target_level, uint8_t num_bitplanes){
-            uint8_t max_level = log2(*min_element(dimensions.begin(), dimensions.end())) - 1;
+            uint32_t max_level = decomposer.max_level(dimensions);
             if(target_level > max_level){
                 std::cerr << "Target level is higher than " << max_level << std::endl;
                 return false;
@@ -88,6 +135,7 @@ namespace MDR {
             // encode level by level
             level_error_bounds.clear();
             level_squared_errors.clear();
+            level_measured_errors.clear();
             level_components.clear();
             level_sizes.clear();
             auto level_dims = compute_level_dims(dimensions, target_level);
@@ -97,42 +145,96 @@ namespace MDR {
             for(int i=0; i<=target_level; i++){
                 // timer.start();
                 const std::vector<uint32_t>& prev_dims = (i == 0) ? dims_dummy : level_dims[i - 1];
-                T * buffer = (T *) malloc(level_elements[i] * sizeof(T));
-                // extract level i component
-                interleaver.interleave(data.data(), dimensions, level_dims[i], prev_dims, reinterpret_cast<T*>(buffer));
+                // read level i component in place
+                auto reader = interleaver.level_reader(data.data(), dimensions, level_dims[i], prev_dims);
                 // compute max coefficient as level error bound
-                T level_max_error = compute_max_abs_value(reinterpret_cast<T*>(buffer), level_elements[i]);
+                T level_max_error = reader.compute_max_abs_value();
                 level_error_bounds.push_back(level_max_error);
                 // timer.end();
                 // timer.print("Interleave");
-                // collect errors
-                // auto collected_error = s_collector.collect_level_error(buffer, level_elements[i], num_bitplanes, level_max_error);
-                // level_squared_errors.push_back(collected_error);
                 // encode level data
                 // timer.start();
                 int level_exp = 0;
                 frexp(level_max_error, &level_exp);
+                std::vector<uint8_t*> streams;
                 std::vector<uint32_t> stream_sizes;
                 std::vector<double> level_sq_err;
-                auto streams = encoder.encode(buffer, level_elements[i], level_exp, num_bitplanes, stream_sizes, level_sq_err);
-                free(buffer);
+                uint8_t stopping_index = 0;
+                if(measure_errors){
+                    // error measurement decodes the uncompressed bitplanes
+                    streams = encoder.stream_encode(reader, level_elements[i], level_exp, num_bitplanes, stream_sizes, level_sq_err);
+                    std::vector<T> buffer(level_elements[i]);
+                    interleaver.interleave(data.data(), dimensions, level_dims[i], prev_dims, buffer.data());
+                    level_measured_errors.push_back(measure_level_errors(buffer.data(), level_elements[i], level_exp, streams, level_dims, i));
+                    // lossless compression
+                    stopping_index = compressor.compress_level(streams, stream_sizes);
+                }
+                else{
+                    // bitplanes are compressed while being encoded
+                    auto sink = compressor.level_sink(num_bitplanes);
+                    encoder.stream_encode_to_sink(reader, level_elements[i], level_exp, num_bitplanes, sink, level_sq_err);
+                    stopping_index = compressor.compress_level(sink, streams, stream_sizes);
+                }
                 level_squared_errors.push_back(level_sq_err);
-                // timer.end();
-                // timer.print("Encoding");
-                // timer.start();
-                // lossless compression
-                uint8_t stopping_index = compressor.compress_level(streams, stream_sizes);
                 stopping_indices.push_back(stopping_index);
                 // record encoded level data and size
                 level_components.push_back(streams);
                 level_sizes.push_back(stream_sizes);
                 // timer.end();
-                // timer.print("Lossless time");
+                // timer.print("Encoding and lossless compression");
             }
             // print_vec("level sizes", level_sizes);
+            generate_retrieval_plans();
             return true;
         }
 
+        void generate_retrieval_plans(){
+            retrieval_plans.clear();
+            if(plan_generators.empty()) return;
+            std::vector<std::vector<double>> level_abs_errors;
+            MaxErrorCollector<T> collector = MaxErrorCollector<T>();
+            for(int i=0; i<level_error_bounds.size(); i++){
+                level_abs_errors.push_back(collector.collect_level_error(NULL, 0, level_sizes[i].size(), level_error_bounds[i]));
+            }
+            for(const auto& generator:plan_generators){
+                retrieval_plans.push_back(generator(level_sizes, level_abs_errors, level_squared_errors, level_measured_errors));
+            }
+        }
+
+        // max error of the recomposed data when truncating the level at each bitplane
+        /*
+            @params level_data: interleaved level coefficients
+            @params streams: uncompressed encoded bitplanes of the level
+        */
+        std::vector<double> measure_level_errors(T const * level_data, uint32_t n, int level_exp, const std::vector<uint8_t*>& streams, const std::vector<std::vector<uint32_t>>& level_dims, int level) const {
+            const uint8_t num_bitplanes = streams.size();
+            const uint8_t target_level = level_dims.size() - 1;
+            std::vector<double> measured_errors(num_bitplanes + 1, 0);
+            std::vector<T> level_error(level_data, level_data + n);
+            std::vector<T> recomposed_error(data.size());
+            std::vector<uint32_t> dims_dummy(dimensions.size(), 0);
+            const std::vector<uint32_t>& prev_dims = (level == 0) ? dims_dummy : level_dims[level - 1];
+            // decode with a separate encoder to keep the progressive states apart
+            Encoder decoder(encoder);
+            for(int j=0; j<=num_bitplanes; j++){
+                if(j > 0){
+                    std::vector<uint8_t const *> plane_streams(streams.begin() + j - 1, streams.end());
+                    T * increment = decoder.progressive_decode(plane_streams, n, level_exp, j - 1, 1, level);
+                    for(int k=0; k<n; k++){
+                        level_error[k] -= increment[k];
+                    }
+                    free(increment);
+                }
+                // remaining errors are 0 once the level is lossless
+                if(compute_max_abs_value(level_error.data(), n) == 0) break;
+                memset(recomposed_error.data(), 0, recomposed_error.size() * sizeof(T));
+                interleaver.reposition(level_error.data(), dimensions, level_dims[level], prev_dims, recomposed_error.data());
+                decomposer.recompose(recomposed_error.data(), dimensions, target_level);
+                measured_errors[j] = compute_max_abs_value(recomposed_error.data(), recomposed_error.size());
+            }
+            return measured_errors;
+        }
+
         Decomposer decomposer;
         Interleaver interleaver;
         Encoder encoder;
@@ -147,6 +249,10 @@ namespace MDR {
         std::vector<std::vector<uint32_t>> level_sizes;
         std::vector<uint32_t> level_num;
         std::vector<std::vector<double>> level_squared_errors;
+        std::vector<std::vector<double>> level_measured_errors;
+        std::vector<std::function<RetrievalPlan(const std::vector<std::vector<uint32_t>>&, const std::vector<std::vector<double>>&, const std::vector<std::vector<double>>&, const std::vector<std::vector<double>>&)>> plan_generators;
+        std::vector<RetrievalPlan> retrieval_plans;
+        bool measure_errors = false;
     };
 }
 #endif
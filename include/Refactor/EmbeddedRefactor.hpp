@@ -0,0 +1,163 @@
+#ifndef _MDR_EMBEDDED_REFACTOR_HPP
+#define _MDR_EMBEDDED_REFACTOR_HPP
+
+#include "RefactorInterface.hpp"
+#include "Decomposer/Decomposer.hpp"
+#include "BitplaneEncoder/SPECKEncoder.hpp"
+#include "Writer/Writer.hpp"
+#include "ErrorEstimator/ErrorEstimator.hpp"
+#include "RefactorUtils.hpp"
+
+namespace MDR {
+    // a decomposition-based refactor with an embedded encoder (e.g. SPECKEncoder) coding all levels in one stream
+    // the stream is split into at most MAX_SEGMENTS segments at the encoder checkpoints,
+    // and written as a single level whose components are the segments, so the usual writers and retrievers apply
+    // level coefficients are weighted by the squared error estimator, whose errors are stored for each segment
+    template<class T, class Decomposer, class Encoder, class ErrorEstimator, class Writer>
+    class EmbeddedRefactor : public concepts::RefactorInterface<T> {
+    public:
+        static const int MAX_SEGMENTS = 255;
+        EmbeddedRefactor(Decomposer decomposer, Encoder encoder, ErrorEstimator estimator, Writer writer)
+            : decomposer(decomposer), encoder(encoder), estimator(estimator), writer(writer) {
+            static_assert(std::is_base_of<SquaredErrorEstimator<T>, ErrorEstimator>::value, "EmbeddedRefactor: only squared error estimators are supported.");
+        }
+
+        void refactor(T const * data_, const std::vector<uint32_t>& dims, uint8_t target_level, uint8_t num_bitplanes){
+            Timer timer;
+            timer.start();
+            dimensions = dims;
+            uint32_t num_elements = 1;
+            for(const auto& dim:dimensions){
+                num_elements *= dim;
+            }
+            data = std::vector<T>(data_, data_ + num_elements);
+            // if refactor successfully
+            if(refactor(target_level, num_bitplanes)){
+                timer.end();
+                timer.print("Refactor");
+                timer.start();
+                writer.write_level_components(level_components, level_sizes);
+                timer.end();
+                timer.print("Write");
+            }
+
+            write_metadata();
+            for(int i=0; i<level_components.size(); i++){
+                for(int j=0; j<level_components[i].size(); j++){
+                    free(level_components[i][j]);
+                }
+            }
+        }
+
+        void write_metadata() const {
+            if(level_sizes.empty()) return;
+            uint32_t metadata_size = sizeof(uint8_t) + get_size(dimensions) // dimensions
+                            + sizeof(uint8_t) + get_size(level_scales) + sizeof(uint8_t) + sizeof(int32_t) + sizeof(uint64_t) // encoding
+                            + sizeof(uint8_t) + get_size(level_sizes[0]) + get_size(segment_errors); // segments
+            uint8_t * metadata = (uint8_t *) malloc(metadata_size);
+            uint8_t * metadata_pos = metadata;
+            *(metadata_pos ++) = (uint8_t) dimensions.size();
+            serialize(dimensions, metadata_pos);
+            *(metadata_pos ++) = (uint8_t) level_scales.size();
+            serialize(level_scales, metadata_pos);
+            *(metadata_pos ++) = num_bitplanes;
+            *reinterpret_cast<int32_t*>(metadata_pos) = exp;
+            metadata_pos += sizeof(int32_t);
+            *reinterpret_cast<uint64_t*>(metadata_pos) = num_bits;
+            metadata_pos += sizeof(uint64_t);
+            *(metadata_pos ++) = (uint8_t) level_sizes[0].size();
+            serialize(level_sizes[0], metadata_pos);
+            serialize(segment_errors, metadata_pos);
+            writer.write_metadata(metadata, metadata_size);
+            free(metadata);
+        }
+
+        // checkpoints are taken every interval bytes of the stream; 0 derives the interval from the data size
+        void set_checkpoint_interval(uint64_t interval){
+            checkpoint_interval = interval;
+        }
+
+        ~EmbeddedRefactor(){}
+
+        void print() const {
+            std::cout << "Embedded refactor with the following components." << std::endl;
+            std::cout << "Decomposer: "; decomposer.print();
+            std::cout << "Encoder: "; encoder.print();
+            std::cout << "ErrorEstimator: "; estimator.print();
+        }
+    private:
+        bool refactor(uint8_t target_level, uint8_t num_bitplanes){
+            uint32_t max_level = decomposer.max_level(dimensions);
+            if(target_level > max_level){
+                std::cerr << "Target level is higher than " << max_level << std::endl;
+                return false;
+            }
+            decomposer.decompose(data.data(), dimensions, target_level);
+            auto level_dims = compute_level_dims(dimensions, target_level);
+            // weight coefficients so that their squared errors are the estimated errors
+            level_scales = std::vector<T>(target_level + 1);
+            for(int i=0; i<=target_level; i++){
+                level_scales[i] = sqrt(estimator.estimate_error(1, i));
+            }
+            this->num_bitplanes = num_bitplanes;
+            uint64_t interval = checkpoint_interval ? checkpoint_interval : std::max((size_t) 1, data.size() * sizeof(T) / (4 * MAX_SEGMENTS));
+            std::vector<EmbeddedCheckpoint> checkpoints;
+            auto stream = encoder.encode(data.data(), dimensions, level_dims, level_scales, num_bitplanes, exp, num_bits, checkpoints, interval);
+            split_segments(stream, checkpoints);
+            return true;
+        }
+
+        // cut the stream at the first checkpoints past geometrically growing sizes, and at the end
+        // errors drop quickly in the first bytes, so early segments are small
+        void split_segments(const std::vector<uint8_t>& stream, const std::vector<EmbeddedCheckpoint>& checkpoints){
+            level_components = std::vector<std::vector<uint8_t*>>(1);
+            level_sizes = std::vector<std::vector<uint32_t>>(1);
+            segment_errors = std::vector<double>(1, checkpoints[0].squared_error);
+            const double total_size = stream.size();
+            const double first_size = std::max((uint64_t) 1, checkpoints[std::min((size_t) 1, checkpoints.size() - 1)].num_bytes);
+            const double ratio = pow(total_size / first_size, 1.0 / (MAX_SEGMENTS - 1));
+            double next_size = first_size;
+            uint64_t segment_start = 0;
+            for(int i=1; i<checkpoints.size(); i++){
+                const uint64_t end = checkpoints[i].num_bytes;
+                const bool last = (i == checkpoints.size() - 1);
+                if((end < next_size) && !last) continue;
+                // the last segment is kept for the end of the stream, as the count is stored in a uint8_t
+                if((level_sizes[0].size() == MAX_SEGMENTS - 1) && !last) continue;
+                // no empty segments: a checkpoint at the same size only lowers the error
+                if((end == segment_start) && level_sizes[0].size()){
+                    segment_errors.back() = checkpoints[i].squared_error;
+                    continue;
+                }
+                // ratio <= 1 when the first checkpoint is already the end of the stream
+                if(ratio > 1){
+                    while(next_size <= end) next_size *= ratio;
+                }
+                else next_size = total_size + 1;
+                uint32_t size = end - segment_start;
+                uint8_t * segment = (uint8_t *) malloc(size);
+                memcpy(segment, stream.data() + segment_start, size);
+                level_components[0].push_back(segment);
+                level_sizes[0].push_back(size);
+                segment_errors.push_back(checkpoints[i].squared_error);
+                segment_start = end;
+            }
+        }
+
+        Decomposer decomposer;
+        Encoder encoder;
+        ErrorEstimator estimator;
+        Writer writer;
+        std::vector<T> data;
+        std::vector<uint32_t> dimensions;
+        std::vector<T> level_scales;
+        uint8_t num_bitplanes = 0;
+        int exp = 0;
+        uint64_t num_bits = 0;
+        uint64_t checkpoint_interval = 0;
+        std::vector<std::vector<uint8_t*>> level_components;
+        std::vector<std::vector<uint32_t>> level_sizes;
+        std::vector<double> segment_errors;
+    };
+}
+#endif
@@ -2,5 +2,6 @@
 #define _MDR_REFACTOR_HPP
 
 #include "ComposedRefactor.hpp"
+#include "EmbeddedRefactor.hpp"
 
 #endif
@@ -10,6 +10,11 @@ namespace MDR {
 
     // MDR utility functions
 
+    // the metadata of ComposedRefactor starts with a version byte carrying this flag;
+    // metadata written before starts with the number of dimensions, and has no retrieval plans or measured errors
+    #define METADATA_VERSION_FLAG 0x80 // set in the version byte, never in a number of dimensions
+    #define METADATA_VERSION 1 // version with retrieval plans and measured errors
+
     // MGARD related
     // TODO: put API in MGARD
 
@@ -17,6 +22,8 @@ namespace MDR {
     /*
         @params dims: input dimensions
         @params target_level: the target decomposition level
+        a dimension stops shrinking once it has fewer than 3 nodes ((n >> 1) + 1 = n for n < 3),
+        so levels beyond the shortest dimension only coarsen the longer ones
     */
     std::vector<std::vector<uint32_t>> compute_level_dims(const std::vector<uint32_t>& dims, uint32_t target_level){
         std::vector<std::vector<uint32_t>> level_dims;
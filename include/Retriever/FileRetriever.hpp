@@ -2,6 +2,7 @@
 #define _MDR_FILE_RETRIEVER_HPP
 
 #include "RetrieverInterface.hpp"
+#include "RetrieverUtils.hpp"
 #include <cstdio>
 
 namespace MDR {
@@ -30,18 +31,12 @@ namespace MDR {
                 total_retrieve_size += offsets[i];
             }
             std::cout << "Total retrieve size = " << total_retrieve_size << std::endl;
-            return interleave_level_components(level_sizes, prev_level_num_bitplanes, level_num_bitplanes);
+            return interleave_level_components(concated_level_components, level_sizes, prev_level_num_bitplanes, level_num_bitplanes);
         }
 
         uint8_t * load_metadata() const {
-            FILE * file = fopen(metadata_file.c_str(), "r");
-            fseek(file, 0, SEEK_END);
-            uint32_t num_bytes = ftell(file);
-            rewind(file);
-            uint8_t * metadata = (uint8_t *) malloc(num_bytes);
-            fread(metadata, 1, num_bytes, file);
-            fclose(file);
-            return metadata;
+            uint32_t num_bytes = 0;
+            return load_metadata_file(metadata_file, num_bytes);
         }
 
         void release(){
@@ -57,20 +52,6 @@ namespace MDR {
             std::cout << "File retriever." << std::endl;
         }
     private:
-        std::vector<std::vector<const uint8_t*>> interleave_level_components(const std::vector<std::vector<uint32_t>>& level_sizes, const std::vector<uint8_t>& prev_level_num_bitplanes, const std::vector<uint8_t>& level_num_bitplanes){
-            std::vector<std::vector<const uint8_t*>> level_components;
-            for(int i=0; i<level_num_bitplanes.size(); i++){
-                const uint8_t * pos = concated_level_components[i];
-                std::vector<const uint8_t*> interleaved_level;
-                for(int j=prev_level_num_bitplanes[i]; j<level_num_bitplanes[i]; j++){
-                    interleaved_level.push_back(pos);
-                    pos += level_sizes[i][j];
-                }
-                level_components.push_back(interleaved_level);
-            }
-            return level_components;
-        }
-
         std::vector<std::string> level_files;
         std::string metadata_file;
         std::vector<uint32_t> offsets;
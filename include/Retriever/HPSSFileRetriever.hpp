@@ -1,47 +1,80 @@
 #ifndef _MDR_HPSS_FILE_RETRIEVER_HPP
-#define _MDR_HOSS_FILE_RETRIEVER_HPP
+#define _MDR_HPSS_FILE_RETRIEVER_HPP
 
 #include "RetrieverInterface.hpp"
+#include "RetrieverUtils.hpp"
 #include <cstdio>
+#include <thread>
+#include <atomic>
 
 namespace MDR {
-    // Data retriever for files
-    class ConcatLevelFileRetriever : public concepts::RetrieverInterface {
+    // Data retriever for the aggregated files written by HPSSFileWriter
+    // an aggregated file is always read whole, since accessing it is what costs on HPSS: the bitplanes read beyond
+    // the request are kept for the next requests, so that every file is touched once
+    // the files of a request are read in one batch by num_threads threads
+    class HPSSFileRetriever : public concepts::RetrieverInterface {
     public:
-        ConcatLevelFileRetriever(const std::string& metadata_file, const std::vector<std::string>& level_files) : metadata_file(metadata_file), level_files(level_files) {
+        HPSSFileRetriever(const std::string& metadata_file, const std::vector<std::string>& level_files, int num_threads = 8) : metadata_file(metadata_file), level_files(level_files), num_threads(std::max(num_threads, 1)) {
             offsets = std::vector<uint32_t>(level_files.size(), 0);
+            next_chunks = std::vector<uint32_t>(level_files.size(), 0);
+            remainders = std::vector<std::vector<uint8_t>>(level_files.size());
         }
 
         std::vector<std::vector<const uint8_t*>> retrieve_level_components(const std::vector<std::vector<uint32_t>>& level_sizes, const std::vector<uint32_t>& retrieve_sizes, const std::vector<uint8_t>& prev_level_num_bitplanes, const std::vector<uint8_t>& level_num_bitplanes){
             assert(offsets.size() == retrieve_sizes.size());
             release();
+            if(chunk_ends.empty()) load_chunk_ends();
+            // plan the files to read: the bitplanes left from the last file read of a level come first
+            std::vector<ChunkRead> reads;
+            std::vector<Tail> tails(level_files.size());
             uint32_t total_retrieve_size = 0;
             for(int i=0; i<level_files.size(); i++){
                 std::cout << "Retrieve " << +level_num_bitplanes[i] << " (" << +(level_num_bitplanes[i] - prev_level_num_bitplanes[i]) << " more) bitplanes from level " << i << std::endl;
-                FILE * file = fopen(level_files[i].c_str(), "r");
-                if(fseek(file, offsets[i], SEEK_SET)){
-                    std::cerr << "Errors in fseek while retrieving from file" << std::endl;
-                }
                 uint8_t * buffer = (uint8_t *) malloc(retrieve_sizes[i]);
-                fread(buffer, sizeof(uint8_t), retrieve_sizes[i], file);
+                uint32_t filled = std::min(retrieve_sizes[i], (uint32_t) remainders[i].size());
+                memcpy(buffer, remainders[i].data(), filled);
+                remainders[i].erase(remainders[i].begin(), remainders[i].begin() + filled);
+                uint32_t covered = next_chunks[i] ? chunk_ends[i][next_chunks[i] - 1] : 0;
+                while(covered < level_num_bitplanes[i]){
+                    if(next_chunks[i] >= chunk_ends[i].size()){
+                        std::cerr << "Bitplane " << covered << " of level " << i << " is not in any aggregated file" << std::endl;
+                        exit(-1);
+                    }
+                    uint32_t chunk_end = chunk_ends[i][next_chunks[i]];
+                    uint32_t chunk_size = 0;
+                    for(int j=covered; j<chunk_end; j++) chunk_size += level_sizes[i][j];
+                    std::string file = level_files[i] + "_" + std::to_string(next_chunks[i]);
+                    if(chunk_end <= level_num_bitplanes[i]){
+                        reads.push_back({file, chunk_size, buffer + filled});
+                        filled += chunk_size;
+                    }
+                    else{
+                        // the last file is read aside and split between this request and the next ones
+                        tails[i].data.resize(chunk_size);
+                        tails[i].offset = filled;
+                        tails[i].head = retrieve_sizes[i] - filled;
+                        reads.push_back({file, chunk_size, tails[i].data.data()});
+                    }
+                    covered = chunk_end;
+                    next_chunks[i] ++;
+                }
                 concated_level_components.push_back(buffer);
-                fclose(file);
                 offsets[i] += retrieve_sizes[i];
                 total_retrieve_size += offsets[i];
             }
-            std::cout << "Total retrieve size = " << total_retrieve_size << std::endl;
-            return interleave_level_components(level_sizes, prev_level_num_bitplanes, level_num_bitplanes);
+            read_chunks(reads);
+            for(int i=0; i<level_files.size(); i++){
+                if(tails[i].data.empty()) continue;
+                memcpy(concated_level_components[i] + tails[i].offset, tails[i].data.data(), tails[i].head);
+                remainders[i].assign(tails[i].data.begin() + tails[i].head, tails[i].data.end());
+            }
+            std::cout << "Total retrieve size = " << total_retrieve_size << ", " << reads.size() << " aggregated files read" << std::endl;
+            return interleave_level_components(concated_level_components, level_sizes, prev_level_num_bitplanes, level_num_bitplanes);
         }
 
         uint8_t * load_metadata() const {
-            FILE * file = fopen(metadata_file.c_str(), "r");
-            fseek(file, 0, SEEK_END);
-            uint32_t num_bytes = ftell(file);
-            rewind(file);
-            uint8_t * metadata = (uint8_t *) malloc(num_bytes);
-            fread(metadata, 1, num_bytes, file);
-            fclose(file);
-            return metadata;
+            uint32_t num_bytes = 0;
+            return load_metadata_file(metadata_file, num_bytes);
         }
 
         void release(){
@@ -51,30 +84,75 @@ namespace MDR {
             concated_level_components.clear();
         }
 
-        ~ConcatLevelFileRetriever(){}
+        ~HPSSFileRetriever(){}
 
         void print() const {
-            std::cout << "File retriever." << std::endl;
+            std::cout << "HPSS file retriever." << std::endl;
+        }
+    protected:
+        // read an aggregated file whole
+        virtual void read_file(const std::string& filename, uint32_t size, uint8_t * dest) const {
+            FILE * file = fopen(filename.c_str(), "r");
+            if(!file || (fread(dest, 1, size, file) != size)){
+                std::cerr << "Errors in reading " << filename << std::endl;
+                exit(-1);
+            }
+            fclose(file);
         }
     private:
-        std::vector<std::vector<const uint8_t*>> interleave_level_components(const std::vector<std::vector<uint32_t>>& level_sizes, const std::vector<uint8_t>& prev_level_num_bitplanes, const std::vector<uint8_t>& level_num_bitplanes){
-            std::vector<std::vector<const uint8_t*>> level_components;
-            for(int i=0; i<level_num_bitplanes.size(); i++){
-                const uint8_t * pos = concated_level_components[i];
-                std::vector<const uint8_t*> interleaved_level;
-                for(int j=prev_level_num_bitplanes[i]; j<level_num_bitplanes[i]; j++){
-                    interleaved_level.push_back(pos);
-                    pos += level_sizes[i][j];
-                }
-                level_components.push_back(interleaved_level);
+        struct ChunkRead {
+            std::string file;
+            uint32_t size;
+            uint8_t * dest;
+        };
+        // file split between requests: its first head bytes go to offset in the level buffer
+        struct Tail {
+            std::vector<uint8_t> data;
+            uint32_t offset = 0;
+            uint32_t head = 0;
+        };
+        void read_chunks(const std::vector<ChunkRead>& reads) const {
+            std::atomic<size_t> next_read(0);
+            std::vector<std::thread> threads;
+            for(int t=0; t<std::min((size_t) num_threads, reads.size()); t++){
+                threads.push_back(std::thread([this, &reads, &next_read](){
+                    for(size_t i=next_read ++; i<reads.size(); i=next_read ++){
+                        read_file(reads[i].file, reads[i].size, reads[i].dest);
+                    }
+                }));
+            }
+            for(auto& thread:threads) thread.join();
+        }
+        // chunk table appended to the metadata by HPSSFileWriter
+        void load_chunk_ends(){
+            uint32_t num_bytes = 0;
+            uint8_t * metadata = load_metadata_file(metadata_file, num_bytes);
+            uint32_t chunk_table_size = 0;
+            memcpy(&chunk_table_size, metadata + num_bytes - sizeof(uint32_t), sizeof(uint32_t));
+            std::vector<uint32_t> chunk_table_data(chunk_table_size / sizeof(uint32_t));
+            memcpy(chunk_table_data.data(), metadata + num_bytes - sizeof(uint32_t) - chunk_table_size, chunk_table_size);
+            uint32_t const * chunk_table = chunk_table_data.data();
+            uint32_t num_levels = *(chunk_table ++);
+            for(int i=0; i<num_levels; i++){
+                uint32_t num_chunks = *(chunk_table ++);
+                chunk_ends.push_back(std::vector<uint32_t>(chunk_table, chunk_table + num_chunks));
+                chunk_table += num_chunks;
+            }
+            free(metadata);
+            if(chunk_ends.size() != level_files.size()){
+                std::cerr << "The metadata has " << chunk_ends.size() << " aggregated levels, but " << level_files.size() << " level files are given" << std::endl;
+                exit(-1);
             }
-            return level_components;
         }
 
-        std::vector<std::string> level_files;
         std::string metadata_file;
+        std::vector<std::string> level_files;
+        int num_threads = 8;
         std::vector<uint32_t> offsets;
         std::vector<uint8_t*> concated_level_components;
+        std::vector<std::vector<uint32_t>> chunk_ends;
+        std::vector<uint32_t> next_chunks;                  // next aggregated file to read for each level
+        std::vector<std::vector<uint8_t>> remainders;       // bitplanes read beyond the last request for each level
     };
 }
 #endif
@@ -0,0 +1,295 @@
+#ifndef _MDR_HTTP_RANGE_CLIENT_HPP
+#define _MDR_HTTP_RANGE_CLIENT_HPP
+
+#include <iostream>
+#include <cstring>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <atomic>
+#include <memory>
+#include <algorithm>
+#include <sys/socket.h>
+#include <netdb.h>
+#include <unistd.h>
+
+namespace MDR {
+    #define HTTP_RECV_BUFFER_SIZE (1u << 16) // bytes received at a time while parsing response headers
+    #define HTTP_PART_SIZE (1u << 23) // maximal bytes of a range request, so that large ranges are spread over connections
+    #define HTTP_COALESCE_GAP (1u << 16) // ranges of an object separated by fewer bytes are read by the same requests
+    #define HTTP_MAX_RECONNECTS 3 // reconnections in a row without a response before giving up
+    // byte range [offset, offset + size) of an object, read into dest
+    struct HTTPRange {
+        std::string path;
+        uint64_t offset;
+        uint32_t size;
+        uint8_t * dest;
+    };
+
+    // persistent (keep-alive) HTTP/1.1 connection sending GET requests and reading their responses in order,
+    // so that several requests can be in flight (pipelined) on the connection
+    // sending and reading return false when the server closed the connection, and the requests
+    // not answered yet are to be sent again after reconnect()
+    class HTTPConnection {
+    public:
+        HTTPConnection(const std::string& host, int port) : host(host), port(port) {
+            open();
+        }
+        HTTPConnection(const HTTPConnection&) = delete;
+        HTTPConnection& operator=(const HTTPConnection&) = delete;
+        ~HTTPConnection(){
+            if(fd >= 0) close(fd);
+        }
+        // request the whole object if size is 0
+        bool send_get(const std::string& path, uint64_t offset, uint32_t size){
+            std::string request = "GET " + path + " HTTP/1.1\r\nHost: " + host + "\r\n";
+            if(size) request += "Range: bytes=" + std::to_string(offset) + "-" + std::to_string(offset + size - 1) + "\r\n";
+            request += "\r\n";
+            size_t sent = 0;
+            while(sent < request.size()){
+                ssize_t count = send(fd, request.data() + sent, request.size() - sent, MSG_NOSIGNAL);
+                if(count <= 0) return false;
+                sent += count;
+            }
+            return true;
+        }
+        // read the headers of the response to the oldest request and its body size
+        bool read_header(uint32_t& size){
+            std::string status;
+            if(!read_line(status)) return false;
+            int code = (status.size() > 12) ? atoi(status.c_str() + 9) : 0;
+            uint64_t content_length = 0;
+            std::string line;
+            while(true){
+                if(!read_line(line)) return false;
+                if(line.empty()) break;
+                std::transform(line.begin(), line.end(), line.begin(), ::tolower);
+                if(line.compare(0, 15, "content-length:") == 0) content_length = strtoull(line.c_str() + 15, NULL, 10);
+                // the server closes the connection after this response
+                if((line.compare(0, 11, "connection:") == 0) && (line.find("close") != std::string::npos)) closing = true;
+            }
+            if((code != 200) && (code != 206)){
+                std::cerr << "Unexpected HTTP response: " << status << std::endl;
+                exit(-1);
+            }
+            size = content_length;
+            return true;
+        }
+        // read the body of the response whose headers were read into dest
+        bool read_body(uint8_t * dest, uint32_t size){
+            // bytes received along with the headers come first
+            uint32_t buffered = std::min(size, (uint32_t) (buffer_end - buffer_begin));
+            memcpy(dest, buffer.data() + buffer_begin, buffered);
+            buffer_begin += buffered;
+            uint32_t received = buffered;
+            while(received < size){
+                ssize_t count = recv(fd, dest + received, size - received, 0);
+                if(count <= 0) return false;
+                received += count;
+            }
+            return true;
+        }
+        // whether the last response announced that the server closes the connection
+        bool closed_by_server() const {
+            return closing;
+        }
+        // open a new connection, dropping the responses not read yet
+        void reconnect(){
+            if(fd >= 0) close(fd);
+            fd = -1;
+            buffer_begin = buffer_end = 0;
+            closing = false;
+            open();
+        }
+    private:
+        void open(){
+            struct addrinfo hints = {};
+            hints.ai_family = AF_UNSPEC;
+            hints.ai_socktype = SOCK_STREAM;
+            struct addrinfo * addresses = NULL;
+            if(getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &addresses)){
+                std::cerr << "Cannot resolve " << host << std::endl;
+                exit(-1);
+            }
+            for(struct addrinfo * address=addresses; address; address=address->ai_next){
+                fd = socket(address->ai_family, address->ai_socktype, address->ai_protocol);
+                if(fd < 0) continue;
+                if(connect(fd, address->ai_addr, address->ai_addrlen) == 0) break;
+                close(fd);
+                fd = -1;
+            }
+            freeaddrinfo(addresses);
+            if(fd < 0){
+                std::cerr << "Cannot connect to " << host << ":" << port << std::endl;
+                exit(-1);
+            }
+        }
+        bool read_line(std::string& line){
+            line.clear();
+            while(true){
+                if(buffer_begin == buffer_end){
+                    if(buffer.empty()) buffer.resize(HTTP_RECV_BUFFER_SIZE);
+                    ssize_t count = recv(fd, buffer.data(), buffer.size(), 0);
+                    if(count <= 0) return false;
+                    buffer_begin = 0;
+                    buffer_end = count;
+                }
+                char c = buffer[buffer_begin ++];
+                if(c == '\n') break;
+                if(c != '\r') line += c;
+            }
+            return true;
+        }
+        std::string host;
+        int port;
+        int fd = -1;
+        bool closing = false;
+        std::vector<char> buffer;
+        size_t buffer_begin = 0;
+        size_t buffer_end = 0;
+    };
+
+    // client reading byte ranges of the objects of an HTTP server (e.g. an S3-compatible object store)
+    // ranges are coalesced and split into requests of at most HTTP_PART_SIZE bytes, which are spread over
+    // num_connections persistent connections with up to pipeline_depth requests in flight on each
+    // copies of a client share its connections
+    class HTTPRangeClient {
+    public:
+        HTTPRangeClient(const std::string& host, int port, int num_connections, int pipeline_depth) : host(host), port(port), connections(std::max(num_connections, 1)), pipeline_depth(std::max(pipeline_depth, 1)) {}
+
+        void fetch(std::vector<HTTPRange> ranges){
+            ranges.erase(std::remove_if(ranges.begin(), ranges.end(), [](const HTTPRange& range){ return range.size == 0; }), ranges.end());
+            std::sort(ranges.begin(), ranges.end(), [](const HTTPRange& a, const HTTPRange& b){
+                return (a.path < b.path) || ((a.path == b.path) && (a.offset < b.offset));
+            });
+            // coalesce the ranges into groups read into the destination of their range if alone, or into a buffer
+            std::vector<RangeGroup> groups;
+            for(int i=0; i<ranges.size(); i++){
+                if(groups.size() && (groups.back().path == ranges[i].path) && (ranges[i].offset <= groups.back().end + HTTP_COALESCE_GAP)){
+                    groups.back().end = std::max(groups.back().end, ranges[i].offset + ranges[i].size);
+                    groups.back().num_ranges ++;
+                }
+                else{
+                    groups.push_back({ranges[i].path, ranges[i].offset, ranges[i].offset + ranges[i].size, i, 1, ranges[i].dest});
+                }
+            }
+            std::vector<Part> parts;
+            for(auto& group:groups){
+                if(group.num_ranges > 1) group.buffer = (uint8_t *) malloc(group.end - group.offset);
+                for(uint64_t offset=group.offset; offset<group.end; offset+=HTTP_PART_SIZE){
+                    parts.push_back({&group.path, offset, (uint32_t) std::min((uint64_t) HTTP_PART_SIZE, group.end - offset), group.buffer + (offset - group.offset)});
+                }
+            }
+            // the connections take the largest parts first, and pipeline no more parts than their share,
+            // so that the parts are balanced over the connections
+            std::stable_sort(parts.begin(), parts.end(), [](const Part& a, const Part& b){ return a.size > b.size; });
+            std::atomic<size_t> next_part(0);
+            int num_threads = std::min(connections.size(), parts.size());
+            size_t depth = std::max<size_t>(1, std::min<size_t>(pipeline_depth, parts.size() / std::max(num_threads, 1)));
+            std::vector<std::thread> threads;
+            for(int t=0; t<num_threads; t++){
+                threads.push_back(std::thread([this, t, depth, &parts, &next_part](){
+                    fetch_parts(connection(t), parts, next_part, depth);
+                }));
+            }
+            for(auto& thread:threads) thread.join();
+            for(const auto& group:groups){
+                if(group.num_ranges == 1) continue;
+                for(int i=group.first_range; i<group.first_range + group.num_ranges; i++){
+                    memcpy(ranges[i].dest, group.buffer + (ranges[i].offset - group.offset), ranges[i].size);
+                }
+                free(group.buffer);
+            }
+        }
+
+        // read a whole object; return a buffer to be freed by the caller
+        uint8_t * get(const std::string& path, uint32_t& size){
+            HTTPConnection& conn = connection(0);
+            for(int num_reconnects=0; ; num_reconnects++){
+                if(conn.send_get(path, 0, 0) && conn.read_header(size)){
+                    uint8_t * data = (uint8_t *) malloc(size);
+                    if(conn.read_body(data, size)){
+                        if(conn.closed_by_server()) conn.reconnect();
+                        return data;
+                    }
+                    free(data);
+                }
+                if(num_reconnects == HTTP_MAX_RECONNECTS){
+                    std::cerr << "Connection closed while receiving HTTP response for " << path << std::endl;
+                    exit(-1);
+                }
+                conn.reconnect();
+            }
+        }
+    private:
+        struct RangeGroup {
+            std::string path;
+            uint64_t offset;
+            uint64_t end;
+            int first_range;
+            int num_ranges;
+            uint8_t * buffer;
+        };
+        struct Part {
+            std::string const * path;
+            uint64_t offset;
+            uint32_t size;
+            uint8_t * dest;
+        };
+        HTTPConnection& connection(int i){
+            if(!connections[i]) connections[i] = std::make_shared<HTTPConnection>(host, port);
+            return *connections[i];
+        }
+        // keep sending the next parts while fewer than depth responses are awaited
+        // if the server closes the connection, reconnect and send the parts not answered yet again
+        void fetch_parts(HTTPConnection& conn, std::vector<Part>& parts, std::atomic<size_t>& next_part, size_t depth) const {
+            std::deque<Part const *> in_flight;
+            size_t num_sent = 0;    // parts in flight sent on the current connection
+            int num_reconnects = 0;
+            while(true){
+                while(in_flight.size() < depth){
+                    size_t i = next_part ++;
+                    if(i >= parts.size()) break;
+                    in_flight.push_back(&parts[i]);
+                }
+                if(in_flight.empty()) break;
+                bool received = true;
+                while(received && (num_sent < in_flight.size())){
+                    received = conn.send_get(*in_flight[num_sent]->path, in_flight[num_sent]->offset, in_flight[num_sent]->size);
+                    if(received) num_sent ++;
+                }
+                Part const * part = in_flight.front();
+                uint32_t size = 0;
+                received = received && conn.read_header(size);
+                if(received && (size != part->size)){
+                    std::cerr << "Unexpected HTTP response size for " << *part->path << std::endl;
+                    exit(-1);
+                }
+                received = received && conn.read_body(part->dest, part->size);
+                if(!received){
+                    if(num_reconnects ++ == HTTP_MAX_RECONNECTS){
+                        std::cerr << "Connection closed while receiving HTTP response for " << *part->path << std::endl;
+                        exit(-1);
+                    }
+                    conn.reconnect();
+                    num_sent = 0;
+                    continue;
+                }
+                in_flight.pop_front();
+                num_sent --;
+                num_reconnects = 0;
+                if(conn.closed_by_server()){
+                    conn.reconnect();
+                    num_sent = 0;
+                }
+            }
+        }
+        std::string host;
+        int port;
+        std::vector<std::shared_ptr<HTTPConnection>> connections;
+        int pipeline_depth;
+    };
+}
+#endif
@@ -0,0 +1,59 @@
+#ifndef _MDR_HTTP_RANGE_RETRIEVER_HPP
+#define _MDR_HTTP_RANGE_RETRIEVER_HPP
+
+#include "RetrieverInterface.hpp"
+#include "RetrieverUtils.hpp"
+#include "HTTPRangeClient.hpp"
+
+namespace MDR {
+    // Data retriever for the level objects written by ConcatLevelFileWriter and served over HTTP (e.g. from an S3-compatible store)
+    // the new bitplanes of all levels are read with range requests in one batch (see HTTPRangeClient)
+    class HTTPRangeRetriever : public concepts::RetrieverInterface {
+    public:
+        HTTPRangeRetriever(const std::string& host, int port, const std::string& metadata_path, const std::vector<std::string>& level_paths, int num_connections = 4, int pipeline_depth = 4) : client(host, port, num_connections, pipeline_depth), metadata_path(metadata_path), level_paths(level_paths) {
+            offsets = std::vector<uint32_t>(level_paths.size(), 0);
+        }
+
+        std::vector<std::vector<const uint8_t*>> retrieve_level_components(const std::vector<std::vector<uint32_t>>& level_sizes, const std::vector<uint32_t>& retrieve_sizes, const std::vector<uint8_t>& prev_level_num_bitplanes, const std::vector<uint8_t>& level_num_bitplanes){
+            release();
+            uint32_t total_retrieve_size = 0;
+            std::vector<HTTPRange> ranges;
+            for(int i=0; i<retrieve_sizes.size(); i++){
+                std::cout << "Retrieve " << +level_num_bitplanes[i] << " (" << +(level_num_bitplanes[i] - prev_level_num_bitplanes[i]) << " more) bitplanes from level " << i << std::endl;
+                uint8_t * buffer = (uint8_t *) malloc(retrieve_sizes[i]);
+                ranges.push_back({level_paths[i], offsets[i], retrieve_sizes[i], buffer});
+                concated_level_components.push_back(buffer);
+                offsets[i] += retrieve_sizes[i];
+                total_retrieve_size += offsets[i];
+            }
+            client.fetch(ranges);
+            std::cout << "Total retrieve size = " << total_retrieve_size << std::endl;
+            return interleave_level_components(concated_level_components, level_sizes, prev_level_num_bitplanes, level_num_bitplanes);
+        }
+
+        uint8_t * load_metadata() const {
+            uint32_t size = 0;
+            return client.get(metadata_path, size);
+        }
+
+        void release(){
+            for(int i=0; i<concated_level_components.size(); i++){
+                free(concated_level_components[i]);
+            }
+            concated_level_components.clear();
+        }
+
+        ~HTTPRangeRetriever(){}
+
+        void print() const {
+            std::cout << "HTTP range retriever." << std::endl;
+        }
+    private:
+        mutable HTTPRangeClient client;
+        std::string metadata_path;
+        std::vector<std::string> level_paths;
+        std::vector<uint32_t> offsets;
+        std::vector<uint8_t*> concated_level_components;
+    };
+}
+#endif
@@ -2,5 +2,7 @@
 #define _MDR_RETRIEVER_HPP
 
 #include "FileRetriever.hpp"
+#include "HPSSFileRetriever.hpp"
+#include "TieredFileRetriever.hpp"
 
 #endif
@@ -0,0 +1,54 @@
+#ifndef _MDR_RETRIEVER_UTILS_HPP
+#define _MDR_RETRIEVER_UTILS_HPP
+
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace MDR {
+
+    // utility functions shared by the retrievers
+
+    // read a whole metadata file
+    /*
+        @params metadata_file: path of the metadata file
+        @params num_bytes: [out] size of the metadata
+    */
+    uint8_t * load_metadata_file(const std::string& metadata_file, uint32_t& num_bytes){
+        FILE * file = fopen(metadata_file.c_str(), "r");
+        if(!file){
+            std::cerr << "Cannot open " << metadata_file << std::endl;
+            exit(-1);
+        }
+        fseek(file, 0, SEEK_END);
+        num_bytes = ftell(file);
+        rewind(file);
+        uint8_t * metadata = (uint8_t *) malloc(num_bytes);
+        fread(metadata, 1, num_bytes, file);
+        fclose(file);
+        return metadata;
+    }
+
+    // locate the retrieved bitplanes of each level
+    /*
+        @params concated_level_components: retrieved bytes of each level, where the bitplanes
+            from prev_level_num_bitplanes[i] to level_num_bitplanes[i] are concatenated
+        @params level_sizes: sizes of the bitplanes of each level
+    */
+    std::vector<std::vector<const uint8_t*>> interleave_level_components(const std::vector<uint8_t*>& concated_level_components, const std::vector<std::vector<uint32_t>>& level_sizes, const std::vector<uint8_t>& prev_level_num_bitplanes, const std::vector<uint8_t>& level_num_bitplanes){
+        std::vector<std::vector<const uint8_t*>> level_components;
+        for(int i=0; i<level_num_bitplanes.size(); i++){
+            const uint8_t * pos = concated_level_components[i];
+            std::vector<const uint8_t*> interleaved_level;
+            for(int j=prev_level_num_bitplanes[i]; j<level_num_bitplanes[i]; j++){
+                interleaved_level.push_back(pos);
+                pos += level_sizes[i][j];
+            }
+            level_components.push_back(interleaved_level);
+        }
+        return level_components;
+    }
+}
+#endif
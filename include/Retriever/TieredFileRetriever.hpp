@@ -0,0 +1,103 @@
+#ifndef _MDR_TIERED_FILE_RETRIEVER_HPP
+#define _MDR_TIERED_FILE_RETRIEVER_HPP
+
+#include "RetrieverInterface.hpp"
+#include "RetrieverUtils.hpp"
+#include <cstdio>
+
+namespace MDR {
+    // Data retriever for the files written by TieredFileWriter
+    // the bitplanes of a level are read from the fast tier file as long as they are there, and from the slow tier file after
+    class TieredFileRetriever : public concepts::RetrieverInterface {
+    public:
+        TieredFileRetriever(const std::string& metadata_file, const std::vector<std::string>& fast_level_files, const std::vector<std::string>& slow_level_files) : metadata_file(metadata_file), fast_level_files(fast_level_files), slow_level_files(slow_level_files) {
+            offsets = std::vector<uint32_t>(fast_level_files.size(), 0);
+        }
+
+        std::vector<std::vector<const uint8_t*>> retrieve_level_components(const std::vector<std::vector<uint32_t>>& level_sizes, const std::vector<uint32_t>& retrieve_sizes, const std::vector<uint8_t>& prev_level_num_bitplanes, const std::vector<uint8_t>& level_num_bitplanes){
+            assert(offsets.size() == retrieve_sizes.size());
+            release();
+            if(level_num_fast_bitplanes.empty()) load_tier_table();
+            uint32_t total_retrieve_size = 0;
+            for(int i=0; i<fast_level_files.size(); i++){
+                std::cout << "Retrieve " << +level_num_bitplanes[i] << " (" << +(level_num_bitplanes[i] - prev_level_num_bitplanes[i]) << " more) bitplanes from level " << i << std::endl;
+                uint32_t fast_level_size = 0;
+                for(int j=0; j<level_num_fast_bitplanes[i]; j++) fast_level_size += level_sizes[i][j];
+                uint8_t * buffer = (uint8_t *) malloc(retrieve_sizes[i]);
+                uint32_t fast_size = (offsets[i] < fast_level_size) ? std::min(retrieve_sizes[i], fast_level_size - offsets[i]) : 0;
+                uint32_t slow_size = retrieve_sizes[i] - fast_size;
+                if(fast_size) read_file(fast_level_files[i], offsets[i], fast_size, buffer);
+                if(slow_size) read_file(slow_level_files[i], offsets[i] + fast_size - fast_level_size, slow_size, buffer + fast_size);
+                concated_level_components.push_back(buffer);
+                fast_tier_size += fast_size;
+                slow_tier_size += slow_size;
+                offsets[i] += retrieve_sizes[i];
+                total_retrieve_size += offsets[i];
+            }
+            std::cout << "Total retrieve size = " << total_retrieve_size << " (fast tier: " << fast_tier_size << ", slow tier: " << slow_tier_size << ")" << std::endl;
+            return interleave_level_components(concated_level_components, level_sizes, prev_level_num_bitplanes, level_num_bitplanes);
+        }
+
+        uint8_t * load_metadata() const {
+            uint32_t num_bytes = 0;
+            return load_metadata_file(metadata_file, num_bytes);
+        }
+
+        void release(){
+            for(int i=0; i<concated_level_components.size(); i++){
+                free(concated_level_components[i]);
+            }
+            concated_level_components.clear();
+        }
+
+        // bytes read from each tier so far
+        uint64_t get_fast_tier_size() const {
+            return fast_tier_size;
+        }
+        uint64_t get_slow_tier_size() const {
+            return slow_tier_size;
+        }
+
+        ~TieredFileRetriever(){}
+
+        void print() const {
+            std::cout << "Tiered file retriever." << std::endl;
+        }
+    private:
+        void read_file(const std::string& filename, uint32_t offset, uint32_t size, uint8_t * dest) const {
+            FILE * file = fopen(filename.c_str(), "r");
+            if(!file || fseek(file, offset, SEEK_SET) || (fread(dest, 1, size, file) != size)){
+                std::cerr << "Errors in reading " << filename << std::endl;
+                exit(-1);
+            }
+            fclose(file);
+        }
+        // placement appended to the metadata by TieredFileWriter
+        void load_tier_table(){
+            uint32_t num_bytes = 0;
+            uint8_t * metadata = load_metadata_file(metadata_file, num_bytes);
+            uint32_t tier_table_size = 0;
+            memcpy(&tier_table_size, metadata + num_bytes - sizeof(uint32_t), sizeof(uint32_t));
+            uint8_t const * tier_table = metadata + num_bytes - sizeof(uint32_t) - tier_table_size;
+            uint32_t num_levels = 0;
+            memcpy(&num_levels, tier_table, sizeof(uint32_t));
+            tier_table += sizeof(uint32_t);
+            level_num_fast_bitplanes = std::vector<uint8_t>(tier_table, tier_table + num_levels);
+            free(metadata);
+            if(level_num_fast_bitplanes.size() != fast_level_files.size()){
+                std::cerr << "The metadata has " << level_num_fast_bitplanes.size() << " tiered levels, but " << fast_level_files.size() << " level files are given" << std::endl;
+                exit(-1);
+            }
+        }
+
+        std::string metadata_file;
+        std::vector<std::string> fast_level_files;
+        std::vector<std::string> slow_level_files;
+        std::vector<uint32_t> offsets;
+        std::vector<uint8_t*> concated_level_components;
+        std::vector<uint8_t> level_num_fast_bitplanes;
+        uint64_t fast_tier_size = 0;
+        uint64_t slow_tier_size = 0;
+    };
+}
+#endif
@@ -0,0 +1,48 @@
+#ifndef _MDR_EMBEDDED_SIZE_INTERPRETER_HPP
+#define _MDR_EMBEDDED_SIZE_INTERPRETER_HPP
+
+#include "SizeInterpreterInterface.hpp"
+
+namespace MDR {
+    // size interpreter for embedded streams (e.g. SPECKEncoder), stored as a single level of segments
+    // level_errors[i][j] is the estimated error after the first j segments, already weighted by the
+    // error estimator at refactor time, so the shortest prefix meeting the request is taken
+    class EmbeddedSizeInterpreter : public concepts::SizeInterpreterInterface {
+    public:
+        EmbeddedSizeInterpreter(){}
+        std::vector<uint32_t> interpret_retrieve_size(const std::vector<std::vector<uint32_t>>& level_sizes, const std::vector<std::vector<double>>& level_errors, double tolerance, std::vector<uint8_t>& index) const {
+            const int num_levels = level_sizes.size();
+            std::vector<uint32_t> retrieve_sizes(num_levels, 0);
+            double estimated_error = 0;
+            for(int i=0; i<num_levels; i++){
+                while((index[i] < level_sizes[i].size()) && (level_errors[i][index[i]] > tolerance)){
+                    retrieve_sizes[i] += level_sizes[i][index[i]];
+                    index[i] ++;
+                }
+                estimated_error += level_errors[i][index[i]];
+            }
+            std::cout << "Requested tolerance = " << tolerance << ", estimated error = " << estimated_error << std::endl;
+            return retrieve_sizes;
+        }
+        std::vector<uint32_t> interpret_retrieve_size_with_budget(const std::vector<std::vector<uint32_t>>& level_sizes, const std::vector<std::vector<double>>& level_errors, uint64_t budget, std::vector<uint8_t>& index, double& estimated_error) const {
+            const int num_levels = level_sizes.size();
+            std::vector<uint32_t> retrieve_sizes(num_levels, 0);
+            uint64_t accumulated_size = 0;
+            estimated_error = 0;
+            for(int i=0; i<num_levels; i++){
+                while((index[i] < level_sizes[i].size()) && (accumulated_size + level_sizes[i][index[i]] <= budget)){
+                    accumulated_size += level_sizes[i][index[i]];
+                    retrieve_sizes[i] += level_sizes[i][index[i]];
+                    index[i] ++;
+                }
+                estimated_error += level_errors[i][index[i]];
+            }
+            std::cout << "Requested budget = " << budget << " bytes, retrieved " << accumulated_size << " bytes, estimated error = " << estimated_error << std::endl;
+            return retrieve_sizes;
+        }
+        void print() const {
+            std::cout << "Embedded size interpreter." << std::endl;
+        }
+    };
+}
+#endif
@@ -18,6 +18,67 @@ namespace MDR {
             return u1.unit_error_gain < u2.unit_error_gain;
         }
     };
+    // greedy bit-plane retrieval under a byte budget
+    // bitplanes are taken in the order of unit error gain and skipped once they do not fit in the remaining budget
+    /*
+        @params consecutive: whether consecutive bitplanes are taken together if that is more efficient (e.g. negabinary)
+        @params num_refined_levels: only the first num_refined_levels levels are refined
+        @params fetched_size: bytes of the budget already taken by the caller
+    */
+    template<class ErrorEstimator>
+    std::vector<uint32_t> greedy_retrieve_size_with_budget(const ErrorEstimator& error_estimator, const std::vector<std::vector<uint32_t>>& level_sizes, const std::vector<std::vector<double>>& level_errors, uint64_t budget, std::vector<uint8_t>& index, double& estimated_error, bool consecutive, int num_refined_levels, uint64_t fetched_size){
+        const int num_levels = level_sizes.size();
+        std::vector<uint32_t> retrieve_sizes(num_levels, 0);
+        double accumulated_error = 0;
+        for(int i=0; i<num_levels; i++){
+            accumulated_error += error_estimator.estimate_error(level_errors[i][index[i]], i);
+        }
+        std::priority_queue<ConsecutiveUnitErrorGain, std::vector<ConsecutiveUnitErrorGain>, CompareConsecutiveUnitErrorGain> heap;
+        for(int i=0; i<num_refined_levels; i++){
+            if(index[i] != level_sizes[i].size()){
+                if(consecutive) heap.push(estimated_efficiency(error_estimator, accumulated_error, index[i], i, level_errors[i], level_sizes[i]));
+                else{
+                    double error_gain = error_estimator.estimate_error_gain(accumulated_error, level_errors[i][index[i]], level_errors[i][index[i] + 1], i);
+                    heap.push(ConsecutiveUnitErrorGain(error_gain / level_sizes[i][index[i]], i, 1));
+                }
+            }
+        }
+        uint64_t accumulated_size = fetched_size;
+        while(!heap.empty()){
+            auto unit_error_gain = heap.top();
+            heap.pop();
+            int i = unit_error_gain.level;
+            int j = index[i];
+            int num = unit_error_gain.consecutive_num;
+            uint64_t size = 0;
+            for(int k=0; k<num; k++){
+                size += level_sizes[i][j + k];
+            }
+            if(accumulated_size + size > budget){
+                // retry with a single bitplane, otherwise stop refining this level
+                if(num > 1){
+                    double error_gain = error_estimator.estimate_error_gain(accumulated_error, level_errors[i][j], level_errors[i][j + 1], i);
+                    heap.push(ConsecutiveUnitErrorGain(error_gain / level_sizes[i][j], i, 1));
+                }
+                continue;
+            }
+            accumulated_size += size;
+            retrieve_sizes[i] += size;
+            accumulated_error -= error_estimator.estimate_error(level_errors[i][j], i);
+            accumulated_error += error_estimator.estimate_error(level_errors[i][j + num], i);
+            index[i] += num;
+            if(index[i] != level_sizes[i].size()){
+                if(consecutive) heap.push(estimated_efficiency(error_estimator, accumulated_error, index[i], i, level_errors[i], level_sizes[i]));
+                else{
+                    double error_gain = error_estimator.estimate_error_gain(accumulated_error, level_errors[i][index[i]], level_errors[i][index[i] + 1], i);
+                    heap.push(ConsecutiveUnitErrorGain(error_gain / level_sizes[i][index[i]], i, 1));
+                }
+            }
+        }
+        std::cout << "Requested budget = " << budget << " bytes, retrieved " << accumulated_size << " bytes, estimated error = " << accumulated_error << std::endl;
+        estimated_error = accumulated_error;
+        return retrieve_sizes;
+    }
     // greedy bit-plane retrieval
     template<class ErrorEstimator>
     class GreedyBasedSizeInterpreter : public concepts::SizeInterpreterInterface {
@@ -62,6 +123,9 @@ namespace MDR {
             std::cout << "Requested tolerance = " << tolerance << ", estimated error = " << accumulated_error << std::endl;
             return retrieve_sizes;
         }
+        std::vector<uint32_t> interpret_retrieve_size_with_budget(const std::vector<std::vector<uint32_t>>& level_sizes, const std::vector<std::vector<double>>& level_errors, uint64_t budget, std::vector<uint8_t>& index, double& estimated_error) const {
+            return greedy_retrieve_size_with_budget(error_estimator, level_sizes, level_errors, budget, index, estimated_error, false, level_sizes.size(), 0);
+        }
         void print() const {
             std::cout << "Greedy based size interpreter." << std::endl;
         }
@@ -137,6 +201,28 @@ namespace MDR {
             std::cout << "Requested tolerance = " << tolerance << ", estimated error = " << accumulated_error << std::endl;
             return retrieve_sizes;
         }
+        std::vector<uint32_t> interpret_retrieve_size_with_budget(const std::vector<std::vector<uint32_t>>& level_sizes, const std::vector<std::vector<double>>& level_errors, uint64_t budget, std::vector<uint8_t>& index, double& estimated_error) const {
+            // as with a tolerance, the first component of each level is fetched first in level order,
+            // and only the levels whose first component fits in the budget are refined
+            const int num_levels = level_sizes.size();
+            std::vector<uint32_t> first_sizes(num_levels, 0);
+            uint64_t fetched_size = 0;
+            int num_refined_levels = 0;
+            for(; num_refined_levels<num_levels; num_refined_levels++){
+                int i = num_refined_levels;
+                if((index[i] == 0) && level_sizes[i].size()){
+                    if(fetched_size + level_sizes[i][0] > budget) break;
+                    fetched_size += level_sizes[i][0];
+                    first_sizes[i] = level_sizes[i][0];
+                    index[i] ++;
+                }
+            }
+            auto retrieve_sizes = greedy_retrieve_size_with_budget(error_estimator, level_sizes, level_errors, budget, index, estimated_error, false, num_refined_levels, fetched_size);
+            for(int i=0; i<num_levels; i++){
+                retrieve_sizes[i] += first_sizes[i];
+            }
+            return retrieve_sizes;
+        }
         void print() const {
             std::cout << "Greedy based size interpreter." << std::endl;
         }
@@ -144,17 +230,6 @@ namespace MDR {
         ErrorEstimator error_estimator;
     };
 
-    struct ConsecutiveUnitErrorGain{
-        double unit_error_gain;
-        int level;
-        int consecutive_num;
-        ConsecutiveUnitErrorGain(double u, int l, int n) : unit_error_gain(u), level(l), consecutive_num(n) {}
-    };
-    struct CompareConsecutiveUnitErrorGain{
-        bool operator()(const ConsecutiveUnitErrorGain& u1, const ConsecutiveUnitErrorGain& u2){
-            return u1.unit_error_gain < u2.unit_error_gain;
-        }
-    };
     // greedy bit-plane retrieval for negabinary encoding: allowing for consecutive bitplane that can increase the efficiency
     template<class ErrorEstimator>
     class NegaBinaryGreedyBasedSizeInterpreter : public concepts::SizeInterpreterInterface {
@@ -185,7 +260,7 @@ namespace MDR {
                 // }
                 // push the next one
                 if(index[i] != level_sizes[i].size()){
-                    heap.push(estimated_efficiency(accumulated_error, index[i], i, level_errors[i], level_sizes[i]));
+                    heap.push(estimated_efficiency(error_estimator, accumulated_error, index[i], i, level_errors[i], level_sizes[i]));
                 }
                 // if(min_error < tolerance){
                 //     // the min error of first 0~i levels meets the tolerance
@@ -211,7 +286,7 @@ namespace MDR {
                 }
                 index[i] += num;
                 if(index[i] != level_sizes[i].size()){
-                    heap.push(estimated_efficiency(accumulated_error, index[i], i, level_errors[i], level_sizes[i]));
+                    heap.push(estimated_efficiency(error_estimator, accumulated_error, index[i], i, level_errors[i], level_sizes[i]));
                 }
                 for(int k=0; k<num; k++) std::cout << i;
             }
@@ -219,31 +294,13 @@ namespace MDR {
             std::cout << "Requested tolerance = " << tolerance << ", estimated error = " << accumulated_error << std::endl;
             return retrieve_sizes;
         }
+        std::vector<uint32_t> interpret_retrieve_size_with_budget(const std::vector<std::vector<uint32_t>>& level_sizes, const std::vector<std::vector<double>>& level_errors, uint64_t budget, std::vector<uint8_t>& index, double& estimated_error) const {
+            return greedy_retrieve_size_with_budget(error_estimator, level_sizes, level_errors, budget, index, estimated_error, true, level_sizes.size(), 0);
+        }
         void print() const {
             std::cout << "Greedy based size interpreter for negabinary encoding." << std::endl;
         }
     private:
-        inline ConsecutiveUnitErrorGain estimated_efficiency(double accumulated_error, int index, int level, const std::vector<double>& bitplane_errors, const std::vector<uint32_t>& bitplane_sizes) const {
-            double current_error_gain = error_estimator.estimate_error_gain(accumulated_error, bitplane_errors[index], bitplane_errors[index + 1], level);
-            uint32_t current_size = bitplane_sizes[index];
-            double current_efficiency = current_error_gain / current_size;
-            int consecutive_num = 1;
-            for(int i=2; i<bitplane_sizes.size() - index; i++){
-                double next_error_gain = error_estimator.estimate_error_gain(accumulated_error, bitplane_errors[index], bitplane_errors[index + i], level);             
-                uint32_t next_size = current_size + bitplane_sizes[index + i - 1];
-                double next_efficiency = next_error_gain / next_size;
-                if((current_efficiency > 0) && (current_efficiency > next_efficiency)){
-                    break;
-                }
-                else{
-                    current_error_gain = next_error_gain;
-                    current_efficiency = next_efficiency;
-                    current_size = next_size;
-                    consecutive_num = i;
-                }
-            }
-            return ConsecutiveUnitErrorGain(current_efficiency, level, consecutive_num);
-        }
         ErrorEstimator error_estimator;
     };
 
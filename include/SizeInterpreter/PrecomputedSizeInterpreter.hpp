@@ -0,0 +1,81 @@
+#ifndef _MDR_PRECOMPUTED_SIZE_INTERPRETER_HPP
+#define _MDR_PRECOMPUTED_SIZE_INTERPRETER_HPP
+
+#include "SizeInterpreterInterface.hpp"
+#include "RetrievalPlan.hpp"
+
+namespace MDR {
+    // size interpreter using the retrieval plan precomputed during refactoring
+    // a tolerance query is answered by a binary search over the plan
+    class PrecomputedSizeInterpreter : public concepts::SizeInterpreterInterface {
+    public:
+        PrecomputedSizeInterpreter(int plan_id=0) : plan_id(plan_id) {}
+        std::vector<uint32_t> interpret_retrieve_size(const std::vector<std::vector<uint32_t>>& level_sizes, const std::vector<std::vector<double>>& level_errors, double tolerance, std::vector<uint8_t>& index) const {
+            assert(plan.num_steps());
+            const int num_levels = level_sizes.size();
+            std::vector<uint32_t> retrieve_sizes(num_levels, 0);
+            uint32_t step = plan.find_step(tolerance);
+            const std::vector<uint8_t>& level_num_bitplanes = plan.level_num_bitplanes[step];
+            for(int i=0; i<num_levels; i++){
+                for(int j=index[i]; j<level_num_bitplanes[i]; j++){
+                    retrieve_sizes[i] += level_sizes[i][j];
+                }
+                if(level_num_bitplanes[i] > index[i]) index[i] = level_num_bitplanes[i];
+            }
+            std::cout << "Requested tolerance = " << tolerance << ", estimated error = " << plan.errors[step] << std::endl;
+            return retrieve_sizes;
+        }
+        // binary search for the most accurate step whose incremental size fits in the budget
+        std::vector<uint32_t> interpret_retrieve_size_with_budget(const std::vector<std::vector<uint32_t>>& level_sizes, const std::vector<std::vector<double>>& level_errors, uint64_t budget, std::vector<uint8_t>& index, double& estimated_error) const {
+            assert(plan.num_steps());
+            const int num_levels = level_sizes.size();
+            uint32_t low = 0;
+            uint32_t high = plan.num_steps() - 1;
+            while(low < high){
+                uint32_t mid = (low + high + 1) / 2;
+                if(incremental_size(level_sizes, mid, index) <= budget) low = mid;
+                else high = mid - 1;
+            }
+            std::vector<uint32_t> retrieve_sizes(num_levels, 0);
+            const std::vector<uint8_t>& level_num_bitplanes = plan.level_num_bitplanes[low];
+            for(int i=0; i<num_levels; i++){
+                for(int j=index[i]; j<level_num_bitplanes[i]; j++){
+                    retrieve_sizes[i] += level_sizes[i][j];
+                }
+                if(level_num_bitplanes[i] > index[i]) index[i] = level_num_bitplanes[i];
+            }
+            estimated_error = plan.errors[low];
+            std::cout << "Requested budget = " << budget << " bytes, estimated error = " << estimated_error << std::endl;
+            return retrieve_sizes;
+        }
+        void load_retrieval_plans(const std::vector<RetrievalPlan>& plans){
+            if(plan_id >= plans.size()){
+                std::cerr << "Retrieval plan " << plan_id << " is not stored in metadata." << std::endl;
+                exit(-1);
+            }
+            plan = plans[plan_id];
+        }
+        // total size to retrieve from scratch for the requested tolerance
+        uint64_t query_retrieve_size(double tolerance) const {
+            return plan.sizes[plan.find_step(tolerance)];
+        }
+        void print() const {
+            std::cout << "Precomputed size interpreter (plan " << plan_id << ")." << std::endl;
+        }
+    private:
+        // size to retrieve for a plan step given the bitplanes already retrieved
+        uint64_t incremental_size(const std::vector<std::vector<uint32_t>>& level_sizes, uint32_t step, const std::vector<uint8_t>& index) const {
+            uint64_t size = 0;
+            const std::vector<uint8_t>& level_num_bitplanes = plan.level_num_bitplanes[step];
+            for(int i=0; i<level_sizes.size(); i++){
+                for(int j=index[i]; j<level_num_bitplanes[i]; j++){
+                    size += level_sizes[i][j];
+                }
+            }
+            return size;
+        }
+        int plan_id = 0;
+        RetrievalPlan plan;
+    };
+}
+#endif
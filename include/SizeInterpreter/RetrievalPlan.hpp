@@ -0,0 +1,154 @@
+#ifndef _MDR_RETRIEVAL_PLAN_HPP
+#define _MDR_RETRIEVAL_PLAN_HPP
+
+#include <vector>
+#include <queue>
+#include <cstring>
+#include "RefactorUtils.hpp"
+
+namespace MDR {
+    // precomputed retrieval plan: Pareto frontier of (estimated error, cumulative size, level bitplanes)
+    // step 0 retrieves nothing, and each following step appends bitplanes in greedy error-gain order
+    struct RetrievalPlan {
+        std::vector<double> errors;
+        std::vector<uint64_t> sizes;
+        std::vector<std::vector<uint8_t>> level_num_bitplanes;
+
+        uint32_t num_steps() const {
+            return errors.size();
+        }
+        // first step whose estimated error is below tolerance (errors are strictly decreasing)
+        // the last step is returned if the tolerance cannot be met
+        uint32_t find_step(double tolerance) const {
+            assert(errors.size());
+            uint32_t low = 0;
+            uint32_t high = errors.size() - 1;
+            while(low < high){
+                uint32_t mid = (low + high) / 2;
+                if(errors[mid] < tolerance) high = mid;
+                else low = mid + 1;
+            }
+            return low;
+        }
+    };
+
+    struct ConsecutiveUnitErrorGain{
+        double unit_error_gain;
+        int level;
+        int consecutive_num;
+        ConsecutiveUnitErrorGain(double u, int l, int n) : unit_error_gain(u), level(l), consecutive_num(n) {}
+    };
+    struct CompareConsecutiveUnitErrorGain{
+        bool operator()(const ConsecutiveUnitErrorGain& u1, const ConsecutiveUnitErrorGain& u2){
+            return u1.unit_error_gain < u2.unit_error_gain;
+        }
+    };
+
+    // efficiency of fetching consecutive bitplanes, which are taken together if that is more efficient (e.g. negabinary)
+    template<class ErrorEstimator>
+    inline ConsecutiveUnitErrorGain estimated_efficiency(const ErrorEstimator& error_estimator, double accumulated_error, int index, int level, const std::vector<double>& bitplane_errors, const std::vector<uint32_t>& bitplane_sizes){
+        double current_error_gain = error_estimator.estimate_error_gain(accumulated_error, bitplane_errors[index], bitplane_errors[index + 1], level);
+        uint32_t current_size = bitplane_sizes[index];
+        double current_efficiency = current_error_gain / current_size;
+        int consecutive_num = 1;
+        for(int i=2; i<bitplane_sizes.size() - index; i++){
+            double next_error_gain = error_estimator.estimate_error_gain(accumulated_error, bitplane_errors[index], bitplane_errors[index + i], level);             
+            uint32_t next_size = current_size + bitplane_sizes[index + i - 1];
+            double next_efficiency = next_error_gain / next_size;
+            if((current_efficiency > 0) && (current_efficiency > next_efficiency)){
+                break;
+            }
+            else{
+                current_error_gain = next_error_gain;
+                current_efficiency = next_efficiency;
+                current_size = next_size;
+                consecutive_num = i;
+            }
+        }
+        return ConsecutiveUnitErrorGain(current_efficiency, level, consecutive_num);
+    }
+
+    // generate the retrieval plan with the greedy strategy used by the size interpreters
+    /*
+        @params level_sizes: bitplane sizes for all levels
+        @params level_errors: level errors (num_bitplanes + 1 entries per level) that match the estimator
+        @params estimator: error estimator used at retrieval
+    */
+    template<class ErrorEstimator>
+    RetrievalPlan generate_retrieval_plan(const std::vector<std::vector<uint32_t>>& level_sizes, const std::vector<std::vector<double>>& level_errors, const ErrorEstimator& estimator){
+        const int num_levels = level_sizes.size();
+        RetrievalPlan plan;
+        std::vector<uint8_t> index(num_levels, 0);
+        double accumulated_error = 0;
+        for(int i=0; i<num_levels; i++){
+            accumulated_error += estimator.estimate_error(level_errors[i][0], i);
+        }
+        uint64_t accumulated_size = 0;
+        plan.errors.push_back(accumulated_error);
+        plan.sizes.push_back(accumulated_size);
+        plan.level_num_bitplanes.push_back(index);
+
+        std::priority_queue<ConsecutiveUnitErrorGain, std::vector<ConsecutiveUnitErrorGain>, CompareConsecutiveUnitErrorGain> heap;
+        for(int i=0; i<num_levels; i++){
+            if(level_sizes[i].size()){
+                heap.push(estimated_efficiency(estimator, accumulated_error, 0, i, level_errors[i], level_sizes[i]));
+            }
+        }
+        while(!heap.empty()){
+            auto unit_error_gain = heap.top();
+            heap.pop();
+            int i = unit_error_gain.level;
+            int j = index[i];
+            int num = unit_error_gain.consecutive_num;
+            for(int k=0; k<num; k++){
+                accumulated_size += level_sizes[i][j + k];
+            }
+            accumulated_error -= estimator.estimate_error(level_errors[i][j], i);
+            accumulated_error += estimator.estimate_error(level_errors[i][j + num], i);
+            index[i] += num;
+            if(index[i] != level_sizes[i].size()){
+                heap.push(estimated_efficiency(estimator, accumulated_error, index[i], i, level_errors[i], level_sizes[i]));
+            }
+            // only record steps on the Pareto frontier
+            // bitplanes of skipped steps are carried by the next recorded step
+            if(accumulated_error < plan.errors.back()){
+                plan.errors.push_back(accumulated_error);
+                plan.sizes.push_back(accumulated_size);
+                plan.level_num_bitplanes.push_back(index);
+            }
+        }
+        return plan;
+    }
+
+    // Serialize/deserialize retrieval plan
+    inline uint32_t get_size(const RetrievalPlan& plan){
+        uint8_t num_levels = plan.level_num_bitplanes.size() ? plan.level_num_bitplanes[0].size() : 0;
+        return sizeof(uint32_t) + sizeof(uint8_t) + get_size(plan.errors) + get_size(plan.sizes) + plan.num_steps() * num_levels * sizeof(uint8_t);
+    }
+    inline void serialize(const RetrievalPlan& plan, uint8_t *& buffer_pos){
+        uint32_t num_steps = plan.num_steps();
+        uint8_t num_levels = num_steps ? plan.level_num_bitplanes[0].size() : 0;
+        *reinterpret_cast<uint32_t*>(buffer_pos) = num_steps;
+        buffer_pos += sizeof(uint32_t);
+        *(buffer_pos ++) = num_levels;
+        serialize(plan.errors, buffer_pos);
+        serialize(plan.sizes, buffer_pos);
+        for(int i=0; i<num_steps; i++){
+            serialize(plan.level_num_bitplanes[i], buffer_pos);
+        }
+    }
+    inline void deserialize(uint8_t const *& buffer_pos, RetrievalPlan& plan){
+        uint32_t num_steps = *reinterpret_cast<const uint32_t*>(buffer_pos);
+        buffer_pos += sizeof(uint32_t);
+        uint8_t num_levels = *(buffer_pos ++);
+        deserialize(buffer_pos, num_steps, plan.errors);
+        deserialize(buffer_pos, num_steps, plan.sizes);
+        plan.level_num_bitplanes.clear();
+        for(int i=0; i<num_steps; i++){
+            std::vector<uint8_t> level_num_bitplanes;
+            deserialize(buffer_pos, num_levels, level_num_bitplanes);
+            plan.level_num_bitplanes.push_back(level_num_bitplanes);
+        }
+    }
+}
+#endif
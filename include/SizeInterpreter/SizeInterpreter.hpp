@@ -3,5 +3,7 @@
 
 #include "BasicSizeInterpreter.hpp"
 #include "GreedyBasedSizeInterpreter.hpp"
+#include "PrecomputedSizeInterpreter.hpp"
+#include "EmbeddedSizeInterpreter.hpp"
 
 #endif
@@ -1,6 +1,8 @@
 #ifndef _MDR_SIZE_INTERPRETER_INTERFACE_HPP
 #define _MDR_SIZE_INTERPRETER_INTERFACE_HPP
 
+#include "RetrievalPlan.hpp"
+
 namespace MDR {
     namespace concepts {
 
@@ -12,6 +14,15 @@ namespace MDR {
 
             virtual std::vector<uint32_t> interpret_retrieve_size(const std::vector<std::vector<uint32_t>>& level_sizes, const std::vector<std::vector<double>>& level_errors, double tolerance, std::vector<uint8_t>& index) const = 0;
 
+            // choose bitplanes that minimize the estimated error within a byte budget, and report the estimated error
+            virtual std::vector<uint32_t> interpret_retrieve_size_with_budget(const std::vector<std::vector<uint32_t>>& level_sizes, const std::vector<std::vector<double>>& level_errors, uint64_t budget, std::vector<uint8_t>& index, double& estimated_error) const {
+                std::cerr << "Byte budget retrieval is not supported by this size interpreter." << std::endl;
+                exit(-1);
+            }
+
+            // receive the retrieval plans stored in metadata; ignored by interpreters that plan on the fly
+            virtual void load_retrieval_plans(const std::vector<RetrievalPlan>& plans) {}
+
             virtual void print() const = 0;
         };
     }
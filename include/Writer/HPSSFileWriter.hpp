@@ -7,43 +7,57 @@
 namespace MDR {
     // A writer that writes the concatenated level components
     // Merge multiple components if size is small
+    // the components of level i are aggregated into files level_files[i]_<count> of at least min_size bytes,
+    // and the chunk boundaries are appended to the metadata for HPSSFileRetriever
     class HPSSFileWriter : public concepts::WriterInterface {
     public:
         HPSSFileWriter(const std::string& metadata_file, const std::vector<std::string>& level_files, int num_process, int min_HPSS_size) : metadata_file(metadata_file), level_files(level_files), min_size((min_HPSS_size - 1)/num_process + 1) {}
 
         std::vector<uint32_t> write_level_components(const std::vector<std::vector<uint8_t*>>& level_components, const std::vector<std::vector<uint32_t>>& level_sizes) const {
             std::vector<uint32_t> level_num;
+            chunk_ends.clear();
             for(int i=0; i<level_components.size(); i++){
+                chunk_ends.push_back(std::vector<uint32_t>());
                 uint32_t concated_level_size = 0;
-                uint32_t prev_index = 0;
-                uint32_t count = 0;
+                uint32_t first_index = 0;
                 for(int j=0; j<level_components[i].size(); j++){
                     concated_level_size += level_sizes[i][j];
                     if((concated_level_size >= min_size) || (j == level_components[i].size() - 1)){
                         // TODO: deal with the last file that may not be larger than min_size
                         uint8_t * concated_level_data = (uint8_t *) malloc(concated_level_size);
                         uint8_t * concated_level_data_pos = concated_level_data;
-                        std::cout << +prev_index << " " << j << " " << concated_level_size << std::endl;
-                        for(int k=prev_index + 1; k<=j; k++){
+                        for(int k=first_index; k<=j; k++){
                             memcpy(concated_level_data_pos, level_components[i][k], level_sizes[i][k]);
                             concated_level_data_pos += level_sizes[i][k];
                         }
-                        FILE * file = fopen((level_files[i] + "_" + std::to_string(count)).c_str(), "w");
+                        FILE * file = fopen((level_files[i] + "_" + std::to_string(chunk_ends[i].size())).c_str(), "w");
                         fwrite(concated_level_data, 1, concated_level_size, file);
                         fclose(file);
                         free(concated_level_data);
-                        count ++;
+                        chunk_ends[i].push_back(j + 1);
                         concated_level_size = 0;
-                        prev_index = j;
+                        first_index = j + 1;
                     }
                 }
+                level_num.push_back(chunk_ends[i].size());
             }
             return level_num;
         }
 
+        // chunk table appended to the metadata: for each level, the number of chunks and the (exclusive) last bitplane of each,
+        // followed by the size of the table
         void write_metadata(uint8_t const * metadata, uint32_t size) const {
+            std::vector<uint32_t> chunk_table;
+            chunk_table.push_back(chunk_ends.size());
+            for(const auto& ends:chunk_ends){
+                chunk_table.push_back(ends.size());
+                chunk_table.insert(chunk_table.end(), ends.begin(), ends.end());
+            }
+            uint32_t chunk_table_size = chunk_table.size() * sizeof(uint32_t);
             FILE * file = fopen(metadata_file.c_str(), "w");
             fwrite(metadata, 1, size, file);
+            fwrite(chunk_table.data(), 1, chunk_table_size, file);
+            fwrite(&chunk_table_size, sizeof(uint32_t), 1, file);
             fclose(file);
         }
 
@@ -56,6 +70,7 @@ namespace MDR {
         uint32_t min_size = 0;
         std::vector<std::string> level_files;
         std::string metadata_file;
+        mutable std::vector<std::vector<uint32_t>> chunk_ends;
     };
 }
 #endif
@@ -0,0 +1,100 @@
+#ifndef _MDR_TIERED_FILE_WRITER_HPP
+#define _MDR_TIERED_FILE_WRITER_HPP
+
+#include "WriterInterface.hpp"
+#include <cstdio>
+
+namespace MDR {
+    // A writer that splits the concatenated level components over a fast tier (e.g. NVMe) and a capacity tier
+    // the leading bitplanes of each level go to fast_level_files[i] and the others to slow_level_files[i]
+    // with a retrieval plan, the fast tier holds the bitplanes of the last plan step within fast_capacity bytes,
+    // so that it serves the most valuable bitplanes in error-gain order; otherwise it is filled bitplane by bitplane across levels
+    // the number of fast bitplanes of each level is appended to the metadata for TieredFileRetriever
+    class TieredFileWriter : public concepts::WriterInterface {
+    public:
+        TieredFileWriter(const std::string& metadata_file, const std::vector<std::string>& fast_level_files, const std::vector<std::string>& slow_level_files, uint64_t fast_capacity) : metadata_file(metadata_file), fast_level_files(fast_level_files), slow_level_files(slow_level_files), fast_capacity(fast_capacity) {}
+
+        void set_retrieval_plans(const std::vector<RetrievalPlan>& plans){
+            retrieval_plans = plans;
+        }
+
+        std::vector<uint32_t> write_level_components(const std::vector<std::vector<uint8_t*>>& level_components, const std::vector<std::vector<uint32_t>>& level_sizes) const {
+            std::vector<uint32_t> level_num;
+            level_num_fast_bitplanes = place_bitplanes(level_sizes);
+            for(int i=0; i<level_components.size(); i++){
+                uint8_t num_fast_bitplanes = level_num_fast_bitplanes[i];
+                level_num.push_back(0);
+                if(num_fast_bitplanes > 0){
+                    write_file(fast_level_files[i], level_components[i], level_sizes[i], 0, num_fast_bitplanes);
+                    level_num.back() ++;
+                }
+                if(num_fast_bitplanes < level_components[i].size()){
+                    write_file(slow_level_files[i], level_components[i], level_sizes[i], num_fast_bitplanes, level_components[i].size());
+                    level_num.back() ++;
+                }
+            }
+            return level_num;
+        }
+
+        // placement appended to the metadata: the number of levels and the number of fast bitplanes of each level,
+        // followed by the size of the table
+        void write_metadata(uint8_t const * metadata, uint32_t size) const {
+            uint32_t num_levels = level_num_fast_bitplanes.size();
+            uint32_t tier_table_size = sizeof(uint32_t) + num_levels;
+            FILE * file = fopen(metadata_file.c_str(), "w");
+            fwrite(metadata, 1, size, file);
+            fwrite(&num_levels, sizeof(uint32_t), 1, file);
+            fwrite(level_num_fast_bitplanes.data(), 1, num_levels, file);
+            fwrite(&tier_table_size, sizeof(uint32_t), 1, file);
+            fclose(file);
+        }
+
+        ~TieredFileWriter(){}
+
+        void print() const {
+            std::cout << "Tiered file writer with " << fast_capacity << " bytes on the fast tier." << std::endl;
+        }
+    private:
+        std::vector<uint8_t> place_bitplanes(const std::vector<std::vector<uint32_t>>& level_sizes) const {
+            const int num_levels = level_sizes.size();
+            if(retrieval_plans.size() && (retrieval_plans[0].level_num_bitplanes.size()) && (retrieval_plans[0].level_num_bitplanes[0].size() == num_levels)){
+                const RetrievalPlan& plan = retrieval_plans[0];
+                uint32_t step = 0;
+                while((step + 1 < plan.num_steps()) && (plan.sizes[step + 1] <= fast_capacity)) step ++;
+                return plan.level_num_bitplanes[step];
+            }
+            std::vector<uint8_t> num_fast_bitplanes(num_levels, 0);
+            uint64_t fast_size = 0;
+            bool fit = true;
+            for(int j=0; fit; j++){
+                fit = false;
+                for(int i=0; i<num_levels; i++){
+                    if((num_fast_bitplanes[i] != j) || (j >= level_sizes[i].size()) || (fast_size + level_sizes[i][j] > fast_capacity)) continue;
+                    fast_size += level_sizes[i][j];
+                    num_fast_bitplanes[i] ++;
+                    fit = true;
+                }
+            }
+            return num_fast_bitplanes;
+        }
+        void write_file(const std::string& filename, const std::vector<uint8_t*>& components, const std::vector<uint32_t>& sizes, int begin, int end) const {
+            FILE * file = fopen(filename.c_str(), "w");
+            if(!file){
+                std::cerr << "Cannot open " << filename << std::endl;
+                exit(-1);
+            }
+            for(int j=begin; j<end; j++){
+                fwrite(components[j], 1, sizes[j], file);
+            }
+            fclose(file);
+        }
+
+        std::string metadata_file;
+        std::vector<std::string> fast_level_files;
+        std::vector<std::string> slow_level_files;
+        uint64_t fast_capacity = 0;
+        std::vector<RetrievalPlan> retrieval_plans;
+        mutable std::vector<uint8_t> level_num_fast_bitplanes;
+    };
+}
+#endif
@@ -3,5 +3,6 @@
 
 #include "FileWriter.hpp"
 #include "HPSSFileWriter.hpp"
+#include "TieredFileWriter.hpp"
 
 #endif
@@ -1,6 +1,8 @@
 #ifndef _MDR_WRITER_INTERFACE_HPP
 #define _MDR_WRITER_INTERFACE_HPP
 
+#include "SizeInterpreter/RetrievalPlan.hpp"
+
 namespace MDR {
     namespace concepts {
 
@@ -14,6 +16,10 @@ namespace MDR {
 
             virtual void write_metadata(uint8_t const * metadata, uint32_t size) const = 0;
 
+            // retrieval plans precomputed by the refactor, given before the level components are written
+            // writers placing the bitplanes by their retrieval order override this
+            virtual void set_retrieval_plans(const std::vector<RetrievalPlan>& plans) {}
+
             virtual void print() const = 0;
         };
     }
@@ -5,8 +5,12 @@
 #include <iomanip>
 #include <cmath>
 #include <bitset>
+#include <limits>
 #include "utils.hpp"
 #include "Decomposer/Decomposer.hpp"
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 using namespace std;
 
@@ -38,6 +42,80 @@ void evaluate(const vector<T>& data, const vector<uint32_t>& dims, int target_le
     cout << "Max error = " << max_err << endl;
 }
 
+// coefficients of a decomposer against a reference (MGARDx), and recomposition of the coefficients of each one by the other
+// differences are relative to the max coefficient and the max value, and should stay at float rounding
+template <class T, class Decomposer, class ReferenceDecomposer>
+void compare(const vector<T>& data, const vector<uint32_t>& dims, int target_level, Decomposer decomposer, ReferenceDecomposer reference){
+    vector<T> coeff(data);
+    vector<T> reference_coeff(data);
+    decomposer.decompose(coeff.data(), dims, target_level);
+    reference.decompose(reference_coeff.data(), dims, target_level);
+    T max_diff = 0;
+    T max_coeff = 0;
+    T max_val = 0;
+    for(int i=0; i<data.size(); i++){
+        max_diff = std::max(max_diff, (T) fabs(coeff[i] - reference_coeff[i]));
+        max_coeff = std::max(max_coeff, (T) fabs(reference_coeff[i]));
+        max_val = std::max(max_val, (T) fabs(data[i]));
+    }
+    decomposer.recompose(reference_coeff.data(), dims, target_level);
+    reference.recompose(coeff.data(), dims, target_level);
+    T max_err = 0;
+    for(int i=0; i<data.size(); i++){
+        max_err = std::max(max_err, (T) fabs(reference_coeff[i] - data[i]));
+        max_err = std::max(max_err, (T) fabs(coeff[i] - data[i]));
+    }
+    const T tolerance = 1024 * std::numeric_limits<T>::epsilon();
+    bool match = (max_diff <= tolerance * max_coeff) && (max_err <= tolerance * max_val);
+    cout << "Level " << target_level << ": coefficient difference to MGARDx = " << max_diff << " (max coefficient = " << max_coeff << "), cross recomposition error = " << max_err << " (max value = " << max_val << "), " << (match ? "match" : "MISMATCH") << endl;
+}
+
+// strong scaling of the native decomposer over the number of threads
+template <class T, class Decomposer>
+void scaling(const vector<T>& data, const vector<uint32_t>& dims, int target_level, Decomposer decomposer){
+#ifdef _OPENMP
+    struct timespec start, end;
+    int err = 0;
+    cout << "Strong scaling of ";
+    decomposer.print();
+    double base_time = 0;
+    const int max_threads = omp_get_max_threads();
+    for(int num_threads=1; ; num_threads *= 2){
+        if(num_threads > max_threads) num_threads = max_threads;
+        omp_set_num_threads(num_threads);
+        vector<T> data_dup(data);
+        err = clock_gettime(CLOCK_REALTIME, &start);
+        decomposer.decompose(data_dup.data(), dims, target_level);
+        decomposer.recompose(data_dup.data(), dims, target_level);
+        err = clock_gettime(CLOCK_REALTIME, &end);
+        double time = (double)(end.tv_sec - start.tv_sec) + (double)(end.tv_nsec - start.tv_nsec)/(double)1000000000;
+        if(num_threads == 1) base_time = time;
+        cout << num_threads << " threads: decompose + recompose time = " << time << "s, speedup = " << base_time / time << endl;
+        if(num_threads == max_threads) break;
+    }
+    omp_set_num_threads(max_threads);
+#else
+    cout << "Built without OpenMP, skip strong scaling" << endl;
+#endif
+}
+
+// repeated decompose + recompose on the same grid (e.g. time steps): the first call builds the plan
+template <class T, class Decomposer>
+void repeat(const vector<T>& data, const vector<uint32_t>& dims, int target_level, int num_steps, Decomposer decomposer){
+    struct timespec start, end;
+    int err = 0;
+    cout << "Repeated calls of ";
+    decomposer.print();
+    vector<T> data_dup(data);
+    for(int i=0; i<num_steps; i++){
+        err = clock_gettime(CLOCK_REALTIME, &start);
+        decomposer.decompose(data_dup.data(), dims, target_level);
+        decomposer.recompose(data_dup.data(), dims, target_level);
+        err = clock_gettime(CLOCK_REALTIME, &end);
+        cout << "Step " << i << ": decompose + recompose time = " << (double)(end.tv_sec - start.tv_sec) + (double)(end.tv_nsec - start.tv_nsec)/(double)1000000000 << "s" << endl;
+    }
+}
+
 template <class T>
 void test(string filename, const vector<uint32_t>& dims){
     size_t num_elements = 0;
@@ -45,7 +123,19 @@ void test(string filename, const vector<uint32_t>& dims){
     for(int target_level=0; target_level<5; target_level += 2){
         evaluate<T>(data, dims, target_level, MDR::MGARDOrthoganalDecomposer<T>());
         evaluate<T>(data, dims, target_level, MDR::MGARDHierarchicalDecomposer<T>());
+        evaluate<T>(data, dims, target_level, MDR::NativeMGARDOrthogonalDecomposer<T>());
+        evaluate<T>(data, dims, target_level, MDR::NativeMGARDHierarchicalDecomposer<T>());
+        evaluate<T>(data, dims, target_level, MDR::InterpolationDecomposer<T>(true));
+        evaluate<T>(data, dims, target_level, MDR::InterpolationDecomposer<T>(false));
+        evaluate<T>(data, dims, target_level, MDR::WaveletDecomposer<T>(MDR::CDF53));
+        evaluate<T>(data, dims, target_level, MDR::WaveletDecomposer<T>(MDR::CDF97));
+        compare<T>(data, dims, target_level, MDR::NativeMGARDOrthogonalDecomposer<T>(), MDR::MGARDOrthoganalDecomposer<T>());
+        compare<T>(data, dims, target_level, MDR::NativeMGARDHierarchicalDecomposer<T>(), MDR::MGARDHierarchicalDecomposer<T>());
     }
+    scaling<T>(data, dims, 4, MDR::NativeMGARDOrthogonalDecomposer<T>());
+    repeat<T>(data, dims, 4, 5, MDR::MGARDOrthoganalDecomposer<T>());
+    repeat<T>(data, dims, 4, 5, MDR::NativeMGARDOrthogonalDecomposer<T>());
+    scaling<T>(data, dims, 4, MDR::WaveletDecomposer<T>(MDR::CDF97));
 }
 
 int main(int argc, char ** argv){
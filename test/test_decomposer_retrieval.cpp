@@ -0,0 +1,89 @@
+#include <iostream>
+#include <ctime>
+#include <cstdlib>
+#include <vector>
+#include <iomanip>
+#include <cmath>
+#include <bitset>
+#include "utils.hpp"
+#include "Refactor/Refactor.hpp"
+#include "Reconstructor/Reconstructor.hpp"
+
+using namespace std;
+
+// refactor with the given decomposer, then report the bytes retrieved for each L2 tolerance
+// tolerances are relative to the value range, on the root mean squared error
+template <class T, class Decomposer, class ErrorEstimator>
+void evaluate(const vector<T>& data, const vector<uint32_t>& dims, int target_level, const vector<double>& tolerance, Decomposer decomposer, ErrorEstimator estimator){
+    struct timespec start, end;
+    int err = 0;
+    string metadata_file = "refactored_data/metadata.bin";
+    vector<string> files;
+    for(int i=0; i<=target_level; i++){
+        files.push_back("refactored_data/level_" + to_string(i) + ".bin");
+    }
+    auto interleaver = MDR::DirectInterleaver<T>();
+    auto encoder = MDR::GroupedBPEncoder<T, uint32_t>();
+    auto compressor = MDR::AdaptiveLevelCompressor(32);
+    cout << "Using ";
+    decomposer.print();
+    {
+        auto refactor = MDR::ComposedRefactor<T, Decomposer, decltype(interleaver), decltype(encoder), decltype(compressor), MDR::SquaredErrorCollector<T>, MDR::ConcatLevelFileWriter>(decomposer, interleaver, encoder, compressor, MDR::SquaredErrorCollector<T>(), MDR::ConcatLevelFileWriter(metadata_file, files));
+        vector<T> data_dup(data);
+        err = clock_gettime(CLOCK_REALTIME, &start);
+        refactor.refactor(data_dup.data(), dims, target_level, 32);
+        err = clock_gettime(CLOCK_REALTIME, &end);
+        double time = (double)(end.tv_sec - start.tv_sec) + (double)(end.tv_nsec - start.tv_nsec)/(double)1000000000;
+        cout << "Refactor time: " << time << "s, throughput = " << data.size() * sizeof(T) / time / 1e6 << " MB/s" << endl;
+    }
+    auto interpreter = MDR::SignExcludeGreedyBasedSizeInterpreter<ErrorEstimator>(estimator);
+    auto reconstructor = MDR::ComposedReconstructor<T, Decomposer, decltype(interleaver), decltype(encoder), decltype(compressor), decltype(interpreter), ErrorEstimator, MDR::ConcatLevelFileRetriever>(decomposer, interleaver, encoder, compressor, interpreter, MDR::ConcatLevelFileRetriever(metadata_file, files));
+    reconstructor.load_metadata();
+    T max_val = data[0];
+    T min_val = data[0];
+    for(const auto& v:data){
+        max_val = std::max(max_val, v);
+        min_val = std::min(min_val, v);
+    }
+    const double value_range = max_val - min_val;
+    for(int i=0; i<tolerance.size(); i++){
+        // squared error estimators bound the sum of squared errors
+        double squared_tolerance = tolerance[i] * value_range * tolerance[i] * value_range * data.size();
+        auto reconstructed_data = reconstructor.progressive_reconstruct(squared_tolerance, -1);
+        cout << "Relative L2 tolerance " << tolerance[i] << ": retrieved " << reconstructor.get_retrieved_size() << " bytes";
+        if(reconstructor.get_current_dimensions() != dims){
+            cout << ", reconstructed at reduced resolution" << endl;
+            continue;
+        }
+        double squared_error = 0;
+        for(int j=0; j<data.size(); j++){
+            squared_error += (data[j] - reconstructed_data[j]) * (data[j] - reconstructed_data[j]);
+        }
+        cout << ", relative L2 error " << sqrt(squared_error / data.size()) / value_range << endl;
+    }
+}
+
+int main(int argc, char ** argv){
+
+    int argv_id = 1;
+    string filename = string(argv[argv_id ++]);
+    int target_level = atoi(argv[argv_id ++]);
+    int num_dims = atoi(argv[argv_id ++]);
+    vector<uint32_t> dims(num_dims, 0);
+    for(int i=0; i<num_dims; i++){
+        dims[i] = atoi(argv[argv_id ++]);
+    }
+    int num_tolerance = atoi(argv[argv_id ++]);
+    vector<double> tolerance(num_tolerance, 0);
+    for(int i=0; i<num_tolerance; i++){
+        tolerance[i] = atof(argv[argv_id ++]);
+    }
+
+    using T = float;
+    size_t num_elements = 0;
+    auto data = MGARD::readfile<T>(filename.c_str(), num_elements);
+    evaluate<T>(data, dims, target_level, tolerance, MDR::MGARDOrthoganalDecomposer<T>(), MDR::SNormErrorEstimator<T>(num_dims, target_level, 0));
+    evaluate<T>(data, dims, target_level, tolerance, MDR::WaveletDecomposer<T>(MDR::CDF53), MDR::L2ErrorEstimator_WT<T>(MDR::WaveletDecomposer<T>(MDR::CDF53).level_weights(num_dims, target_level)));
+    evaluate<T>(data, dims, target_level, tolerance, MDR::WaveletDecomposer<T>(MDR::CDF97), MDR::L2ErrorEstimator_WT<T>(MDR::WaveletDecomposer<T>(MDR::CDF97).level_weights(num_dims, target_level)));
+    return 0;
+}
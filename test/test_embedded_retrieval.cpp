@@ -0,0 +1,129 @@
+#include <iostream>
+#include <ctime>
+#include <cstdlib>
+#include <vector>
+#include <iomanip>
+#include <cmath>
+#include <bitset>
+#include "utils.hpp"
+#include "Refactor/Refactor.hpp"
+#include "Reconstructor/Reconstructor.hpp"
+
+using namespace std;
+
+template <class T>
+void print_statistics(const vector<T>& data, T const * reconstructed_data, double value_range){
+    double squared_error = 0;
+    for(int j=0; j<data.size(); j++){
+        squared_error += (data[j] - reconstructed_data[j]) * (data[j] - reconstructed_data[j]);
+    }
+    cout << ", relative L2 error " << sqrt(squared_error / data.size()) / value_range << endl;
+}
+
+// bytes retrieved for each L2 tolerance with level bitplanes (greedy interpreter) and with the
+// embedded SPECK stream over the whole hierarchy, using the same decomposer and error estimator
+// tolerances are relative to the value range, on the root mean squared error
+template <class T, class Decomposer, class ErrorEstimator>
+void evaluate(const vector<T>& data, const vector<uint32_t>& dims, int target_level, const vector<double>& tolerance, Decomposer decomposer, ErrorEstimator estimator){
+    string metadata_file = "refactored_data/metadata.bin";
+    vector<string> files;
+    for(int i=0; i<=target_level; i++){
+        files.push_back("refactored_data/level_" + to_string(i) + ".bin");
+    }
+    T max_val = data[0];
+    T min_val = data[0];
+    for(const auto& v:data){
+        max_val = std::max(max_val, v);
+        min_val = std::min(min_val, v);
+    }
+    const double value_range = max_val - min_val;
+    cout << "Using ";
+    decomposer.print();
+    {
+        auto interleaver = MDR::DirectInterleaver<T>();
+        auto encoder = MDR::GroupedBPEncoder<T, uint32_t>();
+        auto compressor = MDR::AdaptiveLevelCompressor(32);
+        auto refactor = MDR::ComposedRefactor<T, Decomposer, decltype(interleaver), decltype(encoder), decltype(compressor), MDR::SquaredErrorCollector<T>, MDR::ConcatLevelFileWriter>(decomposer, interleaver, encoder, compressor, MDR::SquaredErrorCollector<T>(), MDR::ConcatLevelFileWriter(metadata_file, files));
+        refactor.refactor(data.data(), dims, target_level, 32);
+        auto interpreter = MDR::SignExcludeGreedyBasedSizeInterpreter<ErrorEstimator>(estimator);
+        auto reconstructor = MDR::ComposedReconstructor<T, Decomposer, decltype(interleaver), decltype(encoder), decltype(compressor), decltype(interpreter), ErrorEstimator, MDR::ConcatLevelFileRetriever>(decomposer, interleaver, encoder, compressor, interpreter, MDR::ConcatLevelFileRetriever(metadata_file, files));
+        reconstructor.load_metadata();
+        for(int i=0; i<tolerance.size(); i++){
+            double squared_tolerance = tolerance[i] * value_range * tolerance[i] * value_range * data.size();
+            auto reconstructed_data = reconstructor.progressive_reconstruct(squared_tolerance, -1);
+            cout << "Bitplanes: relative L2 tolerance " << tolerance[i] << ": retrieved " << reconstructor.get_retrieved_size() << " bytes";
+            if(reconstructor.get_current_dimensions() != dims){
+                cout << ", reconstructed at reduced resolution" << endl;
+                continue;
+            }
+            print_statistics(data, reconstructed_data, value_range);
+        }
+    }
+    {
+        vector<string> embedded_files(1, files[0]);
+        auto encoder = MDR::SPECKEncoder<T>();
+        auto refactor = MDR::EmbeddedRefactor<T, Decomposer, decltype(encoder), ErrorEstimator, MDR::ConcatLevelFileWriter>(decomposer, encoder, estimator, MDR::ConcatLevelFileWriter(metadata_file, embedded_files));
+        refactor.refactor(data.data(), dims, target_level, 32);
+        auto interpreter = MDR::EmbeddedSizeInterpreter();
+        auto reconstructor = MDR::EmbeddedReconstructor<T, Decomposer, decltype(encoder), decltype(interpreter), MDR::ConcatLevelFileRetriever>(decomposer, encoder, interpreter, MDR::ConcatLevelFileRetriever(metadata_file, embedded_files));
+        reconstructor.load_metadata();
+        for(int i=0; i<tolerance.size(); i++){
+            double squared_tolerance = tolerance[i] * value_range * tolerance[i] * value_range * data.size();
+            auto reconstructed_data = reconstructor.progressive_reconstruct(squared_tolerance);
+            cout << "SPECK: relative L2 tolerance " << tolerance[i] << ": retrieved " << reconstructor.get_retrieved_size() << " bytes";
+            print_statistics(data, reconstructed_data, value_range);
+        }
+    }
+}
+
+// embedded streams of tiny all-zero grids are a few bytes, so the first checkpoint may be the end of the stream
+void test_tiny_grids(){
+    using T = float;
+    string metadata_file = "refactored_data/metadata.bin";
+    vector<string> embedded_files(1, "refactored_data/level_0.bin");
+    auto decomposer = MDR::WaveletDecomposer<T>(MDR::CDF97);
+    auto encoder = MDR::SPECKEncoder<T>();
+    for(uint32_t n=4; n<=8; n++){
+        for(int num_bitplanes:{1, 32}){
+            vector<uint32_t> dims = {n, n};
+            vector<T> data(n * n, 0);
+            auto estimator = MDR::L2ErrorEstimator_WT<T>(decomposer.level_weights(dims.size(), 1));
+            auto refactor = MDR::EmbeddedRefactor<T, decltype(decomposer), decltype(encoder), decltype(estimator), MDR::ConcatLevelFileWriter>(decomposer, encoder, estimator, MDR::ConcatLevelFileWriter(metadata_file, embedded_files));
+            refactor.refactor(data.data(), dims, 1, num_bitplanes);
+            auto interpreter = MDR::EmbeddedSizeInterpreter();
+            auto reconstructor = MDR::EmbeddedReconstructor<T, decltype(decomposer), decltype(encoder), decltype(interpreter), MDR::ConcatLevelFileRetriever>(decomposer, encoder, interpreter, MDR::ConcatLevelFileRetriever(metadata_file, embedded_files));
+            reconstructor.load_metadata();
+            auto reconstructed_data = reconstructor.progressive_reconstruct(0);
+            bool match = true;
+            for(int i=0; i<data.size(); i++){
+                match = match && (reconstructed_data[i] == 0);
+            }
+            cout << "SPECK: all-zero " << n << "x" << n << " grid with " << num_bitplanes << " bitplanes: " << (match ? "match" : "MISMATCH") << endl;
+        }
+    }
+}
+
+int main(int argc, char ** argv){
+
+    int argv_id = 1;
+    string filename = string(argv[argv_id ++]);
+    int target_level = atoi(argv[argv_id ++]);
+    int num_dims = atoi(argv[argv_id ++]);
+    vector<uint32_t> dims(num_dims, 0);
+    for(int i=0; i<num_dims; i++){
+        dims[i] = atoi(argv[argv_id ++]);
+    }
+    int num_tolerance = atoi(argv[argv_id ++]);
+    vector<double> tolerance(num_tolerance, 0);
+    for(int i=0; i<num_tolerance; i++){
+        tolerance[i] = atof(argv[argv_id ++]);
+    }
+
+    using T = float;
+    size_t num_elements = 0;
+    auto data = MGARD::readfile<T>(filename.c_str(), num_elements);
+    evaluate<T>(data, dims, target_level, tolerance, MDR::MGARDOrthoganalDecomposer<T>(), MDR::SNormErrorEstimator<T>(num_dims, target_level, 0));
+    evaluate<T>(data, dims, target_level, tolerance, MDR::WaveletDecomposer<T>(MDR::CDF97), MDR::L2ErrorEstimator_WT<T>(MDR::WaveletDecomposer<T>(MDR::CDF97).level_weights(num_dims, target_level)));
+    test_tiny_grids();
+    return 0;
+}
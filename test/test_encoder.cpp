@@ -5,13 +5,15 @@
 #include <iomanip>
 #include <cmath>
 #include <bitset>
+#include <random>
 #include "utils.hpp"
 #include "BitplaneEncoder/BitplaneEncoder.hpp"
 
 using namespace std;
 
+// return the total encoded size
 template <class T, class Encoder>
-void evaluate(const vector<T>& data, size_t num_elements, int level_exp, int num_bitplanes, Encoder encoder){
+uint64_t evaluate(const vector<T>& data, size_t num_elements, int level_exp, int num_bitplanes, Encoder encoder){
     struct timespec start, end;
     int err = 0;
 
@@ -31,12 +33,15 @@ void evaluate(const vector<T>& data, size_t num_elements, int level_exp, int num
     err = clock_gettime(CLOCK_REALTIME, &end);
     cout << "Decoding time: " << (double)(end.tv_sec - start.tv_sec) + (double)(end.tv_nsec - start.tv_nsec)/(double)1000000000 << "s" << endl;
 
+    uint64_t total_size = 0;
     cout << "Encoded sizes: ";
     for(int i=0; i<sizes.size(); i++){
     	cout << sizes[i] << " ";
+        total_size += sizes[i];
         free(streams[i]);
     }
     cout << endl;
+    cout << "Total encoded size = " << total_size << endl;
 
     T max_err = 0;
     for(int i=0; i<num_elements; i++){
@@ -46,6 +51,36 @@ void evaluate(const vector<T>& data, size_t num_elements, int level_exp, int num
     }
     cout << "Max error = " << max_err << endl;
     free(dec_data);
+    return total_size;
+}
+
+// encoded sizes on a sparse level, as the finest levels of smooth data: most coefficients are 0
+// and the others spread over a wide range of magnitudes
+template <class T>
+void test_sparse(size_t num_elements, double density){
+    vector<T> data(num_elements, 0);
+    std::mt19937 gen(0);
+    std::uniform_real_distribution<double> uniform(0, 1);
+    std::normal_distribution<double> normal(0, 1);
+    for(size_t i=0; i<num_elements; i++){
+        if(uniform(gen) < density) data[i] = normal(gen) * exp(3 * normal(gen));
+    }
+    T max_val = 0;
+    for(size_t i=0; i<num_elements; i++){
+        if(fabs(data[i]) > max_val) max_val = fabs(data[i]);
+    }
+    int level_exp = 0;
+    frexp(max_val, &level_exp);
+    vector<string> names = {"Grouped", "PerBit", "NegaBinary", "Arithmetic"};
+    vector<uint64_t> total_sizes;
+    total_sizes.push_back(evaluate(data, num_elements, level_exp, 32, MDR::GroupedBPEncoder<T, uint32_t>()));
+    total_sizes.push_back(evaluate(data, num_elements, level_exp, 32, MDR::PerBitBPEncoder<T, uint32_t>()));
+    total_sizes.push_back(evaluate(data, num_elements, level_exp, 32, MDR::NegaBinaryBPEncoder<T, uint32_t>()));
+    total_sizes.push_back(evaluate(data, num_elements, level_exp, 32, MDR::ArithmeticBPEncoder<T>()));
+    cout << "Sparse level of " << num_elements << " elements, " << density * 100 << "% nonzero:" << endl;
+    for(int i=0; i<names.size(); i++){
+        cout << names[i] << " encoder: " << total_sizes[i] << " bytes" << endl;
+    }
 }
 
 template <class T>
@@ -69,12 +104,14 @@ void test(string filename){
     evaluate(data, num_elements, level_exp, 32, MDR::PerBitBPEncoder<T, uint64_t>());
     evaluate(data, num_elements, level_exp, 32, MDR::NegaBinaryBPEncoder<T, uint32_t>());
     evaluate(data, num_elements, level_exp, 32, MDR::NegaBinaryBPEncoder<T, uint64_t>());
+    evaluate(data, num_elements, level_exp, 32, MDR::ArithmeticBPEncoder<T>());
 }
 
 int main(int argc, char ** argv){
 
 	string filename = string(argv[1]);
 	test<float>(filename);
+	test_sparse<float>(1 << 20, 0.02);
 	return 0;
 
 }
\ No newline at end of file
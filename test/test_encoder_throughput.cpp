@@ -0,0 +1,133 @@
+#include <iostream>
+#include <ctime>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <cmath>
+#include <random>
+#include "BitplaneEncoder/PerBitBPEncoder.hpp"
+
+using namespace std;
+
+// reference per-bit encoding: write the bits of every value one by one, with the sign after the first nonzero bit
+template <class T>
+vector<vector<uint64_t>> reference_encode(const T * data, size_t n, int exp, int num_bitplanes){
+    using T_fp = typename std::conditional<std::is_same<T, double>::value, uint64_t, uint32_t>::type;
+    vector<vector<uint64_t>> streams(num_bitplanes);
+    vector<uint64_t> num_bits(num_bitplanes, 0);
+    auto write = [&](int index, uint64_t bit){
+        if(num_bits[index] % 64 == 0) streams[index].push_back(0);
+        streams[index].back() |= bit << (num_bits[index] % 64);
+        num_bits[index] ++;
+    };
+    for(size_t i=0; i<n; i++){
+        T shifted_data = ldexp(data[i], num_bitplanes - exp);
+        bool sign = data[i] < 0;
+        int64_t fix_point = (int64_t) shifted_data;
+        T_fp fp_data = sign ? -fix_point : +fix_point;
+        bool first_bit = true;
+        for(int k=num_bitplanes - 1; k>=0; k--){
+            uint64_t bit = (fp_data >> k) & 1u;
+            write(num_bitplanes - 1 - k, bit);
+            if(bit && first_bit){
+                write(num_bitplanes - 1 - k, sign);
+                first_bit = false;
+            }
+        }
+    }
+    return streams;
+}
+
+// reference per-bit decoding of all bitplanes
+template <class T>
+vector<T> reference_decode(const vector<uint8_t const *>& streams, size_t n, int exp, int num_bitplanes){
+    using T_fp = typename std::conditional<std::is_same<T, double>::value, uint64_t, uint32_t>::type;
+    vector<uint64_t> num_bits(num_bitplanes, 0);
+    auto read = [&](int index){
+        uint64_t word = reinterpret_cast<uint64_t const *>(streams[index])[num_bits[index] / 64];
+        return (word >> (num_bits[index] ++ % 64)) & 1u;
+    };
+    vector<T> data(n);
+    for(size_t i=0; i<n; i++){
+        T_fp fp_data = 0;
+        bool sign = false;
+        bool first_bit = true;
+        for(int k=num_bitplanes - 1; k>=0; k--){
+            uint64_t bit = read(num_bitplanes - 1 - k);
+            fp_data |= (T_fp) bit << k;
+            if(bit && first_bit){
+                sign = read(num_bitplanes - 1 - k);
+                first_bit = false;
+            }
+        }
+        T cur_data = ldexp((T) fp_data, exp - num_bitplanes);
+        data[i] = sign ? -cur_data : cur_data;
+    }
+    return data;
+}
+
+double elapsed(const struct timespec& start, const struct timespec& end){
+    return (double)(end.tv_sec - start.tv_sec) + (double)(end.tv_nsec - start.tv_nsec)/(double)1000000000;
+}
+
+template <class T>
+void evaluate(size_t n, int num_bitplanes, int num_runs){
+    // values of widely varying magnitudes, as in the coefficients of the fine levels
+    vector<T> data(n);
+    std::mt19937 gen(n);
+    std::normal_distribution<double> dist(0, 1);
+    for(size_t i=0; i<n; i++) data[i] = dist(gen) * exp(3 * dist(gen));
+    T max_val = 0;
+    for(size_t i=0; i<n; i++) max_val = std::max(max_val, (T) fabs(data[i]));
+    int exp = 0;
+    frexp(max_val, &exp);
+    auto encoder = MDR::PerBitBPEncoder<T, uint32_t>();
+    struct timespec start, end;
+    // encode
+    vector<uint32_t> stream_sizes;
+    vector<uint8_t *> streams;
+    clock_gettime(CLOCK_REALTIME, &start);
+    for(int r=0; r<num_runs; r++){
+        for(auto s:streams) free(s);
+        streams = encoder.encode(data.data(), n, exp, num_bitplanes, stream_sizes);
+    }
+    clock_gettime(CLOCK_REALTIME, &end);
+    double encode_time = elapsed(start, end) / num_runs;
+    vector<uint8_t const *> const_streams(streams.begin(), streams.end());
+    // decode
+    T * decoded = NULL;
+    clock_gettime(CLOCK_REALTIME, &start);
+    for(int r=0; r<num_runs; r++){
+        free(decoded);
+        decoded = encoder.decode(const_streams, n, exp, num_bitplanes);
+    }
+    clock_gettime(CLOCK_REALTIME, &end);
+    double decode_time = elapsed(start, end) / num_runs;
+    // reference
+    clock_gettime(CLOCK_REALTIME, &start);
+    auto reference_streams = reference_encode(data.data(), n, exp, num_bitplanes);
+    clock_gettime(CLOCK_REALTIME, &end);
+    double reference_encode_time = elapsed(start, end);
+    clock_gettime(CLOCK_REALTIME, &start);
+    auto reference_data = reference_decode<T>(const_streams, n, exp, num_bitplanes);
+    clock_gettime(CLOCK_REALTIME, &end);
+    double reference_decode_time = elapsed(start, end);
+    bool match = true;
+    for(int i=0; i<num_bitplanes; i++){
+        match = match && (stream_sizes[i] == reference_streams[i].size() * sizeof(uint64_t));
+        match = match && !memcmp(streams[i], reference_streams[i].data(), stream_sizes[i]);
+    }
+    match = match && !memcmp(decoded, reference_data.data(), n * sizeof(T));
+    double gb = n * sizeof(T) / 1e9;
+    cout << n << (std::is_same<T, double>::value ? " doubles" : " floats") << ", " << num_bitplanes << " bitplanes: encode " << gb / encode_time << " GB/s, decode " << gb / decode_time << " GB/s, bit-wise reference encode " << gb / reference_encode_time << " GB/s, decode " << gb / reference_decode_time << " GB/s, " << (match ? "match" : "MISMATCH") << endl;
+    for(auto s:streams) free(s);
+    free(decoded);
+}
+
+int main(int argc, char ** argv){
+    int num_runs = (argc > 1) ? atoi(argv[1]) : 5;
+    evaluate<float>(1u << 24, 32, num_runs);
+    evaluate<float>((1u << 24) + 77, 16, num_runs);
+    evaluate<double>(1u << 23, 60, num_runs);
+    return 0;
+}
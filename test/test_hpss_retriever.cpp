@@ -0,0 +1,139 @@
+#include <iostream>
+#include <ctime>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <string>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <sys/stat.h>
+#include "Writer/Writer.hpp"
+#include "Retriever/Retriever.hpp"
+
+using namespace std;
+
+atomic<int> num_file_reads(0);
+
+// HPSS retriever on a simulated high-latency tier: every file read waits latency seconds before the data comes
+class LatencyHPSSFileRetriever : public MDR::HPSSFileRetriever {
+public:
+    LatencyHPSSFileRetriever(const string& metadata_file, const vector<string>& level_files, int num_threads, double latency) : MDR::HPSSFileRetriever(metadata_file, level_files, num_threads), latency(latency) {}
+protected:
+    void read_file(const string& filename, uint32_t size, uint8_t * dest) const {
+        this_thread::sleep_for(chrono::duration<double>(latency));
+        num_file_reads ++;
+        MDR::HPSSFileRetriever::read_file(filename, size, dest);
+    }
+private:
+    double latency = 0;
+};
+
+double elapsed(const struct timespec& start, const struct timespec& end){
+    return (double)(end.tv_sec - start.tv_sec) + (double)(end.tv_nsec - start.tv_nsec)/(double)1000000000;
+}
+
+// retrieve the bitplanes of every level in progressive steps, and compare with the written components
+double evaluate(LatencyHPSSFileRetriever retriever, const vector<vector<uint8_t*>>& level_components, const vector<vector<uint32_t>>& level_sizes, const vector<uint8_t>& steps, const vector<uint8_t>& metadata, bool& match){
+    int num_levels = level_components.size();
+    vector<uint8_t> prev_level_num_bitplanes(num_levels, 0);
+    double time = 0;
+    match = true;
+    for(auto step:steps){
+        vector<uint8_t> level_num_bitplanes(num_levels, step);
+        vector<uint32_t> retrieve_sizes(num_levels, 0);
+        for(int i=0; i<num_levels; i++){
+            for(int j=prev_level_num_bitplanes[i]; j<step; j++) retrieve_sizes[i] += level_sizes[i][j];
+        }
+        struct timespec start, end;
+        clock_gettime(CLOCK_REALTIME, &start);
+        auto components = retriever.retrieve_level_components(level_sizes, retrieve_sizes, prev_level_num_bitplanes, level_num_bitplanes);
+        clock_gettime(CLOCK_REALTIME, &end);
+        time += elapsed(start, end);
+        for(int i=0; i<num_levels; i++){
+            for(int j=0; j<components[i].size(); j++){
+                int k = prev_level_num_bitplanes[i] + j;
+                match = match && !memcmp(components[i][j], level_components[i][k], level_sizes[i][k]);
+            }
+        }
+        prev_level_num_bitplanes = level_num_bitplanes;
+    }
+    uint8_t * loaded_metadata = retriever.load_metadata();
+    match = match && !memcmp(loaded_metadata, metadata.data(), metadata.size());
+    free(loaded_metadata);
+    retriever.release();
+    return time;
+}
+
+int main(int argc, char ** argv){
+    double latency = (argc > 1) ? atof(argv[1]) / 1000 : 0.05;
+    uint32_t min_HPSS_size = (argc > 2) ? atoi(argv[2]) : (1u << 20);
+    // level components of 32 bitplanes, growing by 4x per level as in a 3D decomposition
+    string root = "hpss_data";
+    mkdir(root.c_str(), 0755);
+    const int num_levels = 5;
+    const int num_bitplanes = 32;
+    std::mt19937 gen(0);
+    vector<string> level_files;
+    vector<vector<uint8_t*>> level_components(num_levels);
+    vector<vector<uint32_t>> level_sizes(num_levels);
+    for(int i=0; i<num_levels; i++){
+        level_files.push_back(root + "/level_" + to_string(i) + ".bin");
+        for(int j=0; j<num_bitplanes; j++){
+            level_sizes[i].push_back((1u << (10 + 2 * i)) * (1 + j % 3) + gen() % 1000);
+            level_components[i].push_back((uint8_t *) malloc(level_sizes[i][j]));
+            for(uint32_t k=0; k<level_sizes[i][j]; k++) level_components[i][j][k] = gen();
+        }
+    }
+    vector<uint8_t> metadata(1024);
+    for(auto& m:metadata) m = gen();
+    auto writer = MDR::HPSSFileWriter(root + "/metadata.bin", level_files, 1, min_HPSS_size);
+    auto level_num = writer.write_level_components(level_components, level_sizes);
+    writer.write_metadata(metadata.data(), metadata.size());
+
+    // reading only the requested bitplanes would touch every file holding some of them at each step
+    vector<uint8_t> steps = {2, 4, 8, 12, 16, 24, 32};
+    int num_files = 0;
+    int num_range_reads = 0;
+    for(int i=0; i<num_levels; i++){
+        num_files += level_num[i];
+        uint32_t size = 0;
+        int chunk_begin = 0;
+        for(int j=0; j<num_bitplanes; j++){
+            size += level_sizes[i][j];
+            if((size >= min_HPSS_size) || (j == num_bitplanes - 1)){
+                int prev_step = 0;
+                for(auto step:steps){
+                    if((chunk_begin < step) && (j >= prev_step)) num_range_reads ++;
+                    prev_step = step;
+                }
+                size = 0;
+                chunk_begin = j + 1;
+            }
+        }
+    }
+
+    vector<int> thread_counts = {1, 8};
+    vector<double> times;
+    vector<int> file_reads;
+    vector<bool> matches;
+    for(auto num_threads:thread_counts){
+        bool match = true;
+        num_file_reads = 0;
+        times.push_back(evaluate(LatencyHPSSFileRetriever(root + "/metadata.bin", level_files, num_threads, latency), level_components, level_sizes, steps, metadata, match));
+        file_reads.push_back(num_file_reads);
+        matches.push_back(match);
+    }
+    cout << num_files << " aggregated files, " << steps.size() << " progressive steps, " << latency * 1000 << " ms latency per file" << endl;
+    cout << "Reading the requested bitplanes only would touch " << num_range_reads << " files" << endl;
+    for(int i=0; i<thread_counts.size(); i++){
+        cout << "HPSS retriever, " << thread_counts[i] << " threads: " << file_reads[i] << " files read in " << times[i] << " s, " << (matches[i] ? "match" : "MISMATCH") << endl;
+    }
+    for(int i=0; i<num_levels; i++){
+        for(int j=0; j<num_bitplanes; j++){
+            free(level_components[i][j]);
+        }
+    }
+    return 0;
+}
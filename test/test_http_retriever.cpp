@@ -0,0 +1,285 @@
+#include <iostream>
+#include <ctime>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <chrono>
+#include <random>
+#include <sys/stat.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include "Retriever/Retriever.hpp"
+#include "Retriever/HTTPRangeRetriever.hpp"
+
+using namespace std;
+using Clock = chrono::steady_clock;
+
+// loopback HTTP server serving the files of a directory, as a local stand-in for an object store
+// every request is answered latency seconds after it arrives (so pipelined requests overlap their latencies),
+// and every connection sends at most bandwidth bytes per second
+// if max_requests > 0, a connection is closed after answering max_requests requests, dropping the requests
+// pipelined behind them, as keep-alive limits and idle timeouts of servers do; the last response says so
+// with "Connection: close" if announce_close
+class LoopbackServer {
+public:
+    LoopbackServer(const string& root, int port, double latency, double bandwidth, int max_requests = 0, bool announce_close = true) : root(root), latency(latency), bandwidth(bandwidth), max_requests(max_requests), announce_close(announce_close) {
+        listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+        int reuse = 1;
+        setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+        struct sockaddr_in address = {};
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        address.sin_port = htons(port);
+        socklen_t length = sizeof(address);
+        if(::bind(listen_fd, (struct sockaddr *) &address, length) || listen(listen_fd, 64) || getsockname(listen_fd, (struct sockaddr *) &address, &length)){
+            cerr << "Cannot listen on port " << port << endl;
+            exit(-1);
+        }
+        server_port = ntohs(address.sin_port);
+        acceptor = thread([this](){ accept_connections(); });
+    }
+    int port() const {
+        return server_port;
+    }
+    ~LoopbackServer(){
+        shutdown(listen_fd, SHUT_RDWR);
+        close(listen_fd);
+        acceptor.join();
+        {
+            lock_guard<mutex> lock(connections_mutex);
+            for(auto fd:connection_fds) shutdown(fd, SHUT_RDWR);
+        }
+        for(auto& t:connection_threads) t.join();
+    }
+private:
+    struct Request {
+        Clock::time_point arrival;
+        string path;
+        long long first;
+        long long last;     // -1 for the whole file
+    };
+    void accept_connections(){
+        while(true){
+            int fd = accept(listen_fd, NULL, NULL);
+            if(fd < 0) return;
+            lock_guard<mutex> lock(connections_mutex);
+            connection_fds.push_back(fd);
+            connection_threads.push_back(thread([this, fd](){ serve(fd); }));
+        }
+    }
+    // requests are read as they arrive and answered in order by another thread
+    void serve(int fd){
+        deque<Request> requests;
+        mutex requests_mutex;
+        condition_variable requests_cv;
+        bool closed = false;
+        thread responder([&](){
+            Clock::time_point next_send = Clock::now();
+            for(int num_responses=1; ; num_responses++){
+                Request request;
+                {
+                    unique_lock<mutex> lock(requests_mutex);
+                    requests_cv.wait(lock, [&](){ return closed || !requests.empty(); });
+                    if(requests.empty()) return;
+                    request = requests.front();
+                    requests.pop_front();
+                }
+                this_thread::sleep_until(request.arrival + chrono::duration_cast<Clock::duration>(chrono::duration<double>(latency)));
+                bool last = (num_responses == max_requests);
+                if(!respond(fd, request, next_send, last && announce_close)) return;
+                if(last){
+                    shutdown(fd, SHUT_RDWR);
+                    return;
+                }
+            }
+        });
+        string received;
+        char buffer[4096];
+        while(true){
+            size_t end = received.find("\r\n\r\n");
+            if(end == string::npos){
+                ssize_t count = recv(fd, buffer, sizeof(buffer), 0);
+                if(count <= 0) break;
+                received.append(buffer, count);
+                continue;
+            }
+            string header = received.substr(0, end);
+            received.erase(0, end + 4);
+            Request request = {Clock::now(), "", 0, -1};
+            size_t path_begin = header.find(' ') + 1;
+            request.path = header.substr(path_begin, header.find(' ', path_begin) - path_begin);
+            size_t range = header.find("Range: bytes=");
+            if(range != string::npos){
+                sscanf(header.c_str() + range + 13, "%lld-%lld", &request.first, &request.last);
+            }
+            lock_guard<mutex> lock(requests_mutex);
+            requests.push_back(request);
+            requests_cv.notify_one();
+        }
+        {
+            lock_guard<mutex> lock(requests_mutex);
+            closed = true;
+            requests_cv.notify_one();
+        }
+        responder.join();
+        close(fd);
+    }
+    bool respond(int fd, const Request& request, Clock::time_point& next_send, bool close_connection){
+        vector<char> body;
+        long long file_size = 0;
+        FILE * file = fopen((root + request.path).c_str(), "r");
+        if(file){
+            fseek(file, 0, SEEK_END);
+            file_size = ftell(file);
+            long long first = request.first;
+            long long last = (request.last < 0) ? file_size - 1 : min(request.last, file_size - 1);
+            body.resize(max(last - first + 1, 0LL));
+            fseek(file, first, SEEK_SET);
+            fread(body.data(), 1, body.size(), file);
+            fclose(file);
+        }
+        string header;
+        if(!file) header = "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\n\r\n";
+        else if(request.last < 0) header = "HTTP/1.1 200 OK\r\nContent-Length: " + to_string(body.size()) + "\r\n\r\n";
+        else header = "HTTP/1.1 206 Partial Content\r\nContent-Length: " + to_string(body.size()) + "\r\nContent-Range: bytes " + to_string(request.first) + "-" + to_string(request.first + (long long) body.size() - 1) + "/" + to_string(file_size) + "\r\n\r\n";
+        if(close_connection) header.insert(header.size() - 2, "Connection: close\r\n");
+        if(send(fd, header.data(), header.size(), MSG_NOSIGNAL) != header.size()) return false;
+        // send the body in chunks at the bandwidth of the connection
+        const size_t chunk_size = 1 << 16;
+        next_send = max(next_send, Clock::now());
+        for(size_t sent=0; sent<body.size(); ){
+            this_thread::sleep_until(next_send);
+            size_t size = min(chunk_size, body.size() - sent);
+            ssize_t count = send(fd, body.data() + sent, size, MSG_NOSIGNAL);
+            if(count <= 0) return false;
+            sent += count;
+            next_send += chrono::duration_cast<Clock::duration>(chrono::duration<double>(count / bandwidth));
+        }
+        return true;
+    }
+    string root;
+    double latency = 0;
+    double bandwidth = 0;
+    int max_requests = 0;
+    bool announce_close = true;
+    int listen_fd = -1;
+    int server_port = 0;
+    thread acceptor;
+    mutex connections_mutex;
+    vector<int> connection_fds;
+    vector<thread> connection_threads;
+};
+
+double elapsed(const struct timespec& start, const struct timespec& end){
+    return (double)(end.tv_sec - start.tv_sec) + (double)(end.tv_nsec - start.tv_nsec)/(double)1000000000;
+}
+
+// retrieve the bitplanes of every level in progressive steps, and compare with ConcatLevelFileRetriever
+template <class Retriever>
+double evaluate(Retriever retriever, const string& root, const vector<string>& level_files, const vector<vector<uint32_t>>& level_sizes, const vector<uint8_t>& steps, bool& match){
+    vector<string> files;
+    for(const auto& f:level_files) files.push_back(root + f);
+    auto reference = MDR::ConcatLevelFileRetriever(root + "/metadata.bin", files);
+    vector<uint8_t> prev_level_num_bitplanes(level_files.size(), 0);
+    double time = 0;
+    match = true;
+    for(auto step:steps){
+        vector<uint8_t> level_num_bitplanes(level_files.size(), step);
+        vector<uint32_t> retrieve_sizes(level_files.size(), 0);
+        for(int i=0; i<level_files.size(); i++){
+            for(int j=prev_level_num_bitplanes[i]; j<step; j++) retrieve_sizes[i] += level_sizes[i][j];
+        }
+        struct timespec start, end;
+        clock_gettime(CLOCK_REALTIME, &start);
+        auto components = retriever.retrieve_level_components(level_sizes, retrieve_sizes, prev_level_num_bitplanes, level_num_bitplanes);
+        clock_gettime(CLOCK_REALTIME, &end);
+        time += elapsed(start, end);
+        auto reference_components = reference.retrieve_level_components(level_sizes, retrieve_sizes, prev_level_num_bitplanes, level_num_bitplanes);
+        for(int i=0; i<level_files.size(); i++){
+            for(int j=0; j<components[i].size(); j++){
+                match = match && !memcmp(components[i][j], reference_components[i][j], level_sizes[i][prev_level_num_bitplanes[i] + j]);
+            }
+        }
+        prev_level_num_bitplanes = level_num_bitplanes;
+    }
+    uint8_t * metadata = retriever.load_metadata();
+    uint8_t * reference_metadata = reference.load_metadata();
+    match = match && !memcmp(metadata, reference_metadata, 1024);
+    free(metadata);
+    free(reference_metadata);
+    retriever.release();
+    reference.release();
+    return time;
+}
+
+int main(int argc, char ** argv){
+    // serve a directory for external benchmarks: test_http_retriever serve <dir> <port> <latency in ms> <bandwidth in MB/s>
+    if((argc > 5) && (string(argv[1]) == "serve")){
+        LoopbackServer server(argv[2], atoi(argv[3]), atof(argv[4]) / 1000, atof(argv[5]) * 1e6);
+        cout << "Serving " << argv[2] << " on port " << server.port() << endl;
+        while(true) this_thread::sleep_for(chrono::seconds(60));
+    }
+    double latency = (argc > 1) ? atof(argv[1]) / 1000 : 0.02;
+    double bandwidth = (argc > 2) ? atof(argv[2]) * 1e6 : 50e6;
+    // level objects of 32 bitplanes, growing by 4x per level as in a 3D decomposition
+    string root = "http_data";
+    mkdir(root.c_str(), 0755);
+    const int num_levels = 5;
+    const int num_bitplanes = 32;
+    std::mt19937 gen(0);
+    vector<string> level_files;
+    vector<vector<uint32_t>> level_sizes(num_levels);
+    uint64_t total_size = 0;
+    for(int i=0; i<num_levels; i++){
+        level_files.push_back("/level_" + to_string(i) + ".bin");
+        vector<uint8_t> level_data;
+        for(int j=0; j<num_bitplanes; j++){
+            level_sizes[i].push_back((1u << (10 + 2 * i)) * (1 + j % 3) + gen() % 1000);
+            for(uint32_t k=0; k<level_sizes[i][j]; k++) level_data.push_back(gen());
+        }
+        FILE * file = fopen((root + level_files[i]).c_str(), "w");
+        fwrite(level_data.data(), 1, level_data.size(), file);
+        fclose(file);
+        total_size += level_data.size();
+    }
+    vector<uint8_t> metadata(1024);
+    for(auto& m:metadata) m = gen();
+    FILE * file = fopen((root + "/metadata.bin").c_str(), "w");
+    fwrite(metadata.data(), 1, metadata.size(), file);
+    fclose(file);
+
+    LoopbackServer server(root, 0, latency, bandwidth);
+    vector<uint8_t> steps = {4, 12, 32};
+    bool match = true;
+    double file_time = evaluate(MDR::ConcatLevelFileRetriever(root + "/metadata.bin", vector<string>{root + level_files[0], root + level_files[1], root + level_files[2], root + level_files[3], root + level_files[4]}), root, level_files, level_sizes, steps, match);
+    vector<pair<int, int>> configurations = {{1, 1}, {1, 8}, {4, 1}, {4, 8}, {16, 8}};
+    vector<double> times;
+    vector<bool> matches;
+    for(const auto& c:configurations){
+        times.push_back(evaluate(MDR::HTTPRangeRetriever("127.0.0.1", server.port(), "/metadata.bin", level_files, c.first, c.second), root, level_files, level_sizes, steps, match));
+        matches.push_back(match);
+    }
+    // connections closed by the server after a few requests, with and without notice
+    vector<bool> announce_close = {true, false};
+    vector<double> close_times;
+    vector<bool> close_matches;
+    for(auto announce:announce_close){
+        LoopbackServer closing_server(root, 0, latency, bandwidth, 5, announce);
+        close_times.push_back(evaluate(MDR::HTTPRangeRetriever("127.0.0.1", closing_server.port(), "/metadata.bin", level_files, 4, 8), root, level_files, level_sizes, steps, match));
+        close_matches.push_back(match);
+    }
+    cout << total_size / 1e6 << " MB in " << steps.size() << " progressive steps, " << latency * 1000 << " ms latency, " << bandwidth / 1e6 << " MB/s per connection" << endl;
+    cout << "Local files: " << file_time << " s" << endl;
+    for(int i=0; i<configurations.size(); i++){
+        cout << "HTTP, " << configurations[i].first << " connections, pipeline depth " << configurations[i].second << ": " << times[i] << " s, " << (matches[i] ? "match" : "MISMATCH") << endl;
+    }
+    for(int i=0; i<announce_close.size(); i++){
+        cout << "HTTP, 4 connections, pipeline depth 8, closed after 5 requests " << (announce_close[i] ? "with" : "without") << " notice: " << close_times[i] << " s, " << (close_matches[i] ? "match" : "MISMATCH") << endl;
+    }
+    return 0;
+}
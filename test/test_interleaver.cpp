@@ -8,6 +8,8 @@
 #include "utils.hpp"
 #include "RefactorUtils.hpp"
 #include "Interleaver/DirectInterleaver.hpp"
+#include "Interleaver/BlockedInterleaver.hpp"
+#include "Interleaver/SFCInterleaver.hpp"
 
 using namespace std;
 
@@ -54,12 +56,62 @@ void evaluate(const vector<T>& data, const vector<uint32_t>& dims, int target_le
     cout << "Max error = " << max_err << endl;
 }
 
+// interleave the indices of the elements level by level, and check that every element is recorded exactly once
+// and comes back to its place after reposition
+template <class Interleaver>
+bool check_coverage(const vector<uint32_t>& dims, int target_level, Interleaver interleaver){
+    size_t num_elements = 1;
+    for(const auto& dim:dims) num_elements *= dim;
+    vector<double> data(num_elements);
+    for(size_t i=0; i<num_elements; i++) data[i] = i;
+    auto level_dims = MDR::compute_level_dims(dims, target_level);
+    auto level_elements = MDR::compute_level_elements(level_dims, target_level);
+    vector<uint32_t> dims_dummy(dims.size(), 0);
+    vector<int> count(num_elements, 0);
+    vector<double> data_reposition(num_elements, -1);
+    bool valid = true;
+    for(int i=0; i<=target_level; i++){
+        const vector<uint32_t>& prev_dims = (i == 0) ? dims_dummy : level_dims[i - 1];
+        // one more element to catch overflows
+        vector<double> buffer(level_elements[i] + 1, -1);
+        interleaver.interleave(data.data(), dims, level_dims[i], prev_dims, buffer.data());
+        valid = valid && (buffer[level_elements[i]] == -1);
+        for(size_t j=0; j<level_elements[i]; j++){
+            if((buffer[j] < 0) || (buffer[j] >= num_elements)) valid = false;
+            else count[(size_t) buffer[j]] ++;
+        }
+        interleaver.reposition(buffer.data(), dims, level_dims[i], prev_dims, data_reposition.data());
+    }
+    for(size_t i=0; i<num_elements; i++){
+        valid = valid && (count[i] == 1) && (data_reposition[i] == data[i]);
+    }
+    return valid;
+}
+
+// Morton and Hilbert orders on 1D to 4D boxes, with power-of-two and other sizes
+void test_sfc_coverage(){
+    vector<vector<uint32_t>> dims_list = {{64}, {37}, {16, 16}, {33, 20}, {8, 8, 8}, {17, 9, 23}, {8, 8, 8, 8}, {7, 9, 5, 6}};
+    for(const auto& dims:dims_list){
+        for(auto order:{MDR::MORTON, MDR::HILBERT}){
+            bool valid = check_coverage(dims, 2, MDR::SFCInterleaver<double>(order));
+            cout << ((order == MDR::HILBERT) ? "Hilbert" : "Morton") << " order on";
+            for(const auto& dim:dims) cout << " " << dim;
+            cout << ": " << (valid ? "every element recorded once" : "FAILED") << endl;
+        }
+    }
+}
+
 template <class T>
 void test(string filename, const vector<uint32_t>& dims){
     size_t num_elements = 0;
     auto data = MGARD::readfile<T>(filename.c_str(), num_elements);
     const int target_level = 3;
     evaluate<T>(data, dims, target_level, MDR::DirectInterleaver<T>());
+    if(dims.size() == 3) evaluate<T>(data, dims, target_level, MDR::BlockedInterleaver<T>());
+    if(dims.size() <= 4){
+        evaluate<T>(data, dims, target_level, MDR::SFCInterleaver<T>(MDR::MORTON));
+        evaluate<T>(data, dims, target_level, MDR::SFCInterleaver<T>(MDR::HILBERT));
+    }
 }
 
 int main(int argc, char ** argv){
@@ -71,6 +123,7 @@ int main(int argc, char ** argv){
         dims[i] = atoi(argv[3+i]);
     }
     test<float>(filename, dims);
+    test_sfc_coverage();
     return 0;
 
 }
\ No newline at end of file
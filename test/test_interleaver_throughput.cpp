@@ -0,0 +1,107 @@
+#include <iostream>
+#include <ctime>
+#include <cstdlib>
+#include <vector>
+#include <cmath>
+#include "RefactorUtils.hpp"
+#include "Interleaver/DirectInterleaver.hpp"
+
+using namespace std;
+
+// reference interleave: visit the fine box and skip the coarse box point by point
+template <class T>
+void reference_interleave(const T * data, const vector<uint32_t>& dims, const vector<uint32_t>& dims_fine, const vector<uint32_t>& dims_coarse, T * buffer){
+    const int num_dims = dims.size();
+    vector<size_t> strides(num_dims);
+    size_t stride = 1;
+    for(int i=num_dims-1; i>=0; i--){
+        strides[i] = stride;
+        stride *= dims[i];
+    }
+    vector<uint32_t> index(num_dims, 0);
+    size_t count = 0;
+    while(true){
+        bool in_coarse = true;
+        size_t offset = 0;
+        for(int i=0; i<num_dims; i++){
+            in_coarse = in_coarse && (index[i] < dims_coarse[i]);
+            offset += index[i] * strides[i];
+        }
+        if(!in_coarse) buffer[count ++] = data[offset];
+        int d = num_dims - 1;
+        while(d >= 0){
+            if(++ index[d] < dims_fine[d]) break;
+            index[d] = 0;
+            d --;
+        }
+        if(d < 0) break;
+    }
+}
+
+double elapsed(const struct timespec& start, const struct timespec& end){
+    return (double)(end.tv_sec - start.tv_sec) + (double)(end.tv_nsec - start.tv_nsec)/(double)1000000000;
+}
+
+template <class T>
+void evaluate(const vector<uint32_t>& dims, int target_level, int num_runs){
+    size_t num_elements = 1;
+    for(const auto& d:dims) num_elements *= d;
+    vector<T> data(num_elements);
+    for(size_t i=0; i<num_elements; i++) data[i] = i;
+    auto interleaver = MDR::DirectInterleaver<T>();
+    auto level_dims = MDR::compute_level_dims(dims, target_level);
+    auto level_elements = MDR::compute_level_elements(level_dims, target_level);
+    vector<uint32_t> dims_dummy(dims.size(), 0);
+    vector<vector<T>> buffers;
+    for(int i=0; i<=target_level; i++){
+        buffers.push_back(vector<T>(level_elements[i]));
+    }
+    struct timespec start, end;
+    // interleave
+    clock_gettime(CLOCK_REALTIME, &start);
+    for(int r=0; r<num_runs; r++){
+        for(int i=0; i<=target_level; i++){
+            const vector<uint32_t>& prev_dims = (i == 0) ? dims_dummy : level_dims[i - 1];
+            interleaver.interleave(data.data(), dims, level_dims[i], prev_dims, buffers[i].data());
+        }
+    }
+    clock_gettime(CLOCK_REALTIME, &end);
+    double interleave_time = elapsed(start, end) / num_runs;
+    // reposition
+    vector<T> data_reposition(num_elements, 0);
+    clock_gettime(CLOCK_REALTIME, &start);
+    for(int r=0; r<num_runs; r++){
+        for(int i=0; i<=target_level; i++){
+            const vector<uint32_t>& prev_dims = (i == 0) ? dims_dummy : level_dims[i - 1];
+            interleaver.reposition(buffers[i].data(), dims, level_dims[i], prev_dims, data_reposition.data());
+        }
+    }
+    clock_gettime(CLOCK_REALTIME, &end);
+    double reposition_time = elapsed(start, end) / num_runs;
+    // reference
+    vector<T> reference_buffer;
+    clock_gettime(CLOCK_REALTIME, &start);
+    bool match = true;
+    for(int i=0; i<=target_level; i++){
+        const vector<uint32_t>& prev_dims = (i == 0) ? dims_dummy : level_dims[i - 1];
+        reference_buffer.resize(level_elements[i]);
+        reference_interleave(data.data(), dims, level_dims[i], prev_dims, reference_buffer.data());
+        match = match && (reference_buffer == buffers[i]);
+    }
+    clock_gettime(CLOCK_REALTIME, &end);
+    double reference_time = elapsed(start, end);
+    match = match && (data_reposition == data);
+    double gb = 2.0 * num_elements * sizeof(T) / 1e9;
+    cout << dims.size() << "D (";
+    for(int i=0; i<dims.size(); i++) cout << dims[i] << (i + 1 < dims.size() ? "x" : ")");
+    cout << ": interleave " << gb / interleave_time << " GB/s, reposition " << gb / reposition_time << " GB/s, point-wise reference " << gb / reference_time << " GB/s, " << (match ? "match" : "MISMATCH") << endl;
+}
+
+int main(int argc, char ** argv){
+    int num_runs = (argc > 1) ? atoi(argv[1]) : 10;
+    evaluate<float>({1u << 26}, 4, num_runs);
+    evaluate<float>({8193, 8193}, 4, num_runs);
+    evaluate<float>({513, 513, 257}, 4, num_runs);
+    evaluate<double>({513, 513, 257}, 4, num_runs);
+    return 0;
+}
@@ -1,6 +1,7 @@
 #include <iostream>
 #include <ctime>
 #include <cstdlib>
+#include <cstring>
 #include <vector>
 #include <iomanip>
 #include <cmath>
@@ -11,8 +12,10 @@
 
 using namespace std;
 
+// return the total number of bytes retrieved after each tolerance
 template <class T, class Reconstructor>
-void evaluate(const vector<T>& data, const vector<double>& tolerance, Reconstructor reconstructor){
+vector<uint64_t> evaluate(const vector<T>& data, const vector<double>& tolerance, Reconstructor reconstructor){
+    vector<uint64_t> retrieved_sizes;
     struct timespec start, end;
     int err = 0;
     // auto a1 = compute_average(data.data(), dims[0], dims[1], dims[2], 3);
@@ -27,6 +30,67 @@ void evaluate(const vector<T>& data, const vector<double>& tolerance, Reconstruc
         MGARD::print_statistics(data.data(), reconstructed_data, data.size());
         // COMP_UTILS::evaluate_gradients(data.data(), reconstructed_data, dims[0], dims[1], dims[2]);
         // COMP_UTILS::evaluate_average(data.data(), reconstructed_data, dims[0], dims[1], dims[2], 0);
+        retrieved_sizes.push_back(reconstructor.get_retrieved_size());
+    }
+    return retrieved_sizes;
+}
+
+// byte budget mode: best estimated accuracy within the given number of new bytes per reconstruction
+// the budgets are the bytes retrieved for the tolerances, so the estimated errors should be close to them
+template <class T, class Reconstructor>
+void evaluate_budget(const vector<T>& data, const vector<uint64_t>& budgets, Reconstructor reconstructor){
+    for(int i=0; i<budgets.size(); i++){
+        uint64_t prev_retrieved_size = reconstructor.get_retrieved_size();
+        cout << "Start reconstruction with a budget of " << budgets[i] << " bytes" << endl;
+        auto reconstructed_data = reconstructor.reconstruct_with_budget(budgets[i], -1);
+        uint64_t retrieved_size = reconstructor.get_retrieved_size() - prev_retrieved_size;
+        cout << "Retrieved " << retrieved_size << " bytes, estimated error = " << reconstructor.get_estimated_error() << ", " << ((retrieved_size <= budgets[i]) ? "within budget" : "BUDGET EXCEEDED") << endl;
+        MGARD::print_statistics(data.data(), reconstructed_data, data.size());
+    }
+}
+
+// measured max error: retrieve with doubling budgets, a few bitplanes per step, and check after each step
+// that the measured bound is not below the actual max error
+template <class T, class Reconstructor>
+void evaluate_measured_bound(const vector<T>& data, Reconstructor reconstructor){
+    int num_steps = 0;
+    int num_violations = 0;
+    // the bitplanes of all levels fit in a few times the size of the data
+    for(uint64_t budget=64; budget<4 * data.size() * sizeof(T); budget*=2){
+        uint64_t prev_retrieved_size = reconstructor.get_retrieved_size();
+        auto reconstructed_data = reconstructor.reconstruct_with_budget(budget, -1);
+        if(reconstructor.get_retrieved_size() == prev_retrieved_size) continue;
+        double max_error = 0;
+        for(int i=0; i<data.size(); i++){
+            max_error = std::max(max_error, (double) fabs(data[i] - reconstructed_data[i]));
+        }
+        bool bounded = (max_error <= reconstructor.get_estimated_error());
+        cout << "Retrieved " << reconstructor.get_retrieved_size() << " bytes, measured bound = " << reconstructor.get_estimated_error() << ", max error = " << max_error << ", " << (bounded ? "OK" : "VIOLATED") << endl;
+        num_steps ++;
+        num_violations += !bounded;
+        if(reconstructor.get_estimated_error() <= 0) break;
+    }
+    cout << "Measured bound: " << num_violations << " violations in " << num_steps << " steps" << endl;
+}
+
+// levels decoded concurrently: reconstruct the same tolerances in serial and parallel mode and compare the data
+template <class Reconstructor>
+void evaluate_parallel_levels(const vector<double>& tolerance, Reconstructor serial, Reconstructor parallel){
+    parallel.set_parallel_levels(true);
+    for(int i=0; i<tolerance.size(); i++){
+        struct timespec start, end;
+        clock_gettime(CLOCK_REALTIME, &start);
+        auto serial_data = serial.progressive_reconstruct(tolerance[i], -1);
+        clock_gettime(CLOCK_REALTIME, &end);
+        double serial_time = (double)(end.tv_sec - start.tv_sec) + (double)(end.tv_nsec - start.tv_nsec)/(double)1000000000;
+        clock_gettime(CLOCK_REALTIME, &start);
+        auto parallel_data = parallel.progressive_reconstruct(tolerance[i], -1);
+        clock_gettime(CLOCK_REALTIME, &end);
+        double parallel_time = (double)(end.tv_sec - start.tv_sec) + (double)(end.tv_nsec - start.tv_nsec)/(double)1000000000;
+        size_t num_elements = 1;
+        for(const auto& d:serial.get_dimensions()) num_elements *= d;
+        bool match = (serial.get_dimensions() == parallel.get_dimensions()) && (serial.get_retrieved_size() == parallel.get_retrieved_size()) && !memcmp(serial_data, parallel_data, num_elements * sizeof(*serial_data));
+        cout << "Tolerance " << tolerance[i] << ": serial levels " << serial_time << " s, parallel levels " << parallel_time << " s, " << (match ? "match" : "MISMATCH") << endl;
     }
 }
 
@@ -35,10 +99,18 @@ void test(string filename, const vector<double>& tolerance, Decomposer decompose
     auto reconstructor = MDR::ComposedReconstructor<T, Decomposer, Interleaver, Encoder, Compressor, SizeInterpreter, ErrorEstimator, Retriever>(decomposer, interleaver, encoder, compressor, interpreter, retriever);
     cout << "loading metadata" << endl;
     reconstructor.load_metadata();
+    evaluate_parallel_levels(tolerance, reconstructor, reconstructor);
+    // decode the levels concurrently
+    // reconstructor.set_parallel_levels(true);
 
     size_t num_elements = 0;
     auto data = MGARD::readfile<T>(filename.c_str(), num_elements);
-    evaluate(data, tolerance, reconstructor);
+    auto retrieved_sizes = evaluate(data, tolerance, reconstructor);
+    vector<uint64_t> budgets;
+    for(int i=0; i<retrieved_sizes.size(); i++){
+        budgets.push_back(retrieved_sizes[i] - (i ? retrieved_sizes[i - 1] : 0));
+    }
+    evaluate_budget(data, budgets, reconstructor);
 }
 
 int main(int argc, char ** argv){
@@ -60,9 +132,11 @@ int main(int argc, char ** argv){
         // metadata interpreter, otherwise information needs to be provided
         size_t num_bytes = 0;
         auto metadata = MGARD::readfile<uint8_t>(metadata_file.c_str(), num_bytes);
-        assert(num_bytes > num_dims * sizeof(uint32_t) + 2);
-        num_dims = metadata[0];
-        num_levels = metadata[num_dims * sizeof(uint32_t) + 1];
+        // skip the version byte of versioned metadata
+        size_t pos = (metadata[0] & METADATA_VERSION_FLAG) ? 1 : 0;
+        num_dims = metadata[pos];
+        assert(num_bytes > pos + num_dims * sizeof(uint32_t) + 2);
+        num_levels = metadata[pos + num_dims * sizeof(uint32_t) + 1];
         cout << "number of dimension = " << num_dims << ", number of levels = " << num_levels << endl;
     }
     vector<string> files;
@@ -75,33 +149,55 @@ int main(int argc, char ** argv){
     using T_stream = uint32_t;
     auto decomposer = MDR::MGARDOrthoganalDecomposer<T>();
     // auto decomposer = MDR::MGARDHierarchicalDecomposer<T>();
+    // auto decomposer = MDR::InterpolationDecomposer<T>();
+    // auto decomposer = MDR::WaveletDecomposer<T>(MDR::CDF97);
     auto interleaver = MDR::DirectInterleaver<T>();
     // auto interleaver = MDR::SFCInterleaver<T>();
     // auto interleaver = MDR::BlockedInterleaver<T>();
     // auto encoder = MDR::GroupedBPEncoder<T, T_stream>();
     auto encoder = MDR::NegaBinaryBPEncoder<T, T_stream>();
     // auto encoder = MDR::PerBitBPEncoder<T, T_stream>();
+    // auto encoder = MDR::ArithmeticBPEncoder<T>();
     // auto compressor = MDR::DefaultLevelCompressor();
     auto compressor = MDR::AdaptiveLevelCompressor(32);
     // auto compressor = MDR::NullLevelCompressor();
     auto retriever = MDR::ConcatLevelFileRetriever(metadata_file, files);
     switch(error_mode){
+        case 2:{
+            // requires measured errors at refactoring (test_refactor with $measure_errors = 1)
+            auto estimator = MDR::MeasuredMaxErrorEstimator<T>();
+            auto interpreter = MDR::NegaBinaryGreedyBasedSizeInterpreter<MDR::MeasuredMaxErrorEstimator<T>>(estimator);
+            // auto interpreter = MDR::PrecomputedSizeInterpreter(2);
+            auto reconstructor = MDR::ComposedReconstructor<T, decltype(decomposer), decltype(interleaver), decltype(encoder), decltype(compressor), decltype(interpreter), decltype(estimator), decltype(retriever)>(decomposer, interleaver, encoder, compressor, interpreter, retriever);
+            reconstructor.load_metadata();
+            size_t num_elements = 0;
+            auto data = MGARD::readfile<T>(filename.c_str(), num_elements);
+            evaluate_measured_bound(data, reconstructor);
+            test<T>(filename, tolerance, decomposer, interleaver, encoder, compressor, estimator, interpreter, retriever);
+            break;
+        }
         case 1:{
             auto estimator = MDR::SNormErrorEstimator<T>(num_dims, num_levels - 1, s);
             // auto interpreter = MDR::SignExcludeGreedyBasedSizeInterpreter<MDR::SNormErrorEstimator<T>>(estimator);
             auto interpreter = MDR::NegaBinaryGreedyBasedSizeInterpreter<MDR::SNormErrorEstimator<T>>(estimator);
             // auto interpreter = MDR::RoundRobinSizeInterpreter<MDR::SNormErrorEstimator<T>>(estimator);
             // auto interpreter = MDR::InorderSizeInterpreter<MDR::SNormErrorEstimator<T>>(estimator);
+            // auto interpreter = MDR::PrecomputedSizeInterpreter(1);
             // auto estimator = MDR::L2ErrorEstimator_HB<T>(num_dims, num_levels - 1);
             // auto interpreter = MDR::SignExcludeGreedyBasedSizeInterpreter<MDR::L2ErrorEstimator_HB<T>>(estimator);
+            // auto estimator = MDR::L2ErrorEstimator_WT<T>(MDR::WaveletDecomposer<T>(MDR::CDF97).level_weights(num_dims, num_levels - 1));
+            // auto interpreter = MDR::SignExcludeGreedyBasedSizeInterpreter<MDR::L2ErrorEstimator_WT<T>>(estimator);
             test<T>(filename, tolerance, decomposer, interleaver, encoder, compressor, estimator, interpreter, retriever);            
             break;
         }
         default:{
             auto estimator = MDR::MaxErrorEstimatorOB<T>(num_dims);
             auto interpreter = MDR::SignExcludeGreedyBasedSizeInterpreter<MDR::MaxErrorEstimatorOB<T>>(estimator);
+            // auto estimator = MDR::MaxErrorEstimatorIP<T>(num_dims, num_levels - 1);
+            // auto interpreter = MDR::SignExcludeGreedyBasedSizeInterpreter<MDR::MaxErrorEstimatorIP<T>>(estimator);
             // auto interpreter = MDR::RoundRobinSizeInterpreter<MDR::MaxErrorEstimatorOB<T>>(estimator);
             // auto interpreter = MDR::InorderSizeInterpreter<MDR::MaxErrorEstimatorOB<T>>(estimator);
+            // auto interpreter = MDR::PrecomputedSizeInterpreter(0);
             // auto estimator = MDR::MaxErrorEstimatorHB<T>();
             // auto interpreter = MDR::SignExcludeGreedyBasedSizeInterpreter<MDR::MaxErrorEstimatorHB<T>>(estimator);
             test<T>(filename, tolerance, decomposer, interleaver, encoder, compressor, estimator, interpreter, retriever);
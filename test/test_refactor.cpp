@@ -22,8 +22,17 @@ void evaluate(const vector<T>& data, const vector<uint32_t>& dims, int target_le
 }
 
 template <class T, class Decomposer, class Interleaver, class Encoder, class Compressor, class ErrorCollector, class Writer>
-void test(string filename, const vector<uint32_t>& dims, int target_level, int num_bitplanes, Decomposer decomposer, Interleaver interleaver, Encoder encoder, Compressor compressor, ErrorCollector collector, Writer writer){
+void test(string filename, const vector<uint32_t>& dims, int target_level, int num_bitplanes, bool measure_errors, Decomposer decomposer, Interleaver interleaver, Encoder encoder, Compressor compressor, ErrorCollector collector, Writer writer){
     auto refactor = MDR::ComposedRefactor<T, Decomposer, Interleaver, Encoder, Compressor, ErrorCollector, Writer>(decomposer, interleaver, encoder, compressor, collector, writer);
+    // retrieval plans for PrecomputedSizeInterpreter: 0 for max error, 1 for squared error
+    refactor.add_retrieval_plan(MDR::MaxErrorEstimatorOB<T>(dims.size()));
+    refactor.add_retrieval_plan(MDR::SNormErrorEstimator<T>(dims.size(), target_level, 0));
+    // measured max error tables (plan 2) for MeasuredMaxErrorEstimator
+    // measuring recomposes the data for every bitplane of every level, and encodes through the staging buffers
+    if(measure_errors){
+        refactor.set_measure_errors(true);
+        refactor.add_retrieval_plan(MDR::MeasuredMaxErrorEstimator<T>());
+    }
     size_t num_elements = 0;
     auto data = MGARD::readfile<T>(filename.c_str(), num_elements);
     evaluate(data, dims, target_level, num_bitplanes, refactor);
@@ -44,6 +53,8 @@ int main(int argc, char ** argv){
     for(int i=0; i<num_dims; i++){
         dims[i] = atoi(argv[argv_id ++]);
     }
+    // optional: measure max errors for error mode 2 of test_reconstructor
+    bool measure_errors = (argc > argv_id) ? atoi(argv[argv_id ++]) : false;
 
     string metadata_file = "refactored_data/metadata.bin";
     vector<string> files;
@@ -59,12 +70,15 @@ int main(int argc, char ** argv){
     }
     auto decomposer = MDR::MGARDOrthoganalDecomposer<T>();
     // auto decomposer = MDR::MGARDHierarchicalDecomposer<T>();
+    // auto decomposer = MDR::InterpolationDecomposer<T>();
+    // auto decomposer = MDR::WaveletDecomposer<T>(MDR::CDF97);
     auto interleaver = MDR::DirectInterleaver<T>();
     // auto interleaver = MDR::SFCInterleaver<T>();
     // auto interleaver = MDR::BlockedInterleaver<T>();
     // auto encoder = MDR::GroupedBPEncoder<T, T_stream>();
     auto encoder = MDR::NegaBinaryBPEncoder<T, T_stream>();
     // auto encoder = MDR::PerBitBPEncoder<T, T_stream>();
+    // auto encoder = MDR::ArithmeticBPEncoder<T>();
     // auto compressor = MDR::DefaultLevelCompressor();
     auto compressor = MDR::AdaptiveLevelCompressor(32);
     // auto compressor = MDR::NullLevelCompressor();
@@ -72,6 +86,6 @@ int main(int argc, char ** argv){
     auto writer = MDR::ConcatLevelFileWriter(metadata_file, files);
     // auto writer = MDR::HPSSFileWriter(metadata_file, files, 2048, 512 * 1024 * 1024);
 
-    test<T>(filename, dims, target_level, num_bitplanes, decomposer, interleaver, encoder, compressor, collector, writer);
+    test<T>(filename, dims, target_level, num_bitplanes, measure_errors, decomposer, interleaver, encoder, compressor, collector, writer);
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,104 @@
+#include <iostream>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <vector>
+#include <string>
+#include <random>
+#include <sys/stat.h>
+#include "Writer/Writer.hpp"
+#include "Retriever/Retriever.hpp"
+#include "ErrorEstimator/ErrorEstimator.hpp"
+#include "SizeInterpreter/RetrievalPlan.hpp"
+
+using namespace std;
+
+// answer each tolerance with a fresh retriever, as independent queries would, and compare with the written components
+// return the bytes read from the slow tier over all queries
+uint64_t evaluate(const string& root, const vector<string>& fast_files, const vector<string>& slow_files, const vector<vector<uint8_t*>>& level_components, const vector<vector<uint32_t>>& level_sizes, const MDR::RetrievalPlan& plan, const vector<double>& tolerances, const vector<uint8_t>& metadata, bool& match){
+    int num_levels = level_components.size();
+    uint64_t slow_tier_size = 0;
+    match = true;
+    for(auto tolerance:tolerances){
+        auto retriever = MDR::TieredFileRetriever(root + "/metadata.bin", fast_files, slow_files);
+        const vector<uint8_t>& level_num_bitplanes = plan.level_num_bitplanes[plan.find_step(tolerance)];
+        vector<uint8_t> prev_level_num_bitplanes(num_levels, 0);
+        vector<uint32_t> retrieve_sizes(num_levels, 0);
+        for(int i=0; i<num_levels; i++){
+            for(int j=0; j<level_num_bitplanes[i]; j++) retrieve_sizes[i] += level_sizes[i][j];
+        }
+        auto components = retriever.retrieve_level_components(level_sizes, retrieve_sizes, prev_level_num_bitplanes, level_num_bitplanes);
+        for(int i=0; i<num_levels; i++){
+            for(int j=0; j<components[i].size(); j++){
+                match = match && !memcmp(components[i][j], level_components[i][j], level_sizes[i][j]);
+            }
+        }
+        uint8_t * loaded_metadata = retriever.load_metadata();
+        match = match && !memcmp(loaded_metadata, metadata.data(), metadata.size());
+        free(loaded_metadata);
+        retriever.release();
+        cout << "tolerance " << tolerance << ": fast tier " << retriever.get_fast_tier_size() << " bytes, slow tier " << retriever.get_slow_tier_size() << " bytes" << endl;
+        slow_tier_size += retriever.get_slow_tier_size();
+    }
+    return slow_tier_size;
+}
+
+int main(int argc, char ** argv){
+    double fast_ratio = (argc > 1) ? atof(argv[1]) : 0.25;
+    // level components of 32 bitplanes, growing by 4x per level as in a 3D decomposition,
+    // with errors halving per bitplane and finer levels starting from smaller errors
+    string root = "tiered_data";
+    mkdir(root.c_str(), 0755);
+    mkdir((root + "/fast").c_str(), 0755);
+    mkdir((root + "/slow").c_str(), 0755);
+    const int num_levels = 5;
+    const int num_bitplanes = 32;
+    std::mt19937 gen(0);
+    vector<string> fast_files;
+    vector<string> slow_files;
+    vector<vector<uint8_t*>> level_components(num_levels);
+    vector<vector<uint32_t>> level_sizes(num_levels);
+    vector<vector<double>> level_errors(num_levels);
+    uint64_t total_size = 0;
+    for(int i=0; i<num_levels; i++){
+        fast_files.push_back(root + "/fast/level_" + to_string(i) + ".bin");
+        slow_files.push_back(root + "/slow/level_" + to_string(i) + ".bin");
+        for(int j=0; j<num_bitplanes; j++){
+            level_sizes[i].push_back((1u << (6 + 2 * i)) * (1 + j / 4) + gen() % 100);
+            level_components[i].push_back((uint8_t *) malloc(level_sizes[i][j]));
+            for(uint32_t k=0; k<level_sizes[i][j]; k++) level_components[i][j][k] = gen();
+            total_size += level_sizes[i][j];
+        }
+        for(int j=0; j<=num_bitplanes; j++){
+            level_errors[i].push_back(ldexp(1.0, -3 * i - j));
+        }
+        level_errors[i][num_bitplanes] = 0;
+    }
+    auto plan = MDR::generate_retrieval_plan(level_sizes, level_errors, MDR::MaxErrorEstimatorHB<double>());
+    vector<uint8_t> metadata(1024);
+    for(auto& m:metadata) m = gen();
+    uint64_t fast_capacity = total_size * fast_ratio;
+    vector<double> tolerances = {1e-3, 1e-4, 1e-5, 1e-6, 1e-7, 1e-9};
+
+    // placement in error-gain order of the retrieval plan, and bitplane by bitplane without the plan
+    vector<uint64_t> slow_tier_sizes;
+    vector<bool> matches;
+    for(int placement=0; placement<2; placement++){
+        auto writer = MDR::TieredFileWriter(root + "/metadata.bin", fast_files, slow_files, fast_capacity);
+        if(placement == 0) writer.set_retrieval_plans(vector<MDR::RetrievalPlan>{plan});
+        writer.write_level_components(level_components, level_sizes);
+        writer.write_metadata(metadata.data(), metadata.size());
+        bool match = true;
+        slow_tier_sizes.push_back(evaluate(root, fast_files, slow_files, level_components, level_sizes, plan, tolerances, metadata, match));
+        matches.push_back(match);
+    }
+    cout << total_size << " bytes, " << fast_capacity << " bytes on the fast tier, " << tolerances.size() << " queries" << endl;
+    cout << "Error-gain placement: " << slow_tier_sizes[0] << " bytes from the slow tier, " << (matches[0] ? "match" : "MISMATCH") << endl;
+    cout << "Bitplane placement: " << slow_tier_sizes[1] << " bytes from the slow tier, " << (matches[1] ? "match" : "MISMATCH") << endl;
+    for(int i=0; i<num_levels; i++){
+        for(int j=0; j<num_bitplanes; j++){
+            free(level_components[i][j]);
+        }
+    }
+    return 0;
+}